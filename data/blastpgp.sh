@@ -57,7 +57,7 @@ while [ $STEP -lt $NUM_IT ]; do
 
     if [ $STEP -gt 0 ]; then
         if notExists "$TMP_PATH/aln_$STEP.hasmerge"; then
-            "$MMSEQS" mergedbs "$QUERYDB" "$TMP_PATH/aln_new" "$TMP_PATH/aln_0" "$TMP_PATH/aln_$STEP" \
+            "$MMSEQS" mergedbs "$1" "$TMP_PATH/aln_new" "$TMP_PATH/aln_0" "$TMP_PATH/aln_$STEP" \
                 || fail "Merge died"
             mv -f "$TMP_PATH/aln_new" "$TMP_PATH/aln_0"
             mv -f "$TMP_PATH/aln_new.index" "$TMP_PATH/aln_0.index"
@@ -67,11 +67,36 @@ while [ $STEP -lt $NUM_IT ]; do
 
 # create profiles
     if [ $STEP -ne $((NUM_IT  - 1)) ]; then
+        # a query without new hits keeps its profile, so it would find the same hits again
+        # only queries with new hits are searched in the next iteration, unless the next iteration
+        # searches with other parameters (e.g. the final e-value instead of --e-profile)
+        ALN_PROFILE="$TMP_PATH/aln_0"
+        PARAM="PREFILTER_PAR_$STEP"
+        eval PREF_CURR="\$$PARAM"
+        PARAM="PREFILTER_PAR_$((STEP+1))"
+        eval PREF_NEXT="\$$PARAM"
+        PARAM="ALIGNMENT_PAR_$STEP"
+        eval ALN_CURR="\$$PARAM"
+        PARAM="ALIGNMENT_PAR_$((STEP+1))"
+        eval ALN_NEXT="\$$PARAM"
+        if [ $STEP -gt 0 ] && [ "$PREF_CURR" = "$PREF_NEXT" ] && [ "$ALN_CURR" = "$ALN_NEXT" ]; then
+            # copy the subset, aln_0 is replaced by the next merge
+            if notExists "$TMP_PATH/aln_active_$STEP"; then
+                awk '$3 > 1 { print $1 }' "$TMP_PATH/aln_$STEP.index" > "$TMP_PATH/active_$STEP" \
+                    || fail "Collecting active queries died"
+                "$MMSEQS" createsubdb "$TMP_PATH/active_$STEP" "$TMP_PATH/aln_0" "$TMP_PATH/aln_active_$STEP" \
+                    || fail "createsubdb died"
+            fi
+            if [ ! -s "$TMP_PATH/active_$STEP" ]; then
+                break
+            fi
+            ALN_PROFILE="$TMP_PATH/aln_active_$STEP"
+        fi
         if notExists "$TMP_PATH/profile_$STEP"; then
             PARAM="PROFILE_PAR_$STEP"
             eval TMP="\$$PARAM"
             # shellcheck disable=SC2086
-            $RUNNER "$MMSEQS" result2profile "$QUERYDB" "$2" "$TMP_PATH/aln_0" "$TMP_PATH/profile_$STEP" ${TMP} \
+            $RUNNER "$MMSEQS" result2profile "$QUERYDB" "$2" "$ALN_PROFILE" "$TMP_PATH/profile_$STEP" ${TMP} \
                 || fail "Create profile died"
         fi
     fi
@@ -90,6 +115,7 @@ if [ -n "$REMOVE_TMP" ]; then
     rm -f "$TMP_PATH/pref_$STEP" "$TMP_PATH/pref_$STEP.index"
     rm -f "$TMP_PATH/aln_$STEP" "$TMP_PATH/aln_$STEP.index"
     rm -f "$TMP_PATH/profile_$STEP" "$TMP_PATH/profile_$STEP.index" "$TMP_PATH/profile_${STEP}_h" "$TMP_PATH/profile_${STEP}_h.index"
+    rm -f "$TMP_PATH/active_$STEP" "$TMP_PATH/aln_active_$STEP" "$TMP_PATH/aln_active_$STEP.index"
     STEP=$((STEP+1))
  done
 
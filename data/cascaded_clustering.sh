@@ -27,8 +27,8 @@ if notExists "${TMP_PATH}/aln_redundancy"; then
 fi
 
 if notExists "${TMP_PATH}/input_step_redundancy"; then
-    "$MMSEQS" createsubdb "${TMP_PATH}/clu_redundancy" "$INPUT" "${TMP_PATH}/input_step_redundancy" \
-        || faill "createsubdb died"
+    "$MMSEQS" createsubdb "${TMP_PATH}/clu_redundancy" "$INPUT" "${TMP_PATH}/input_step_redundancy" --subdb-mode 1 \
+        || fail "createsubdb died"
 fi
 
 INPUT="${TMP_PATH}/input_step_redundancy"
@@ -69,7 +69,7 @@ while [ "$STEP" -lt "$STEPS" ]; do
         fi
     else
         if notExists "$NEXTINPUT"; then
-            "$MMSEQS" createsubdb "${TMP_PATH}/clu_step$STEP" "$INPUT" "$NEXTINPUT" \
+            "$MMSEQS" createsubdb "${TMP_PATH}/clu_step$STEP" "$INPUT" "$NEXTINPUT" --subdb-mode 1 \
                 || fail "Order step $STEP died"
         fi
     fi
@@ -16,17 +16,11 @@ notExists() {
 
 INPUT="$1"
 if [ -n "$NUCL" ]; then
-    # 1. extract orf
-    if notExists "$2/orfs"; then
-        # shellcheck disable=SC2086
-        "$MMSEQS" extractorfs "$INPUT" "$2/orfs" $ORF_PAR \
-            || fail "extractorfs died"
-    fi
-
+    # 1. extract and translate orfs
     if notExists "$2/orfs_aa"; then
         # shellcheck disable=SC2086
-        "$MMSEQS" translatenucs "$2/orfs" "$2/orfs_aa" $TRANSLATE_PAR \
-            || fail "translatenucs died"
+        "$MMSEQS" extractorfs "$INPUT" "$2/orfs_aa" $ORF_PAR \
+            || fail "extractorfs died"
     fi
 
     # shellcheck disable=SC2086
@@ -35,8 +29,8 @@ if [ -n "$NUCL" ]; then
 
     if [ -n "$REMOVE_TMP" ]; then
         echo "Remove temporary files"
-        rm -f "$2/orfs" "$2/orfs.index" "$2/orfs.dbtype"
-        rm -f "$2/orfs_aa" "$2/orfs_aa.index" "$2/orfs_aa.dbtype"
+        rm -f "$2/orfs_aa" "$2/orfs_aa.index" "$2/orfs_aa.dbtype" "$2/orfs_aa.orf"
+        rm -f "$2/orfs_aa_h" "$2/orfs_aa_h.index"
         rm -f "$2/createindex.sh"
     fi
 else
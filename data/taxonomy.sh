@@ -16,7 +16,8 @@ notExists() {
 [ ! -f "$2" ] &&  echo "$2 not found!" && exit 1;
 [ ! -f "$3" ] &&  echo "$3 not found!" && exit 1;
 if [ -n "${LCA_PAR}" ]; then
-    if [ ! -f "$4/names.dmp" ] || [ ! -f "$4/nodes.dmp" ] || [ ! -f "$4/merged.dmp" ] || [ ! -f "$4/delnodes.dmp" ]; then
+    # either a binary taxonomy from createtaxdb or the NCBI taxdump directory
+    if [ ! -f "$4" ] && { [ ! -f "$4/names.dmp" ] || [ ! -f "$4/nodes.dmp" ] || [ ! -f "$4/merged.dmp" ] || [ ! -f "$4/delnodes.dmp" ]; }; then
         echo "Required NCBI Taxonomy files missing!"
         exit 1;
     fi
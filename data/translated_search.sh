@@ -21,35 +21,25 @@ QUERY="$1"
 QUERY_ORF="$1"
 
 if [ -n "$QUERY_NUCL" ]; then
-    if notExists "$4/q_orfs"; then
-        # shellcheck disable=SC2086
-        "$MMSEQS" extractorfs "$1" "$4/q_orfs" ${ORF_PAR} \
-            || fail  "extract orfs step died"
-    fi
     if notExists "$4/q_orfs_aa"; then
         # shellcheck disable=SC2086
-        "$MMSEQS" translatenucs "$4/q_orfs" "$4/q_orfs_aa" ${TRANSLATE_PAR} \
-            || fail  "translate step died"
+        "$MMSEQS" extractorfs "$1" "$4/q_orfs_aa" ${ORF_PAR} \
+            || fail  "extract orfs step died"
     fi
     QUERY="$4/q_orfs_aa"
-    QUERY_ORF="$4/q_orfs"
+    QUERY_ORF="$4/q_orfs_aa"
 fi
 
 TARGET="$2"
 TARGET_ORF="$2"
 if [ -n "$TARGET_NUCL" ]; then
-    if notExists "$4/t_orfs"; then
-        # shellcheck disable=SC2086
-        "$MMSEQS" extractorfs "$2" "$4/t_orfs" ${ORF_PAR} \
-            || fail  "extract target orfs step died"
-    fi
     if notExists "$4/t_orfs_aa"; then
         # shellcheck disable=SC2086
-        "$MMSEQS" translatenucs "$4/t_orfs" "$4/t_orfs_aa" ${TRANSLATE_PAR} \
-            || fail  "translate target step died"
+        "$MMSEQS" extractorfs "$2" "$4/t_orfs_aa" ${ORF_PAR} \
+            || fail  "extract target orfs step died"
     fi
     TARGET="$4/t_orfs_aa"
-    TARGET_ORF="$4/t_orfs"
+    TARGET_ORF="$4/t_orfs_aa"
 fi
 
 
@@ -67,10 +57,10 @@ fi
 
 if [ -n "$REMOVE_TMP" ]; then
   echo "Remove temporary files"
-  rm -f "$4/q_orfs"    "$4/q_orfs.index"    "$4/q_orfs.dbtype"
-  rm -f "$4/q_orfs_aa" "$4/q_orfs_aa.index" "$4/q_orfs_aa.dbtype"
-  rm -f "$4/t_orfs"    "$4/t_orfs.index"    "$4/t_orfs.dbtype"
-  rm -f "$4/t_orfs_aa" "$4/t_orfs_aa.index" "$4/t_orfs_aa.dbtype"
+  rm -f "$4/q_orfs_aa" "$4/q_orfs_aa.index" "$4/q_orfs_aa.dbtype" "$4/q_orfs_aa.orf"
+  rm -f "$4/q_orfs_aa_h" "$4/q_orfs_aa_h.index"
+  rm -f "$4/t_orfs_aa" "$4/t_orfs_aa.index" "$4/t_orfs_aa.dbtype" "$4/t_orfs_aa.orf"
+  rm -f "$4/t_orfs_aa_h" "$4/t_orfs_aa_h.index"
 fi
 
 
@@ -90,6 +90,8 @@ typedef __m512  simd_float;
 #define simdf32_min(x,y)    _mm512_min_ps(x,y)
 #define simdf32_load(x)     _mm512_load_ps(x)
 #define simdf32_store(x,y)  _mm512_store_ps(x,y)
+#define simdf32_loadu(x)    _mm512_loadu_ps(x)
+#define simdf32_storeu(x,y) _mm512_storeu_ps(x,y)
 #define simdf32_set(x)      _mm512_set1_ps(x)
 #define simdf32_setzero(x)  _mm512_setzero_ps()
 #define simdf32_gt(x,y)     _mm512_cmpnle_ps_mask(x,y)
@@ -144,6 +146,7 @@ typedef __m512i simd_int;
 #define simdi8_shiftl(x,y)  NOT_YET_IMP()
 #define simdi8_shiftr(x,y)  NOT_YET_IMP()
 #define simdi8_movemask(x)  NOT_YET_IMP()
+#define simdui8_sad(x,y)    NOT_YET_IMP()
 #define simdi16_extract(x,y) NOT_YET_IMP()
 #define simdi16_slli(x,y)	_mm512_slli_epi16(x,y) // shift integers in a left by y
 #define simdi16_srli(x,y)	_mm512_srli_epi16(x,y) // shift integers in a right by y
@@ -215,6 +218,7 @@ typedef __m256i simd_int;
 //TODO fix like shift_left
 #define simdi8_shiftr(x,y)  _mm256_srli_si256(x,y)
 #define simdi8_movemask(x)  _mm256_movemask_epi8(x)
+#define simdui8_sad(x,y)    _mm256_sad_epu8(x,y) // sum of absolute differences of 8 bytes each into 64 bit
 #define simdi16_extract(x,y) extract_epi16(x,y)
 #define simdi16_slli(x,y)	_mm256_slli_epi16(x,y) // shift integers in a left by y
 #define simdi16_srli(x,y)	_mm256_srli_epi16(x,y) // shift integers in a right by y
@@ -264,6 +268,8 @@ typedef __m256 simd_float;
 #define simdf32_min(x,y)    _mm256_min_ps(x,y)
 #define simdf32_load(x)     _mm256_load_ps(x)
 #define simdf32_store(x,y)  _mm256_store_ps(x,y)
+#define simdf32_loadu(x)    _mm256_loadu_ps(x)
+#define simdf32_storeu(x,y) _mm256_storeu_ps(x,y)
 #define simdf32_set(x)      _mm256_set1_ps(x)
 #define simdf32_setzero(x)  _mm256_setzero_ps()
 #define simdf32_gt(x,y)     _mm256_cmp_ps(x,y,_CMP_GT_OS)
@@ -321,6 +327,8 @@ typedef __m128  simd_float;
 #define simdf32_min(x,y)    _mm_min_ps(x,y)
 #define simdf32_load(x)     _mm_load_ps(x)
 #define simdf32_store(x,y)  _mm_store_ps(x,y)
+#define simdf32_loadu(x)    _mm_loadu_ps(x)
+#define simdf32_storeu(x,y) _mm_storeu_ps(x,y)
 #define simdf32_set(x)      _mm_set1_ps(x)
 #define simdf32_setzero(x)  _mm_setzero_ps()
 #define simdf32_gt(x,y)     _mm_cmpgt_ps(x,y)
@@ -380,6 +388,7 @@ typedef __m128i simd_int;
 #define simdi8_shiftl(x,y)  _mm_slli_si128(x,y)
 #define simdi8_shiftr(x,y)  _mm_srli_si128(x,y)
 #define simdi8_movemask(x)  _mm_movemask_epi8(x)
+#define simdui8_sad(x,y)    _mm_sad_epu8(x,y) // sum of absolute differences of 8 bytes each into 64 bit
 #define simdi16_extract(x,y) extract_epi16(x,y)
 #define simdi16_slli(x,y)	_mm_slli_epi16(x,y) // shift integers in a left by y
 #define simdi16_srli(x,y)	_mm_srli_epi16(x,y) // shift integers in a right by y
@@ -10,6 +10,7 @@
 #include "SubstitutionMatrix.h"
 #include "PrefilteringIndexReader.h"
 #include "FileUtil.h"
+#include "Checkpoint.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -23,7 +24,8 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &querySeqD
 
         covThr(par.covThr), covMode(par.covMode), seqIdMode(par.seqIdMode), evalThr(par.evalThr), seqIdThr(par.seqIdThr),
         includeIdentity(par.includeIdentity), addBacktrace(par.addBacktrace), realign(par.realign), scoreBias(par.scoreBias),
-        threads(static_cast<unsigned int>(par.threads)), outDB(outDB), outDBIndex(outDBIndex),
+        threads(static_cast<unsigned int>(par.threads)), mpiChunks(static_cast<size_t>(par.mpiChunks)),
+        checkpointChunks(static_cast<size_t>(par.checkpointChunks)), outDB(outDB), outDBIndex(outDBIndex),
         maxSeqLen(par.maxSeqLen), compBiasCorrection(par.compBiasCorrection), altAlignment(par.altAlignment), qdbr(NULL), qSeqLookup(NULL),
         tdbr(NULL), tidxdbr(NULL), tSeqLookup(NULL), templateDBIsIndex(false) {
 
@@ -248,12 +250,41 @@ void Alignment::run(const unsigned int mpiRank, const unsigned int mpiNumProc,
 
     size_t dbFrom = 0;
     size_t dbSize = 0;
-    Util::decomposeDomainByAminoAcid(prefdbr->getAminoAcidDBSize(), prefdbr->getSeqLens(),
-                                     prefdbr->getSize(), mpiRank, mpiNumProc, &dbFrom, &dbSize);
-
-    Debug(Debug::INFO) << "Compute split from " << dbFrom << " to " << (dbFrom + dbSize) << "\n";
     std::pair<std::string, std::string> tmpOutput = Util::createTmpFileNames(outDB, outDBIndex, mpiRank);
-    run(tmpOutput.first, tmpOutput.second, dbFrom, dbSize, maxAlnNum, maxRejected);
+    if (checkpointChunks > 0) {
+        Debug(Debug::WARNING) << "Checkpoints are not supported for MPI alignments, the chunks are not recorded.\n";
+    }
+    if (mpiChunks > 0) {
+        // ranks request the next chunk from the master when they are done, so faster ranks align more queries
+        std::vector<std::pair<std::string, std::string> > chunkFiles;
+        {
+            MPIWorkQueue queue(mpiChunks);
+            size_t chunk;
+            while (queue.next(&chunk)) {
+                Util::decomposeDomainByAminoAcid(prefdbr->getAminoAcidDBSize(), prefdbr->getSeqLens(),
+                                                 prefdbr->getSize(), chunk, mpiChunks, &dbFrom, &dbSize);
+                Debug(Debug::INFO) << "Compute chunk " << (chunk + 1) << " of " << mpiChunks
+                                   << " from " << dbFrom << " to " << (dbFrom + dbSize) << "\n";
+                chunkFiles.push_back(Util::createTmpFileNames(tmpOutput.first, tmpOutput.second, chunk));
+                run(chunkFiles.back().first, chunkFiles.back().second, dbFrom, dbSize, maxAlnNum, maxRejected);
+            }
+        }
+
+        if (chunkFiles.size() > 0) {
+            DBWriter::mergeResults(tmpOutput.first, tmpOutput.second, chunkFiles);
+        } else {
+            // the master merges one result per rank
+            DBWriter emptyWriter(tmpOutput.first.c_str(), tmpOutput.second.c_str(), 1);
+            emptyWriter.open();
+            emptyWriter.close();
+        }
+    } else {
+        Util::decomposeDomainByAminoAcid(prefdbr->getAminoAcidDBSize(), prefdbr->getSeqLens(),
+                                         prefdbr->getSize(), mpiRank, mpiNumProc, &dbFrom, &dbSize);
+
+        Debug(Debug::INFO) << "Compute split from " << dbFrom << " to " << (dbFrom + dbSize) << "\n";
+        run(tmpOutput.first, tmpOutput.second, dbFrom, dbSize, maxAlnNum, maxRejected);
+    }
 
 #ifdef HAVE_MPI
     MPI_Barrier(MPI_COMM_WORLD);
@@ -271,7 +302,36 @@ void Alignment::run(const unsigned int mpiRank, const unsigned int mpiNumProc,
 }
 
 void Alignment::run(const unsigned int maxAlnNum, const unsigned int maxRejected) {
-    run(outDB, outDBIndex, 0, prefdbr->getSize(), maxAlnNum, maxRejected);
+    if (checkpointChunks == 0) {
+        run(outDB, outDBIndex, 0, prefdbr->getSize(), maxAlnNum, maxRejected);
+        return;
+    }
+
+    // every finished chunk is recorded in the checkpoint, a restarted run computes only the missing ones
+    std::string settings = "align " + SSTR(checkpointChunks) + " " + SSTR(prefdbr->getSize()) + " "
+                           + SSTR(prefdbr->getAminoAcidDBSize()) + " " + SSTR(maxAlnNum) + " " + SSTR(maxRejected) + " "
+                           + SSTR(swMode) + " " + SSTR(evalThr) + " " + SSTR(covThr) + " " + SSTR(covMode) + " "
+                           + SSTR(seqIdThr) + " " + SSTR(static_cast<int>(addBacktrace)) + " " + SSTR(altAlignment);
+    Checkpoint checkpoint(outDB, settings);
+    std::vector<std::pair<std::string, std::string> > chunkFiles;
+    for (size_t chunk = 0; chunk < checkpointChunks; chunk++) {
+        chunkFiles.push_back(Util::createTmpFileNames(outDB, outDBIndex, chunk));
+        if (checkpoint.isDone(chunk, chunkFiles.back())) {
+            Debug(Debug::INFO) << "Alignment chunk " << (chunk + 1) << " of " << checkpointChunks << " is already done\n";
+            continue;
+        }
+        size_t dbFrom = 0;
+        size_t dbSize = 0;
+        Util::decomposeDomainByAminoAcid(prefdbr->getAminoAcidDBSize(), prefdbr->getSeqLens(),
+                                         prefdbr->getSize(), chunk, checkpointChunks, &dbFrom, &dbSize);
+        Debug(Debug::INFO) << "Compute chunk " << (chunk + 1) << " of " << checkpointChunks
+                           << " from " << dbFrom << " to " << (dbFrom + dbSize) << "\n";
+        run(chunkFiles.back().first, chunkFiles.back().second, dbFrom, dbSize, maxAlnNum, maxRejected);
+        checkpoint.commit(chunk, chunkFiles.back());
+    }
+
+    DBWriter::mergeResults(outDB, outDBIndex, chunkFiles);
+    checkpoint.remove();
 }
 
 void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
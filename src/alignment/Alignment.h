@@ -68,6 +68,12 @@ private:
     unsigned int swMode;
     unsigned int threads;
 
+    // number of query chunks MPI ranks request from the master, 0 for a fixed share per rank
+    const size_t mpiChunks;
+
+    // number of query chunks recorded in a checkpoint, 0 to write the result in one piece
+    const size_t checkpointChunks;
+
     const std::string outDB;
     const std::string outDBIndex;
 
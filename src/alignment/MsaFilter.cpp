@@ -9,6 +9,17 @@
 #include "MathUtil.h"
 #include "MultipleAlignment.h"
 
+// sums up the unsigned bytes of a vector
+static inline int horizontalSumBytes(simd_int vec) {
+    uint64_t sums[VECSIZE_INT / 2];
+    simdi_storeu((simd_int *) sums, simdui8_sad(vec, simdi_setzero()));
+    int sum = 0;
+    for (size_t i = 0; i < VECSIZE_INT / 2; ++i) {
+        sum += static_cast<int>(sums[i]);
+    }
+    return sum;
+}
+
 MsaFilter::MsaFilter(int maxSeqLen, int maxSetSize, SubstitutionMatrix *m){
     this->m = m;
     this->maxSeqLen = maxSeqLen;
@@ -25,9 +36,13 @@ MsaFilter::MsaFilter(int maxSeqLen, int maxSetSize, SubstitutionMatrix *m){
     this->ksort = new int[maxSetSize];
     this->display = new char[maxSetSize + 2];
     this->keep = new char[maxSetSize];
+    this->sortedX = NULL;
+    this->sortedXStride = 0;
+    this->sortedXCapacity = 0;
 }
 
 MsaFilter::~MsaFilter() {
+    free(sortedX);
     delete [] keep;
     delete [] Nmax;
     delete [] idmaxwin;
@@ -261,6 +276,19 @@ void MsaFilter::filter(const int N_in, const int L, const int coverage, const in
         return;
     }
 
+    // Copy the sequences in ksort order into one contiguous buffer, the pairwise comparison
+    // below then walks through memory linearly instead of jumping between separate allocations.
+    // Only the vectors covering columns 0 to L-1 are ever compared.
+    sortedXStride = ((L + VECSIZE_INT * 4 - 1) / (VECSIZE_INT * 4)) * (VECSIZE_INT * 4);
+    if (sortedXCapacity < N_in * sortedXStride) {
+        free(sortedX);
+        sortedXCapacity = N_in * sortedXStride;
+        sortedX = (char *) malloc_simd_int(sortedXCapacity);
+    }
+    for (kk = 0; kk < N_in; ++kk) {
+        memcpy(sortedX + kk * sortedXStride, X[ksort[kk]], sortedXStride);
+    }
+
     // Successively increment idmax[i] at positons where N[i]<Ndiff
     seqid = seqid1;
     while (seqid <= max_seqid) {
@@ -346,8 +374,8 @@ void MsaFilter::filter(const int N_in, const int L, const int coverage, const in
                 cov_kj = last_kj - first_kj + 1;
                 diff_suff = int(diff_min_frac * std::min(nres[k], cov_kj) + 0.999);  // nres[j]>nres[k] anyway because of sorting
                 diff = 0;
-                const simd_int * XK = (simd_int *) X[k];
-                const simd_int * XJ = (simd_int *) X[j];
+                const simd_int * XK = (simd_int *) (sortedX + kk * sortedXStride);
+                const simd_int * XJ = (simd_int *) (sortedX + jj * sortedXStride);
                 const int first_kj_simd = first_kj / (VECSIZE_INT * 4);
                 const int last_kj_simd = last_kj / (VECSIZE_INT * 4) + 1;
                 // coverage correction for simd
@@ -362,34 +390,38 @@ void MsaFilter::filter(const int N_in, const int L, const int coverage, const in
 
                 // _mm_set1_epi8 pseudo-instruction is slow!
                 const simd_int NAAx16 = simdi8_set(MultipleAlignment::NAA - 1);
-                for (int i = first_kj_simd; i < last_kj_simd && diff < diff_suff; ++i) {
-                    // None SIMD function
-                    // enough different residues to accept? => break
-                    // if (X[k][i] >= NAA || X[j][i] >= NAA)
-                    //    cov_kj--;
-                    // else if (X[k][i] != X[j][i] && ++diff >= diff_suff)
-                    //    break; // accept (k,j)
-
-                    const simd_int NO_AA_K = simdi8_gt(XK[i], NAAx16);  // pos without amino acid in seq k
-                    const simd_int NO_AA_J = simdi8_gt(XJ[i], NAAx16);  // pos without amino acid in seq j
-
-                    // Compute 16 bits indicating positions with GAP, ANY or ENDGAP in seq k or j
-                    // int _mm_movemask_epi8(__m128i a) creates 16-bit mask from most significant bits of
-                    // the 16 signed or unsigned 8-bit integers in a and zero-extends the upper bits.
-                    int res = simdi8_movemask(simdi_or(NO_AA_K, NO_AA_J));
-//                    for (int u = 0; u < 32; ++u) {
-//                        printf("%02d:%02d ", (int) ((char*)&XK[i])[u], (int) ((char*)&XK[i])[u]);
-//                    }
-//                    std::cout << std::endl;
-                    cov_kj -= MathUtil::popCount(res);  // subtract positions that should not contribute to coverage
-
-                    // Compute 16 bit mask that indicates positions where k and j have identical residues
-                    int c = simdi8_movemask(simdi8_eq(XK[i], XJ[i]));
-
-                    // Count positions where  k and j have different amino acids, which is equal to 16 minus the
-                    //  number of positions for which either j and k are equal or which contain ANY, GAP, or ENDGAP
-                    diff += (VECSIZE_INT * 4) - MathUtil::popCount(c | res);
-
+                const simd_int ONEx16 = simdi8_set(1);
+                // None SIMD function
+                // enough different residues to accept? => break
+                // if (X[k][i] >= NAA || X[j][i] >= NAA)
+                //    cov_kj--;
+                // else if (X[k][i] != X[j][i] && ++diff >= diff_suff)
+                //    break; // accept (k,j)
+                //
+                // Identical and non amino acid positions are counted per byte lane over blocks of
+                // DIFF_CHECK_VECS vectors and summed up with a SAD, diff is checked once per block.
+                // Counting past diff_suff does not change the result, since k is accepted for j either way
+                // and cov_kj is only used if all positions were compared.
+                int i = first_kj_simd;
+                while (i < last_kj_simd && diff < diff_suff) {
+                    const int blockEnd = std::min(i + DIFF_CHECK_VECS, last_kj_simd);
+                    const int blockVecs = blockEnd - i;
+                    simd_int sameCnt = simdi_setzero();
+                    simd_int noAaCnt = simdi_setzero();
+                    for (; i < blockEnd; ++i) {
+                        // positions with GAP, ANY or ENDGAP in seq k or j
+                        const simd_int noAa = simdi_or(simdi8_gt(XK[i], NAAx16), simdi8_gt(XJ[i], NAAx16));
+                        // positions where k and j are identical or which contain ANY, GAP or ENDGAP
+                        const simd_int same = simdi_or(simdi8_eq(XK[i], XJ[i]), noAa);
+                        sameCnt = simdui8_adds(sameCnt, simdi_and(same, ONEx16));
+                        noAaCnt = simdui8_adds(noAaCnt, simdi_and(noAa, ONEx16));
+                    }
+                    const int sameSum = horizontalSumBytes(sameCnt);
+                    const int noAaSum = horizontalSumBytes(noAaCnt);
+                    // subtract positions that should not contribute to coverage
+                    cov_kj -= noAaSum;
+                    // Count positions where  k and j have different amino acids
+                    diff += blockVecs * (VECSIZE_INT * 4) - sameSum;
                 }
 //            // DEBUG
 //            printf("%20.20s with %20.20s:  diff=%i  diff_min_frac*cov_kj=%f  diff_suff=%i  nres=%i  cov_kj=%i\n",sname[k],sname[j],diff,diff_min_frac*cov_kj,diff_suff,nres[k],cov_kj);
@@ -48,6 +48,7 @@ public:
     const int GAP=21;       //number representing a gap internally
     const float PLTY_GAPOPEN=6.0f; // for -qsc option (filter for min similarity to query): 6 bits to open gap
     const float PLTY_GAPEXTD=1.0f; // for -qsc option (filter for min similarity to query): 1 bit to extend gap
+    const int DIFF_CHECK_VECS=4; // number of vectors compared between checks of the pairwise difference
 
     void pruneAlignment(char ** msaSequence, int N_in, int L);
 	
@@ -83,6 +84,10 @@ private:
     char* display;
     // keep[k]=1 if sequence is included in amino acid frequencies; 0 otherwise (first=0)
     char *keep;
+    // sequences in ksort order, each padded to sortedXStride
+    char *sortedX;
+    size_t sortedXStride;
+    size_t sortedXCapacity;
 };
 
 
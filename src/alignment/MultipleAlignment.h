@@ -53,6 +53,9 @@ public:
 
     MSAResult computeMSA(Sequence *pSequence, std::vector<Sequence *> vector, std::vector<Matcher::result_t> vector1,
                          bool i);
+    // align all sequences against the center sequence
+    std::vector<Matcher::result_t> computeBacktrace(Sequence *center, std::vector<Sequence *> sequences);
+
     // clean memory for MSA
     static void deleteMSA(MultipleAlignment::MSAResult * res);
 	
@@ -66,8 +69,6 @@ private:
     size_t maxMsaSeqLen;
     unsigned int * queryGaps;
 
-    std::vector<Matcher::result_t> computeBacktrace(Sequence *center, std::vector<Sequence *> sequences);
-
     void computeQueryGaps(unsigned int *queryGaps, Sequence *center, std::vector<Sequence *> seqs,
                           std::vector<Matcher::result_t> alignmentResults);
 
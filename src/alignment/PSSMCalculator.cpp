@@ -10,6 +10,8 @@
 #include "Debug.h"
 #include "MultipleAlignment.h"
 
+#include <climits>
+
 PSSMCalculator::PSSMCalculator(SubstitutionMatrix *subMat, size_t maxSeqLength, size_t maxSetSize, float pca, float pcb) :
         subMat(subMat)
 {
@@ -28,6 +30,9 @@ PSSMCalculator::PSSMCalculator(SubstitutionMatrix *subMat, size_t maxSeqLength,
     }
     wi = new float[maxSetSize];
     naa = new int[maxSeqLength];
+    columnCounts = new int[Sequence::PROFILE_AA_SIZE * maxSeqLength];
+    numberRes = new unsigned int[maxSetSize];
+    alignedRow = new char[maxSeqLength];
     this->pca = pca;
     this->pcb = pcb;
 
@@ -47,6 +52,9 @@ PSSMCalculator::~PSSMCalculator() {
     delete [] w_contrib;
     delete [] wi;
     delete [] naa;
+    delete [] columnCounts;
+    delete [] numberRes;
+    delete [] alignedRow;
 }
 
 PSSMCalculator::Profile PSSMCalculator::computePSSMFromMSA(size_t setSize,
@@ -65,6 +73,134 @@ PSSMCalculator::Profile PSSMCalculator::computePSSMFromMSA(size_t setSize,
         // compute NEFF_M
         computeNeff_M(matchWeight, seqWeight, Neff_M, queryLength, setSize, msaSeqs);
     }
+    return computePSSMFromMatchWeights(queryLength);
+}
+
+PSSMCalculator::Profile PSSMCalculator::computePSSMFromAlignments(Sequence *centerSeq,
+                                                                  const std::vector<Sequence *> &seqs,
+                                                                  const std::vector<Matcher::result_t> &alnResults) {
+    if (seqs.size() != alnResults.size()) {
+        Debug(Debug::ERROR) << "seqs.size (" << seqs.size() << ") is != alnResults.size (" << alnResults.size() << ")\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // the center sequence is the first row and covers every column
+    const size_t queryLength = centerSeq->L;
+    const size_t setSize = seqs.size() + 1;
+
+    // count residues per sequence and amino acids per column
+    memset(columnCounts, 0, Sequence::PROFILE_AA_SIZE * queryLength * sizeof(int));
+    numberRes[0] = queryLength;
+    for (size_t pos = 0; pos < queryLength; pos++) {
+        const unsigned int aa = centerSeq->int_sequence[pos];
+        if (aa < Sequence::PROFILE_AA_SIZE) {
+            columnCounts[pos * Sequence::PROFILE_AA_SIZE + aa]++;
+        }
+    }
+    for (size_t k = 1; k < setSize; ++k) {
+        size_t start, end;
+        mapToCenterColumns(alnResults[k - 1], seqs[k - 1], alignedRow, &start, &end);
+        unsigned int nr = 0;
+        for (size_t pos = start; pos < end; pos++) {
+            if (alignedRow[pos] != MultipleAlignment::GAP) {
+                nr++;
+                const unsigned int aa = alignedRow[pos];
+                if (aa < Sequence::PROFILE_AA_SIZE) {
+                    columnCounts[pos * Sequence::PROFILE_AA_SIZE + aa]++;
+                }
+            }
+        }
+        numberRes[k] = nr;
+    }
+    for (size_t pos = 0; pos < queryLength; pos++) {
+        int distinct_aa_count = 0;
+        for (size_t aa = 0; aa < Sequence::PROFILE_AA_SIZE; ++aa) {
+            if (columnCounts[pos * Sequence::PROFILE_AA_SIZE + aa]) {
+                ++distinct_aa_count;
+            }
+        }
+        naa[pos] = distinct_aa_count;
+    }
+
+    // sequence weights as in computeSequenceWeights, every sequence accumulates its columns in order
+    std::fill(seqWeight, seqWeight + setSize,  1e-6);
+    for (size_t k = 0; k < setSize; ++k) {
+        size_t start = 0;
+        size_t end = queryLength;
+        const char *row = NULL;
+        if (k > 0) {
+            mapToCenterColumns(alnResults[k - 1], seqs[k - 1], alignedRow, &start, &end);
+            row = alignedRow;
+        }
+        for (size_t pos = start; pos < end; pos++) {
+            const unsigned int aa = (row == NULL) ? centerSeq->int_sequence[pos] : row[pos];
+            if (aa == MultipleAlignment::GAP || naa[pos] == 0 || aa >= Sequence::PROFILE_AA_SIZE) {
+                continue;
+            }
+            const int nl = columnCounts[pos * Sequence::PROFILE_AA_SIZE + aa];
+            seqWeight[k] += 1.0f / (float(nl) * float(naa[pos]) * (float(numberRes[k]) + 30.0f));
+        }
+    }
+    MathUtil::NormalizeTo1(seqWeight, setSize);
+
+    // matchWeight and the summed weight per column (w_M, kept in Neff_M) from the global weights
+    memset(matchWeight, 0, Sequence::PROFILE_AA_SIZE * queryLength * sizeof(float));
+    std::fill(Neff_M, Neff_M + queryLength, static_cast<float>(-1.0 / setSize));
+    for (size_t k = 0; k < setSize; ++k) {
+        size_t start = 0;
+        size_t end = queryLength;
+        const char *row = NULL;
+        if (k > 0) {
+            mapToCenterColumns(alnResults[k - 1], seqs[k - 1], alignedRow, &start, &end);
+            row = alignedRow;
+        }
+        for (size_t pos = start; pos < end; pos++) {
+            const unsigned int aa = (row == NULL) ? centerSeq->int_sequence[pos] : row[pos];
+            if (aa == MultipleAlignment::GAP) {
+                continue;
+            }
+            if (aa < Sequence::PROFILE_AA_SIZE) {
+                matchWeight[pos * Sequence::PROFILE_AA_SIZE + aa] += seqWeight[k];
+            }
+            Neff_M[pos] += seqWeight[k];
+        }
+    }
+    for (size_t pos = 0; pos < queryLength; pos++) {
+        MathUtil::NormalizeTo1(&matchWeight[pos * Sequence::PROFILE_AA_SIZE], Sequence::PROFILE_AA_SIZE, subMat->pBack);
+    }
+    computeNeff_MFromColumnWeights(matchWeight, Neff_M, queryLength);
+
+    return computePSSMFromMatchWeights(queryLength);
+}
+
+void PSSMCalculator::mapToCenterColumns(const Matcher::result_t &res, const Sequence *seq, char *row,
+                                        size_t *start, size_t *end) {
+    *start = 0;
+    *end = 0;
+    // score was 0 and sequence was rejected
+    if (static_cast<unsigned int>(res.dbStartPos) == UINT_MAX) {
+        return;
+    }
+    unsigned int queryPos = res.qStartPos;
+    unsigned int targetPos = res.dbStartPos;
+    for (size_t alnPos = 0; alnPos < res.backtrace.size(); alnPos++) {
+        const char state = res.backtrace[alnPos];
+        if (state == 'M') {
+            row[queryPos] = static_cast<char>(seq->int_sequence[targetPos]);
+            queryPos++;
+            targetPos++;
+        } else if (state == 'I') {
+            row[queryPos] = MultipleAlignment::GAP;
+            queryPos++;
+        } else {
+            // deletions are not part of the center sequence columns
+            targetPos++;
+        }
+    }
+    *start = res.qStartPos;
+    *end = queryPos;
+}
+
+PSSMCalculator::Profile PSSMCalculator::computePSSMFromMatchWeights(size_t queryLength) {
     // compute consensus sequence
     std::string consensusSequence = computeConsensusSequence(matchWeight, queryLength, subMat->pBack, subMat->int2aa);
     if(pca > 0.0){
@@ -140,15 +276,54 @@ void PSSMCalculator::computeLogPSSM(char *pssm, const float *profile, float bitF
 
 void PSSMCalculator::preparePseudoCounts(float *frequency, float *frequency_with_pseudocounts, size_t entrySize,
                                          size_t queryLength, float const ** R) {
+    // frequency_with_pseudocounts[pos][aa] = sum_b R[aa][b] * frequency[pos][b]
+    // R is stored transposed (column b of R is row b of Rt) so each frequency[pos][b] is
+    // broadcast and accumulated for VECSIZE_FLOAT amino acids at once
+    const size_t PADDED_AA_SIZE = ((Sequence::PROFILE_AA_SIZE + VECSIZE_FLOAT - 1) / VECSIZE_FLOAT) * VECSIZE_FLOAT;
+    const size_t AA_VECS = PADDED_AA_SIZE / VECSIZE_FLOAT;
+    float __attribute__((aligned(ALIGN_FLOAT))) Rt[Sequence::PROFILE_AA_SIZE * PADDED_AA_SIZE];
+    float __attribute__((aligned(ALIGN_FLOAT))) res[PADDED_AA_SIZE];
+    for (size_t b = 0; b < Sequence::PROFILE_AA_SIZE; b++) {
+        for (size_t aa = 0; aa < PADDED_AA_SIZE; aa++) {
+            Rt[b * PADDED_AA_SIZE + aa] = (aa < Sequence::PROFILE_AA_SIZE) ? R[aa][b] : 0.0f;
+        }
+    }
     for (size_t pos = 0; pos < queryLength; pos++) {
-        for (size_t aa = 0; aa < Sequence::PROFILE_AA_SIZE; aa++) {
-            frequency_with_pseudocounts[pos * entrySize + aa] = ScalarProd20(R[aa],
-                                                                             &frequency[pos * entrySize]);
+        const float *freq = &frequency[pos * entrySize];
+        simd_float acc[AA_VECS];
+        for (size_t v = 0; v < AA_VECS; v++) {
+            acc[v] = simdf32_setzero();
+        }
+        for (size_t b = 0; b < Sequence::PROFILE_AA_SIZE; b++) {
+            const simd_float freqB = simdf32_set(freq[b]);
+            const float *Rb = &Rt[b * PADDED_AA_SIZE];
+            for (size_t v = 0; v < AA_VECS; v++) {
+                acc[v] = simdf32_add(acc[v], simdf32_mul(simdf32_load(Rb + v * VECSIZE_FLOAT), freqB));
+            }
         }
+        for (size_t v = 0; v < AA_VECS; v++) {
+            simdf32_store(res + v * VECSIZE_FLOAT, acc[v]);
+        }
+        memcpy(&frequency_with_pseudocounts[pos * entrySize], res, Sequence::PROFILE_AA_SIZE * sizeof(float));
     }
 }
+
 void PSSMCalculator::computeNeff_M(float *frequency, float *seqWeight, float *Neff_M,
                                    size_t queryLength, size_t setSize, char const **msaSeqs) {
+    // sum the weights of all sequences with a residue per column, go row by row through the MSA
+    // every column still accumulates the sequences in order
+    std::fill(Neff_M, Neff_M + queryLength, static_cast<float>(-1.0 / setSize));
+    for (size_t k = 0; k < setSize; ++k) {
+        const char *row = msaSeqs[k];
+        const float w = seqWeight[k];
+        for (size_t pos = 0; pos < queryLength; pos++) {
+            Neff_M[pos] += (row[pos] != MultipleAlignment::GAP) ? w : 0.0f;
+        }
+    }
+    computeNeff_MFromColumnWeights(frequency, Neff_M, queryLength);
+}
+
+void PSSMCalculator::computeNeff_MFromColumnWeights(float *frequency, float *Neff_M, size_t queryLength) {
     float Neff_HMM = 0.0f;
     for (size_t pos = 0; pos < queryLength; pos++) {
         float sum = 0.0f;
@@ -164,12 +339,7 @@ void PSSMCalculator::computeNeff_M(float *frequency, float *seqWeight, float *Ne
     float Nlim = fmax(10.0, Neff_HMM + 1.0);    // limiting Neff
     float scale = MathUtil::flog2((Nlim - Neff_HMM) / (Nlim - 1.0));  // for calculating Neff for those seqs with inserts at specific pos
     for (size_t pos = 0; pos < queryLength; pos++) {
-        float w_M = -1.0 / setSize;
-        for (size_t k = 0; k < setSize; ++k){
-            if ( msaSeqs[k][pos] != MultipleAlignment::GAP) {
-                w_M += seqWeight[k];
-            }
-        }
+        const float w_M = Neff_M[pos];
         Neff_M[pos] = (w_M < 0) ? 1.0 : Nlim - (Nlim - 1.0) * MathUtil::fpow2(scale * w_M);
 //        fprintf(stderr,"M  i=%3i  ncol=---  Neff_M=%5.2f  Nlim=%5.2f  w_M=%5.3f  Neff_M=%5.2f\n",pos,Neff_HMM,Nlim,w_M,Neff_M[pos]);
     }
@@ -178,66 +348,63 @@ void PSSMCalculator::computeNeff_M(float *frequency, float *seqWeight, float *Ne
 void PSSMCalculator::computeSequenceWeights(float *seqWeight, size_t queryLength,
                                             size_t setSize, const char **msaSeqs) {
     unsigned int *number_res = new unsigned int[setSize];
+    //nl[pos][a] = number of seq's with amino acid a at position pos
+    int *nl = new int[queryLength * Sequence::PROFILE_AA_SIZE];
+    memset(nl, 0, queryLength * Sequence::PROFILE_AA_SIZE * sizeof(int));
+    //number of different amino acids per position (ignore X)
+    int *distinct_aa_count = new int[queryLength];
     // initialized wg[k] with tiny pseudo counts
     std::fill(seqWeight, seqWeight + setSize,  1e-6);
-    // count number of residues per sequence
-    for (size_t k = 0; k < setSize; ++k)
-    {
-        unsigned int nr = 0;
-        for (size_t pos = 0; pos < queryLength; pos++) {
-            if (msaSeqs[k][pos] != MultipleAlignment::GAP) {
-                nr++;
+    // count number of residues per sequence and amino acids per column
+    // the MSA is stored row wise so both are collected in one pass over each row
+    const size_t vecSize = VECSIZE_INT * 4;
+    const simd_int gapVec = simdi8_set(MultipleAlignment::GAP);
+    for (size_t k = 0; k < setSize; ++k) {
+        const char *row = msaSeqs[k];
+        unsigned int gaps = 0;
+        size_t pos = 0;
+        for (; pos + vecSize <= queryLength; pos += vecSize) {
+            const simd_int seq = simdi_loadu((const simd_int *) (row + pos));
+            gaps += MathUtil::popCount(simdi8_movemask(simdi8_eq(seq, gapVec)));
+        }
+        for (; pos < queryLength; pos++) {
+            gaps += (row[pos] == MultipleAlignment::GAP);
+        }
+        number_res[k] = queryLength - gaps;
+        for (pos = 0; pos < queryLength; pos++) {
+            const unsigned int aa_pos = row[pos];
+            if (aa_pos < Sequence::PROFILE_AA_SIZE) {
+                nl[pos * Sequence::PROFILE_AA_SIZE + aa_pos]++;
             }
         }
-        number_res[k] = nr;
     }
     for (size_t pos = 0; pos < queryLength; pos++) {
-        int nl[ Sequence::PROFILE_AA_SIZE ];  //nl[a] = number of seq's with amino acid a at position l
-        //number of different amino acids (ignore X)
-        std::fill(nl, nl + Sequence::PROFILE_AA_SIZE,  0);
-        for (size_t k = 0; k < setSize; ++k) {
-            if (msaSeqs[k][pos] != MultipleAlignment::GAP) {
-                const unsigned int aa_pos = msaSeqs[k][pos];
-                if(aa_pos < Sequence::PROFILE_AA_SIZE){
-                    nl[aa_pos]++;
-                }
-            }
-        }
-        //count distinct amino acids (ignore X)
-        int distinct_aa_count = 0;
+        int distinct = 0;
         for (size_t aa = 0; aa < Sequence::PROFILE_AA_SIZE; ++aa) {
-            if (nl[aa]) {
-                ++distinct_aa_count;
+            if (nl[pos * Sequence::PROFILE_AA_SIZE + aa]) {
+                ++distinct;
             }
         }
-//        if(distinct_aa_count == 0){
-//            Debug(Debug::ERROR) << "Error in computeSequenceWeights. Distinct amino acid count is 0.\n";
-//            EXIT(EXIT_FAILURE);
-//        }
-        // Compute sequence Weight
-        // "Position-based Sequence Weights", Henikoff (1994)
-        for (size_t k = 0; k < setSize; ++k) {
-            if (msaSeqs[k][pos] != MultipleAlignment::GAP) {
-                if(distinct_aa_count == 0){
-                    seqWeight[k] += 0.0;
-                } else {
-                    const unsigned int aa_pos = msaSeqs[k][pos];
-//                    std::cout << "k="<< k << "\t";
-                    if(aa_pos < Sequence::PROFILE_AA_SIZE){ // Treat score of X with other amino acid as 0.0
-                        seqWeight[k] += 1.0f / (float(nl[aa_pos]) * float(distinct_aa_count) * (float(number_res[k]) + 30.0f));
-//                        std::cout << number_res[k] << "\t" << distinct_aa_count << "\t" <<  nl[aa_pos] << "\t";
-                    }
-                }
-                // ensure that each residue of a short sequence contributes as much as a residue of a long sequence:
-                // contribution is proportional to one over sequence length nres[k] plus 30.
+        distinct_aa_count[pos] = distinct;
+    }
+    // Compute sequence Weight
+    // "Position-based Sequence Weights", Henikoff (1994)
+    // ensure that each residue of a short sequence contributes as much as a residue of a long sequence:
+    // contribution is proportional to one over sequence length nres[k] plus 30.
+    for (size_t k = 0; k < setSize; ++k) {
+        const char *row = msaSeqs[k];
+        const float nres = float(number_res[k]) + 30.0f;
+        for (size_t pos = 0; pos < queryLength; pos++) {
+            const unsigned int aa_pos = row[pos];
+            // Treat score of X with other amino acid as 0.0
+            // a column with a residue of sequence k has at least one distinct amino acid
+            if (aa_pos < Sequence::PROFILE_AA_SIZE) {
+                seqWeight[k] += 1.0f / (float(nl[pos * Sequence::PROFILE_AA_SIZE + aa_pos]) * float(distinct_aa_count[pos]) * nres);
             }
         }
     }
-//    std::cout << setSize << std::endl;
-//    std::cout << " Seq. Weight: " << std::endl;
-//    for (size_t k = 0; k < setSize; ++k) {
-//        std::cout << " k="<< k << "\t" << seqWeight[k] << std::endl;
-//    }
+    delete [] distinct_aa_count;
+    delete [] nl;
     delete [] number_res;
 }
 
@@ -246,34 +413,41 @@ void PSSMCalculator::computePseudoCounts(float *profile, float *frequency,
                                          float * Neff_M, size_t queryLength,
                                          float pca, float pcb) {
     for (size_t pos = 0; pos < queryLength; pos++) {
-        float tau = fmin(1.0, pca / (1.0 + Neff_M[pos] / pcb));
+        const float tau = fmin(1.0, pca / (1.0 + Neff_M[pos] / pcb));
         //float tau = fmin(1.0, pca * (1.0 + pcb)/ (Neff_M[pos] + pcb));
-
-        //std::cout<< "Tau: "<< tau << ", Neff: " << Neff_M[pos] <<std::endl;
-//        printf("%.6f\n", tau);
-
-        for (size_t aa = 0; aa < Sequence::PROFILE_AA_SIZE; ++aa) {
-            // compute proportion of pseudo counts and signal
-            float pseudoCounts    = tau * frequency_with_pseudocounts[pos * entrySize + aa];
-            float frequencySignal = (1.0 - tau) * frequency[pos * entrySize + aa];
-            profile[pos * entrySize + aa] = frequencySignal + pseudoCounts;
-//            printf("%f %f %f %f\n", tau, frequencySignal, pseudoCounts,  profile[pos * Sequence::PROFILE_AA_SIZE + aa]);
+        const float signal = 1.0f - tau;
+        // compute proportion of pseudo counts and signal
+        const simd_float tauVec = simdf32_set(tau);
+        const simd_float signalVec = simdf32_set(signal);
+        float *profilePos = &profile[pos * entrySize];
+        const float *frequencyPos = &frequency[pos * entrySize];
+        const float *pseudoCountsPos = &frequency_with_pseudocounts[pos * entrySize];
+        size_t aa = 0;
+        for (; aa + VECSIZE_FLOAT <= Sequence::PROFILE_AA_SIZE; aa += VECSIZE_FLOAT) {
+            const simd_float frequencySignal = simdf32_mul(signalVec, simdf32_loadu(frequencyPos + aa));
+            const simd_float pseudoCounts = simdf32_mul(tauVec, simdf32_loadu(pseudoCountsPos + aa));
+            simdf32_storeu(profilePos + aa, simdf32_add(frequencySignal, pseudoCounts));
+        }
+        for (; aa < Sequence::PROFILE_AA_SIZE; ++aa) {
+            profilePos[aa] = signal * frequencyPos[aa] + tau * pseudoCountsPos[aa];
         }
     }
 }
 
 void PSSMCalculator::computeMatchWeights(float * matchWeight, float * seqWeight, size_t setSize, size_t queryLength, const char **msaSeqs) {
-    for (size_t pos = 0; pos < queryLength; pos++) {
-        memset(matchWeight + pos * Sequence::PROFILE_AA_SIZE, 0,
-               Sequence::PROFILE_AA_SIZE * sizeof(float));
-        for (size_t k = 0; k < setSize; ++k){
-            if(msaSeqs[k][pos] != MultipleAlignment::GAP){
-                unsigned int aa_pos = msaSeqs[k][pos];
-                if(aa_pos < Sequence::PROFILE_AA_SIZE) { // Treat score of X with other amino acid as 0.0
-                    matchWeight[pos * Sequence::PROFILE_AA_SIZE + aa_pos] += seqWeight[k];
-                }
+    memset(matchWeight, 0, queryLength * Sequence::PROFILE_AA_SIZE * sizeof(float));
+    // go row by row through the MSA, every column still accumulates the sequences in order
+    for (size_t k = 0; k < setSize; ++k) {
+        const char *row = msaSeqs[k];
+        const float w = seqWeight[k];
+        for (size_t pos = 0; pos < queryLength; pos++) {
+            const unsigned int aa_pos = row[pos];
+            if (aa_pos < Sequence::PROFILE_AA_SIZE) { // Treat score of X with other amino acid as 0.0
+                matchWeight[pos * Sequence::PROFILE_AA_SIZE + aa_pos] += w;
             }
         }
+    }
+    for (size_t pos = 0; pos < queryLength; pos++) {
         MathUtil::NormalizeTo1(&matchWeight[pos * Sequence::PROFILE_AA_SIZE], Sequence::PROFILE_AA_SIZE, subMat->pBack);
     }
 }
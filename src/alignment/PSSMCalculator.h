@@ -3,8 +3,12 @@
 
 #include <cstddef>
 #include <string>
+#include <vector>
+
+#include "Matcher.h"
 
 class SubstitutionMatrix;
+class Sequence;
 
 class PSSMCalculator {
 public:
@@ -25,6 +29,11 @@ public:
     Profile computePSSMFromMSA(size_t setSize, size_t queryLength, const char **msaSeqs,
                                     bool wg);
 
+    // Computes the profile with global sequence weights (wg) directly from the alignments of seqs against centerSeq.
+    // Gives the same result as computePSSMFromMSA on the unfiltered MSA without deletions, but never builds the MSA.
+    Profile computePSSMFromAlignments(Sequence *centerSeq, const std::vector<Sequence *> &seqs,
+                                      const std::vector<Matcher::result_t> &alnResults);
+
     void printProfile(size_t queryLength);
     void printPSSM(size_t queryLength);
 
@@ -70,6 +79,15 @@ private:
     // number of different amino acids
     int *naa;
 
+    // number of sequences with amino acid a at position i (streamed profile)
+    int *columnCounts;
+
+    // number of residues per sequence (streamed profile)
+    unsigned int *numberRes;
+
+    // one aligned sequence mapped to the center sequence columns (streamed profile)
+    char *alignedRow;
+
     size_t maxSeqLength;
 
     // compute position-specific scoring matrix PSSM score
@@ -82,6 +100,16 @@ private:
     // compute the Neff_M per column -p log(p)
     void computeNeff_M(float *frequency, float *seqWeight, float *Neff_M, size_t queryLength, size_t setSize, char const **msaSeqs);
 
+    // compute the Neff_M per column from the summed sequence weights per column (w_M), Neff_M holds w_M on input
+    void computeNeff_MFromColumnWeights(float *frequency, float *Neff_M, size_t queryLength);
+
+    // consensus, pseudocounts and log-odds scores from the normalized matchWeight and Neff_M
+    Profile computePSSMFromMatchWeights(size_t queryLength);
+
+    // maps the residues of seq onto the columns of the center sequence as in an MSA without deletions
+    // only row[*start, *end) is written, all other columns are gaps
+    void mapToCenterColumns(const Matcher::result_t &res, const Sequence *seq, char *row, size_t *start, size_t *end);
+
     void computeMatchWeights(float * matchWeight, float * seqWeight, size_t setSize, size_t queryLength, const char **msaSeqs);
 
     void computeContextSpecificWeights(float * matchWeight, float *seqWeight, float * Neff_M, size_t queryLength, size_t setSize, const char **msaSeqs);
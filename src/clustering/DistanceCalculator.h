@@ -4,6 +4,7 @@
 #include <sstream>
 #include <cstring>
 #include <vector>
+#include <algorithm>
 
 #include "simd.h"
 #include "MathUtil.h"
@@ -96,6 +97,36 @@ public:
         return length-diff;
     }
 
+    // Same as computeHammingDistance but stops as soon as more than maxDistance mismatches are found.
+    // The budget is checked after every four vectors. In that case a value > maxDistance is returned.
+    static unsigned int computeHammingDistanceBounded(const char *seq1, const char *seq2, unsigned int length,
+                                                      unsigned int maxDistance){
+        const unsigned int vecSize = VECSIZE_INT*4;
+        const unsigned int checkInterval = 4;
+        unsigned int simdBlock = length/vecSize;
+        simd_int * simdSeq1 = (simd_int *) seq1;
+        simd_int * simdSeq2 = (simd_int *) seq2;
+        unsigned int matches = 0;
+        unsigned int pos = 0;
+        while (pos < simdBlock) {
+            const unsigned int blockEnd = std::min(pos + checkInterval, simdBlock);
+            for (; pos < blockEnd; pos++) {
+                simd_int seq1vec = simdi_loadu(simdSeq1+pos);
+                simd_int seq2vec = simdi_loadu(simdSeq2+pos);
+                int res = simdi8_movemask(simdi8_eq(seq1vec, seq2vec));
+                matches += MathUtil::popCount(res);
+            }
+            const unsigned int mismatches = pos*vecSize - matches;
+            if (mismatches > maxDistance) {
+                return mismatches;
+            }
+        }
+        for (unsigned int i = simdBlock*vecSize; i < length; i++) {
+            matches += (seq1[i] == seq2[i]);
+        }
+        return length-matches;
+    }
+
 
     /*
      * Adapted from levenshtein.js (https://gist.github.com/andrei-m/982927)
@@ -0,0 +1,134 @@
+#include "Checkpoint.h"
+#include "Debug.h"
+#include "FileUtil.h"
+#include "Util.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+// makes sure a file that is recorded as finished survives a crash of the node
+static void syncFile(const std::string &fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        Debug(Debug::ERROR) << "Could not open " << fileName << " to commit it!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    fsync(fd);
+    close(fd);
+}
+
+static std::string readManifest(const std::string &fileName) {
+    std::string content;
+    FILE *in = FileUtil::openFileOrDie(fileName.c_str(), "r", true);
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, sizeof(char), sizeof(buffer), in)) > 0) {
+        content.append(buffer, read);
+    }
+    fclose(in);
+    return content;
+}
+
+Checkpoint::Checkpoint(const std::string &resultDB, const std::string &settings)
+        : manifestFileName(resultDB + ".checkpoint"), manifest(NULL) {
+    bool resume = false;
+    if (FileUtil::fileExists(manifestFileName.c_str())) {
+        std::string content = readManifest(manifestFileName);
+
+        // a line that was cut off by a crash is ignored, its chunk is computed again
+        size_t lineStart = 0;
+        size_t lineEnd = content.find('\n');
+        if (lineEnd != std::string::npos && content.compare(0, lineEnd, settings) == 0) {
+            resume = true;
+            lineStart = lineEnd + 1;
+            while ((lineEnd = content.find('\n', lineStart)) != std::string::npos) {
+                // only lines that are a number as a whole name a chunk
+                const char *line = content.c_str() + lineStart;
+                char *end;
+                errno = 0;
+                size_t chunk = strtoull(line, &end, 10);
+                if (isdigit(line[0]) && end == content.c_str() + lineEnd && errno == 0) {
+                    if (chunk >= done.size()) {
+                        done.resize(chunk + 1, false);
+                    }
+                    done[chunk] = true;
+                } else {
+                    Debug(Debug::WARNING) << "Ignoring invalid line in checkpoint " << manifestFileName << "\n";
+                }
+                lineStart = lineEnd + 1;
+            }
+            // the appended chunks would continue the cut off line otherwise
+            if (lineStart < content.size() && truncate(manifestFileName.c_str(), lineStart) != 0) {
+                Debug(Debug::ERROR) << "Could not truncate checkpoint " << manifestFileName << "!\n";
+                EXIT(EXIT_FAILURE);
+            }
+        } else {
+            Debug(Debug::WARNING) << "Checkpoint " << manifestFileName << " was written with different settings. Starting over.\n";
+            FileUtil::deleteFile(manifestFileName);
+        }
+    }
+
+    if (resume) {
+        manifest = FileUtil::openFileOrDie(manifestFileName.c_str(), "a", true);
+        Debug(Debug::INFO) << "Resuming from checkpoint " << manifestFileName << " with " << doneCount() << " finished chunks\n";
+    } else {
+        manifest = FileUtil::openFileOrDie(manifestFileName.c_str(), "w", false);
+        fprintf(manifest, "%s\n", settings.c_str());
+        fflush(manifest);
+    }
+}
+
+Checkpoint::~Checkpoint() {
+    if (manifest != NULL) {
+        fclose(manifest);
+    }
+}
+
+bool Checkpoint::isDone(size_t chunk, const std::pair<std::string, std::string> &files) const {
+    return chunk < done.size() && done[chunk]
+           && FileUtil::fileExists(files.first.c_str()) && FileUtil::fileExists(files.second.c_str());
+}
+
+void Checkpoint::commit(size_t chunk, const std::pair<std::string, std::string> &files) {
+    syncFile(files.first);
+    syncFile(files.second);
+    fprintf(manifest, "%zu\n", chunk);
+    fflush(manifest);
+    fsync(fileno(manifest));
+    if (chunk >= done.size()) {
+        done.resize(chunk + 1, false);
+    }
+    done[chunk] = true;
+}
+
+void Checkpoint::remove() {
+    if (manifest != NULL) {
+        fclose(manifest);
+        manifest = NULL;
+    }
+    FileUtil::deleteFile(manifestFileName);
+}
+
+size_t Checkpoint::doneCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < done.size(); i++) {
+        count += done[i];
+    }
+    return count;
+}
+
+std::string Checkpoint::readSettings(const std::string &resultDB) {
+    const std::string fileName = resultDB + ".checkpoint";
+    if (FileUtil::fileExists(fileName.c_str()) == false) {
+        return "";
+    }
+    std::string content = readManifest(fileName);
+    size_t lineEnd = content.find('\n');
+    if (lineEnd == std::string::npos) {
+        return "";
+    }
+    return content.substr(0, lineEnd);
+}
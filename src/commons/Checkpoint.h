@@ -0,0 +1,39 @@
+#ifndef MMSEQS_CHECKPOINT_H
+#define MMSEQS_CHECKPOINT_H
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Progress manifest of a result database that is written in chunks.
+// A chunk is recorded only after its data and index files are closed and on disk, so a run that is
+// killed and restarted with the same settings skips the recorded chunks and computes only the missing ones.
+// The manifest lives next to the result as <resultDB>.checkpoint.
+class Checkpoint {
+public:
+    // a manifest written with different settings belongs to another run and is discarded
+    Checkpoint(const std::string &resultDB, const std::string &settings);
+    ~Checkpoint();
+
+    // the chunk was recorded and its files still exist
+    bool isDone(size_t chunk, const std::pair<std::string, std::string> &files) const;
+
+    // records a finished chunk
+    void commit(size_t chunk, const std::pair<std::string, std::string> &files);
+
+    // deletes the manifest after the chunks were merged into the result
+    void remove();
+
+    size_t doneCount() const;
+
+    // settings of an existing manifest of the result, empty if there is none
+    static std::string readSettings(const std::string &resultDB);
+
+private:
+    const std::string manifestFileName;
+    FILE *manifest;
+    std::vector<bool> done;
+};
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef MMSEQS_CODONTABLE_H
+#define MMSEQS_CODONTABLE_H
+
+// Looks up a value for every codon of a nucleotide sequence and of its reverse complement
+// in one pass with SSSE3 shuffles.
+// Bases are encoded with two bits (A=0, C=1, G=2, T/U=3) and the codon XYZ has the index 16*X + 4*Y + Z.
+// Codons containing any other character (N, ambiguity codes, gaps) get the value 0,
+// callers resolve those few codons with their scalar code.
+
+#include <cstddef>
+#include <cstring>
+#include "simd.h"
+
+class CodonTable {
+public:
+    CodonTable() {
+        memset(table, 0, sizeof(table));
+    }
+
+    void setValue(int codon, char value) {
+        table[codon] = value;
+    }
+
+    char getValue(int codon) const {
+        return table[codon];
+    }
+
+    static int encodeBase(char c) {
+        switch (c) {
+            case 'A': case 'a': return 0;
+            case 'C': case 'c': return 1;
+            case 'G': case 'g': return 2;
+            case 'T': case 't': case 'U': case 'u': return 3;
+            default: return -1;
+        }
+    }
+
+    // index of the codon starting at codon, -1 if it contains a character other than ACGTU
+    static int codonIndex(const char *codon) {
+        int x = encodeBase(codon[0]);
+        int y = encodeBase(codon[1]);
+        int z = encodeBase(codon[2]);
+        if ((x | y | z) < 0) {
+            return -1;
+        }
+        return 16 * x + 4 * y + z;
+    }
+
+    static int reverseComplementIndex(int codon) {
+        // complement is 3 - base, the reversed codon ZYX has the index 16*(3-Z) + 4*(3-Y) + (3-X)
+        return 63 - (16 * (codon & 3) + 4 * ((codon >> 2) & 3) + (codon >> 4));
+    }
+
+    // forward[i] is the value of the codon at nucl[i], reverse[k] the value of the codon at position k
+    // of the reverse complement, for i, k < L - 2. Either output can be NULL.
+    // Returns false if a codon had to be set to 0 because it contains other characters.
+    bool lookup(const char *nucl, size_t L, char *forward, char *reverse) const {
+        if (L < 3) {
+            return true;
+        }
+        const size_t codons = L - 2;
+        const __m128i reverseMask = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        __m128i allInvalid = _mm_setzero_si128();
+        size_t i = 0;
+        if (L >= 32) {
+            __m128i invalidNext;
+            __m128i next = encode(_mm_loadu_si128((const __m128i *) nucl), invalidNext);
+            for (; i + 32 <= L; i += 16) {
+                __m128i invalidCurrent = invalidNext;
+                __m128i b0 = next;
+                next = encode(_mm_loadu_si128((const __m128i *) (nucl + i + 16)), invalidNext);
+                __m128i b1 = _mm_alignr_epi8(next, b0, 1);
+                __m128i b2 = _mm_alignr_epi8(next, b0, 2);
+                __m128i invalid = _mm_or_si128(invalidCurrent, _mm_alignr_epi8(invalidNext, invalidCurrent, 1));
+                invalid = _mm_or_si128(invalid, _mm_alignr_epi8(invalidNext, invalidCurrent, 2));
+                allInvalid = _mm_or_si128(allInvalid, invalid);
+                if (forward != NULL) {
+                    __m128i value = forwardValues(b0, b1, b2);
+                    _mm_storeu_si128((__m128i *) (forward + i), _mm_andnot_si128(invalid, value));
+                }
+                if (reverse != NULL) {
+                    __m128i value = _mm_andnot_si128(invalid, reverseValues(b0, b1, b2));
+                    _mm_storeu_si128((__m128i *) (reverse + (codons - i - 16)), _mm_shuffle_epi8(value, reverseMask));
+                }
+            }
+        }
+        bool valid = _mm_movemask_epi8(allInvalid) == 0;
+        for (; i < codons; i++) {
+            int codon = codonIndex(nucl + i);
+            char fwd = 0;
+            char rev = 0;
+            if (codon < 0) {
+                valid = false;
+            } else {
+                fwd = table[codon];
+                rev = table[reverseComplementIndex(codon)];
+            }
+            if (forward != NULL) {
+                forward[i] = fwd;
+            }
+            if (reverse != NULL) {
+                reverse[codons - i - 1] = rev;
+            }
+        }
+        return valid;
+    }
+
+    // forward and reverse complement values of the 48 codons starting at nucl[0] .. nucl[47].
+    // Reads 64 bytes, reverse can be NULL. Codons with other characters get the value 0.
+    inline void lookupBlock(const char *nucl, __m128i forward[3], __m128i reverse[3]) const {
+        __m128i invalid[4];
+        __m128i bases[4];
+        for (size_t k = 0; k < 4; k++) {
+            bases[k] = encode(_mm_loadu_si128((const __m128i *) (nucl + 16 * k)), invalid[k]);
+        }
+        for (size_t k = 0; k < 3; k++) {
+            __m128i b1 = _mm_alignr_epi8(bases[k + 1], bases[k], 1);
+            __m128i b2 = _mm_alignr_epi8(bases[k + 1], bases[k], 2);
+            __m128i codonInvalid = _mm_or_si128(invalid[k], _mm_alignr_epi8(invalid[k + 1], invalid[k], 1));
+            codonInvalid = _mm_or_si128(codonInvalid, _mm_alignr_epi8(invalid[k + 1], invalid[k], 2));
+            forward[k] = _mm_andnot_si128(codonInvalid, forwardValues(bases[k], b1, b2));
+            if (reverse != NULL) {
+                reverse[k] = _mm_andnot_si128(codonInvalid, reverseValues(bases[k], b1, b2));
+            }
+        }
+    }
+
+    // two bit codes of 16 characters, invalid is set to 0xFF for characters other than ACGTU
+    static inline __m128i encode(__m128i chars, __m128i &invalid) {
+        __m128i upper = _mm_and_si128(chars, _mm_set1_epi8((char) 0xDF));
+        __m128i valid = _mm_cmpeq_epi8(upper, _mm_set1_epi8('A'));
+        valid = _mm_or_si128(valid, _mm_cmpeq_epi8(upper, _mm_set1_epi8('C')));
+        valid = _mm_or_si128(valid, _mm_cmpeq_epi8(upper, _mm_set1_epi8('G')));
+        valid = _mm_or_si128(valid, _mm_cmpeq_epi8(upper, _mm_set1_epi8('T')));
+        valid = _mm_or_si128(valid, _mm_cmpeq_epi8(upper, _mm_set1_epi8('U')));
+        invalid = _mm_xor_si128(valid, _mm_set1_epi8((char) 0xFF));
+        // A=0x41, C=0x43, G=0x47, T=0x54, U=0x55: bits 1 and 2 xor-ed give 0, 1, 2, 3, 3 (also for lower case)
+        __m128i code = _mm_xor_si128(_mm_srli_epi16(chars, 1), _mm_srli_epi16(chars, 2));
+        return _mm_and_si128(code, _mm_set1_epi8(3));
+    }
+
+    // values of the 16 codons with the bases b0 b1 b2
+    inline __m128i forwardValues(__m128i b0, __m128i b1, __m128i b2) const {
+        __m128i lo = _mm_or_si128(_mm_slli_epi16(b1, 2), b2);
+        return select(b0, lo);
+    }
+
+    // values of the reverse complement of the 16 codons with the bases b0 b1 b2
+    inline __m128i reverseValues(__m128i b0, __m128i b1, __m128i b2) const {
+        const __m128i three = _mm_set1_epi8(3);
+        __m128i lo = _mm_or_si128(_mm_slli_epi16(_mm_sub_epi8(three, b1), 2), _mm_sub_epi8(three, b0));
+        return select(_mm_sub_epi8(three, b2), lo);
+    }
+
+    // gathers the bytes offset, offset + 3, ... of the 48 bytes in v0 v1 v2
+    static inline __m128i everyThird(__m128i v0, __m128i v1, __m128i v2, int offset) {
+        const __m128i *masks = everyThirdMasks() + 3 * offset;
+        __m128i result = _mm_shuffle_epi8(v0, _mm_load_si128(masks));
+        result = _mm_or_si128(result, _mm_shuffle_epi8(v1, _mm_load_si128(masks + 1)));
+        return _mm_or_si128(result, _mm_shuffle_epi8(v2, _mm_load_si128(masks + 2)));
+    }
+
+private:
+    // sub-table k holds the codons 16*k .. 16*k+15, the first base selects the sub-table
+    inline __m128i select(__m128i hi, __m128i lo) const {
+        __m128i t0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) table), lo);
+        __m128i t1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (table + 16)), lo);
+        __m128i t2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (table + 32)), lo);
+        __m128i t3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (table + 48)), lo);
+        // blendv only looks at the highest bit of every byte
+        __m128i bit0 = _mm_slli_epi16(hi, 7);
+        __m128i bit1 = _mm_slli_epi16(hi, 6);
+        __m128i t01 = _mm_blendv_epi8(t0, t1, bit0);
+        __m128i t23 = _mm_blendv_epi8(t2, t3, bit0);
+        return _mm_blendv_epi8(t01, t23, bit1);
+    }
+
+    static const __m128i *everyThirdMasks() {
+        static const char masks[9][16] __attribute__((aligned(16))) = {
+            {    0,    3,    6,    9,   12,   15, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 },
+            { -128, -128, -128, -128, -128, -128,    2,    5,    8,   11,   14, -128, -128, -128, -128, -128 },
+            { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128,    1,    4,    7,   10,   13 },
+            {    1,    4,    7,   10,   13, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 },
+            { -128, -128, -128, -128, -128,    0,    3,    6,    9,   12,   15, -128, -128, -128, -128, -128 },
+            { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128,    2,    5,    8,   11,   14 },
+            {    2,    5,    8,   11,   14, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 },
+            { -128, -128, -128, -128, -128,    1,    4,    7,   10,   13, -128, -128, -128, -128, -128, -128 },
+            { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128,    0,    3,    6,    9,   12,   15 }
+        };
+        return (const __m128i *) masks;
+    }
+
+    char table[64] __attribute__((aligned(16)));
+};
+
+#endif
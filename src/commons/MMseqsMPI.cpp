@@ -26,3 +26,45 @@ void MMseqsMPI::init(int argc, const char **argv) {
 #else
 void MMseqsMPI::init(int, const char **) {}
 #endif
+
+#ifdef HAVE_MPI
+MPIWorkQueue::MPIWorkQueue(size_t itemCount) : itemCount(itemCount), counter(NULL) {
+    MPI_Aint size = MMseqsMPI::isMaster() ? sizeof(long long) : 0;
+    MPI_Win_allocate(size, sizeof(long long), MPI_INFO_NULL, MPI_COMM_WORLD, &counter, &window);
+    if (MMseqsMPI::isMaster()) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, MMseqsMPI::MASTER, 0, window);
+        *counter = 0;
+        MPI_Win_unlock(MMseqsMPI::MASTER, window);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+MPIWorkQueue::~MPIWorkQueue() {
+    MPI_Win_free(&window);
+}
+
+bool MPIWorkQueue::next(size_t *item) {
+    const long long one = 1;
+    long long current = 0;
+    MPI_Win_lock(MPI_LOCK_SHARED, MMseqsMPI::MASTER, 0, window);
+    MPI_Fetch_and_op(&one, &current, MPI_LONG_LONG, MMseqsMPI::MASTER, 0, MPI_SUM, window);
+    MPI_Win_unlock(MMseqsMPI::MASTER, window);
+    if (current < 0 || static_cast<size_t>(current) >= itemCount) {
+        return false;
+    }
+    *item = static_cast<size_t>(current);
+    return true;
+}
+#else
+MPIWorkQueue::MPIWorkQueue(size_t itemCount) : itemCount(itemCount), counter(&localCounter), localCounter(0) {}
+
+MPIWorkQueue::~MPIWorkQueue() {}
+
+bool MPIWorkQueue::next(size_t *item) {
+    if (static_cast<size_t>(*counter) >= itemCount) {
+        return false;
+    }
+    *item = static_cast<size_t>((*counter)++);
+    return true;
+}
+#endif
@@ -1,6 +1,8 @@
 #ifndef MMSEQS_MPI_H
 #define MMSEQS_MPI_H
 
+#include <cstddef>
+
 #ifdef HAVE_MPI
 #include <mpi.h>
 #endif
@@ -23,6 +25,28 @@ public:
     };
 };
 
+// Hands out the work items 0 to itemCount - 1 on request, so that faster ranks process more of them.
+// The next free item is a counter in the memory of the master that every rank fetches and increments
+// with an atomic one-sided operation, the master keeps working and does not have to answer requests.
+// Construction and destruction are collective. Without MPI all items go to the single process.
+class MPIWorkQueue {
+public:
+    MPIWorkQueue(size_t itemCount);
+    ~MPIWorkQueue();
+
+    // returns false once all items are handed out
+    bool next(size_t *item);
+
+private:
+    const size_t itemCount;
+    long long *counter;
+#ifdef HAVE_MPI
+    MPI_Win window;
+#else
+    long long localCounter;
+#endif
+};
+
 // if we are in an error case, do not call MPI_Finalize, it might still be in a Barrier
 #ifdef HAVE_MPI
 #define EXIT(exitCode) do {                  \
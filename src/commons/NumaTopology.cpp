@@ -0,0 +1,201 @@
+#include "NumaTopology.h"
+#include "Util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+// from linux/mempolicy.h, numaif.h is only available with libnuma
+static const int MPOL_BIND_POLICY = 2;
+static const int MPOL_INTERLEAVE_POLICY = 3;
+static const unsigned int MPOL_MF_MOVE_PAGES = (1 << 1);
+
+static bool setAffinity(const std::vector<int> &cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < cpus.size(); i++) {
+        if (cpus[i] < CPU_SETSIZE) {
+            CPU_SET(cpus[i], &set);
+        }
+    }
+    if (CPU_COUNT(&set) == 0) {
+        return false;
+    }
+    // pid 0 is the calling thread
+    return sched_setaffinity(0, sizeof(cpu_set_t), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+#ifdef __linux__
+static bool readFirstLine(const std::string &fileName, std::string &line) {
+    FILE *file = fopen(fileName.c_str(), "r");
+    if (file == NULL) {
+        return false;
+    }
+    char buffer[4096];
+    const bool success = fgets(buffer, sizeof(buffer), file) != NULL;
+    if (success) {
+        line = buffer;
+    }
+    fclose(file);
+    return success;
+}
+#endif
+
+NumaTopology::NumaTopology() {
+#ifdef __linux__
+    // taskset, cgroups or the batch system may restrict the process to some of the CPUs
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                processCpus.push_back(cpu);
+            }
+        }
+    }
+    if (processCpus.empty()) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long i = 0; i < cpus; i++) {
+            processCpus.push_back(static_cast<int>(i));
+        }
+    }
+
+    // node numbers can have gaps, e.g. after hot removal or with memory only nodes
+    std::string line;
+    std::vector<int> nodeIds;
+    if (readFirstLine("/sys/devices/system/node/has_cpu", line) || readFirstLine("/sys/devices/system/node/online", line)) {
+        nodeIds = parseCpuList(line);
+    }
+    for (size_t i = 0; i < nodeIds.size(); i++) {
+        std::string base = "/sys/devices/system/node/node" + SSTR(nodeIds[i]);
+        if (readFirstLine(base + "/cpulist", line) == false) {
+            continue;
+        }
+        Node node;
+        node.id = nodeIds[i];
+        node.freeMemory = 0;
+        // only the CPUs the process may run on are used for pinning
+        std::vector<int> cpus = parseCpuList(line);
+        std::sort(cpus.begin(), cpus.end());
+        std::set_intersection(cpus.begin(), cpus.end(), processCpus.begin(), processCpus.end(), std::back_inserter(node.cpus));
+        // memory only nodes and nodes outside of the affinity mask have no CPUs to run workers on
+        if (node.cpus.empty()) {
+            continue;
+        }
+
+        FILE *memFile = fopen((base + "/meminfo").c_str(), "r");
+        if (memFile != NULL) {
+            // "Node 0 MemFree:        1234 kB"
+            char buffer[4096];
+            while (fgets(buffer, sizeof(buffer), memFile) != NULL) {
+                const char *field = strstr(buffer, "MemFree:");
+                if (field != NULL) {
+                    node.freeMemory = strtoull(field + strlen("MemFree:"), NULL, 10) * 1024;
+                    break;
+                }
+            }
+            fclose(memFile);
+        }
+        nodes.push_back(node);
+    }
+#endif
+    if (nodes.empty()) {
+        Node node;
+        node.id = 0;
+        node.freeMemory = 0;
+        node.cpus = processCpus;
+        nodes.push_back(node);
+    }
+}
+
+bool NumaTopology::pinThread(size_t node) const {
+    return setAffinity(nodes[node].cpus);
+}
+
+bool NumaTopology::unpinThread() const {
+    return setAffinity(processCpus);
+}
+
+bool NumaTopology::bindMemory(const void *data, size_t size, size_t node) const {
+    std::vector<int> nodeIds(1, nodes[node].id);
+    return setMemoryPolicy(data, size, MPOL_BIND_POLICY, nodeIds);
+}
+
+bool NumaTopology::interleaveMemory(const void *data, size_t size) const {
+    std::vector<int> nodeIds;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodeIds.push_back(nodes[i].id);
+    }
+    return setMemoryPolicy(data, size, MPOL_INTERLEAVE_POLICY, nodeIds);
+}
+
+bool NumaTopology::setMemoryPolicy(const void *data, size_t size, int policy, const std::vector<int> &nodeIds) const {
+#if defined(__linux__) && defined(SYS_mbind)
+    if (size == 0) {
+        return true;
+    }
+    // mbind works on whole pages, the pages at the ends may be shared with other data
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t start = reinterpret_cast<size_t>(data) & ~(pageSize - 1);
+    const size_t end = reinterpret_cast<size_t>(data) + size;
+    const size_t bitsPerWord = 8 * sizeof(unsigned long);
+    int maxId = 0;
+    for (size_t i = 0; i < nodeIds.size(); i++) {
+        maxId = std::max(maxId, nodeIds[i]);
+    }
+    std::vector<unsigned long> mask(maxId / bitsPerWord + 1, 0);
+    for (size_t i = 0; i < nodeIds.size(); i++) {
+        mask[nodeIds[i] / bitsPerWord] |= 1UL << (nodeIds[i] % bitsPerWord);
+    }
+    // without MPOL_MF_STRICT pages that cannot be moved are skipped silently
+    return syscall(SYS_mbind, start, end - start, policy, &mask[0], mask.size() * bitsPerWord + 1, MPOL_MF_MOVE_PAGES) == 0;
+#else
+    (void) data;
+    (void) size;
+    (void) policy;
+    (void) nodeIds;
+    return false;
+#endif
+}
+
+std::vector<int> NumaTopology::parseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+    const char *pos = list.c_str();
+    while (*pos != '\0') {
+        char *end;
+        long first = strtol(pos, &end, 10);
+        if (end == pos) {
+            break;
+        }
+        long last = first;
+        pos = end;
+        if (*pos == '-') {
+            pos++;
+            last = strtol(pos, &end, 10);
+            if (end == pos) {
+                break;
+            }
+            pos = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        if (*pos != ',') {
+            break;
+        }
+        pos++;
+    }
+    return cpus;
+}
@@ -0,0 +1,64 @@
+#ifndef MMSEQS_NUMATOPOLOGY_H
+#define MMSEQS_NUMATOPOLOGY_H
+
+// NUMA nodes and their CPUs as listed in /sys/devices/system/node, restricted to the CPUs
+// the process may run on. Nodes without any of these CPUs are left out.
+// Without sysfs (or on other systems) there is a single node with all allowed CPUs.
+// Memory is placed by first touch: a thread pinned to a node that writes a page first
+// gets the page allocated on that node. Memory that is already in use can be moved with mbind.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class NumaTopology {
+public:
+    NumaTopology();
+
+    size_t nodeCount() const {
+        return nodes.size();
+    }
+
+    const std::vector<int> &getCpus(size_t node) const {
+        return nodes[node].cpus;
+    }
+
+    // free memory of the node in bytes, 0 if unknown
+    size_t getFreeMemory(size_t node) const {
+        return nodes[node].freeMemory;
+    }
+
+    // node of the thread with the given index if threadCount threads are spread in blocks over the nodes
+    size_t nodeOfThread(size_t thread, size_t threadCount) const {
+        return (thread * nodes.size()) / threadCount;
+    }
+
+    // restricts the calling thread to the CPUs of the node, returns false if that is not possible
+    bool pinThread(size_t node) const;
+
+    // restores the CPUs the process was allowed to run on when the topology was read
+    bool unpinThread() const;
+
+    // moves the pages of the range to the node or spreads them page by page over all nodes,
+    // pages that cannot be moved stay where they are
+    bool bindMemory(const void *data, size_t size, size_t node) const;
+    bool interleaveMemory(const void *data, size_t size) const;
+
+    // parses a sysfs CPU list like "0-3,8,10-11"
+    static std::vector<int> parseCpuList(const std::string &list);
+
+private:
+    struct Node {
+        // number of the node directory, skipped nodes and gaps in the numbering make it differ from the index
+        int id;
+        std::vector<int> cpus;
+        size_t freeMemory;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<int> processCpus;
+
+    bool setMemoryPolicy(const void *data, size_t size, int policy, const std::vector<int> &nodeIds) const;
+};
+
+#endif
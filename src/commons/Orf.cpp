@@ -56,18 +56,14 @@ inline char complement(const char c) {
 
 Orf::Orf(const unsigned int requestedGenCode, bool useAllTableStarts) {
     TranslateNucl translateNucl(static_cast<TranslateNucl::GenCode>(requestedGenCode));
+    for (int codon = 0; codon < 64; ++codon) {
+        codonTable.setValue(codon, CODON_VALID);
+    }
+
     std::vector<std::string> codons = translateNucl.getStopCodons();
-    stopCodons = (char*)mem_align(ALIGN_INT, 8 * sizeof(int));
-    memset(stopCodons, 0, 8 * sizeof(int));
-    size_t count = 0;
     for (size_t i = 0; i < codons.size(); ++i) {
-        memcpy(stopCodons + count, codons[i].c_str(), 3);
-        count += 4;
-    }
-    stopCodonCount = codons.size();
-    if(stopCodonCount > 8) {
-        Debug(Debug::ERROR) << "Invalid translation table with more than 8 stop codons.\n";
-        EXIT(EXIT_FAILURE);
+        int codon = CodonTable::codonIndex(codons[i].c_str());
+        codonTable.setValue(codon, codonTable.getValue(codon) | CODON_STOP);
     }
 
     codons.clear();
@@ -77,30 +73,23 @@ Orf::Orf(const unsigned int requestedGenCode, bool useAllTableStarts) {
     } else {
         codons.push_back("ATG");
     }
-
-    startCodons = (char*)mem_align(ALIGN_INT, 8 * sizeof(int));
-    memset(startCodons, 0, 8 * sizeof(int));
-    count = 0;
     for (size_t i = 0; i < codons.size(); ++i) {
-        memcpy(startCodons + count, codons[i].c_str(), 3);
-        count += 4;
-    }
-    startCodonCount = codons.size();
-    if(startCodonCount > 8) {
-        Debug(Debug::ERROR) << "Invalid translation table with more than 8 start codons.\n";
-        EXIT(EXIT_FAILURE);
+        int codon = CodonTable::codonIndex(codons[i].c_str());
+        codonTable.setValue(codon, codonTable.getValue(codon) | CODON_START);
     }
 
     sequence = (char*)mem_align(ALIGN_INT, 32000 * sizeof(char));
     reverseComplement = (char*)mem_align(ALIGN_INT, 32000 * sizeof(char));
+    forwardFlags = (char*)mem_align(ALIGN_INT, 32000 * sizeof(char));
+    reverseFlags = (char*)mem_align(ALIGN_INT, 32000 * sizeof(char));
     bufferSize = 32000;
 }
 
 Orf::~Orf() {
     free(sequence);
     free(reverseComplement);
-    free(startCodons);
-    free(stopCodons);
+    free(forwardFlags);
+    free(reverseFlags);
 }
 
 Matcher::result_t Orf::getFromDatabase(const size_t id, DBReader<unsigned int> & contigsReader, DBReader<unsigned int> & orfHeadersReader) {
@@ -140,8 +129,12 @@ bool Orf::setSequence(const char* seq, size_t length) {
     if((length + VECSIZE_INT) > bufferSize) {
         free(sequence);
         free(reverseComplement);
+        free(forwardFlags);
+        free(reverseFlags);
         sequence = (char*)mem_align(ALIGN_INT, (length + VECSIZE_INT) * sizeof(char));
         reverseComplement = (char*)mem_align(ALIGN_INT, (length + VECSIZE_INT) * sizeof(char));
+        forwardFlags = (char*)mem_align(ALIGN_INT, (length + VECSIZE_INT) * sizeof(char));
+        reverseFlags = (char*)mem_align(ALIGN_INT, (length + VECSIZE_INT) * sizeof(char));
         bufferSize = (length + VECSIZE_INT);
     }
 
@@ -165,6 +158,8 @@ bool Orf::setSequence(const char* seq, size_t length) {
         reverseComplement[i] = CHAR_MAX;
     }
 
+    fillCodonFlags();
+
     return true;
 }
 
@@ -188,55 +183,45 @@ void Orf::findAll(std::vector<Orf::SequenceLocation> &result,
                   const unsigned int startMode) {
     if(forwardFrames != 0) {
         // find ORFs on the forward sequence
-        findForward(sequence, sequenceLength, result,
+        findForward(forwardFlags, sequenceLength, result,
                     minLength, maxLength, maxGaps, forwardFrames, startMode, STRAND_PLUS);
     }
 
     if(reverseFrames != 0) {
         // find ORFs on the reverse complement
-        findForward(reverseComplement, sequenceLength, result,
+        findForward(reverseFlags, sequenceLength, result,
                     minLength, maxLength, maxGaps, reverseFrames, startMode, STRAND_MINUS);
     }
 }
 
-inline bool isIncomplete(const char* codon) {
-    return codon[0] == CHAR_MAX || codon[1] == CHAR_MAX || codon[2] == CHAR_MAX;
-}
-
 inline bool isGapOrN(const char *codon) {
     return codon[0] == 'N' || complement(codon[0]) == '.'
         || codon[1] == 'N' || complement(codon[1]) == '.'
         || codon[2] == 'N' || complement(codon[2]) == '.';
 }
 
-template <int N>
-#ifndef AVX2
-inline bool isInCodons(const char* sequence, simd_int codons, simd_int codons2) {
-#else
-inline bool isInCodons(const char* sequence, simd_int codons, simd_int) {
-#endif
-    simd_int c = simdi_loadu((simd_int*)sequence);
-    // ATGA ATGA ATGA ATGA
-#ifdef AVX2
-    simd_int shuf = _mm256_permutevar8x32_epi32(c, _mm256_setzero_si256());
-#else
-    simd_int shuf = simdi32_shuffle(c, _MM_SHUFFLE(0, 0, 0, 0));
-#endif
-    // ATG0 ATG0 ATG0 ATG0
-    simd_int mask = simdi32_set(0x00FFFFFF);
-    shuf = simdi_and(mask, shuf);
-    // FFFF 0000 0000 0000
-    simd_int test = simdi32_eq(shuf, codons);
-    #ifndef AVX2
-    if(N > 4) {
-        simd_int test2 = simdi32_eq(shuf, codons2);
-        return (simdi8_movemask(test) != 0) && (simdi8_movemask(test2) != 0);
+// Flags the codon at every position of both strands in one pass.
+// Codons with other bases than ACGT are rare and flagged one by one.
+void Orf::fillCodonFlags() {
+    bool valid = codonTable.lookup(sequence, sequenceLength, forwardFlags, reverseFlags);
+    if (valid == false) {
+        for (size_t i = 0; i < sequenceLength - 2; ++i) {
+            if (forwardFlags[i] == 0) {
+                forwardFlags[i] = isGapOrN(sequence + i) ? CODON_GAP : 0;
+            }
+            if (reverseFlags[i] == 0) {
+                reverseFlags[i] = isGapOrN(reverseComplement + i) ? CODON_GAP : 0;
+            }
+        }
+    }
+    // the last two codons are incomplete
+    for (size_t i = sequenceLength - 2; i < sequenceLength; ++i) {
+        forwardFlags[i] = CODON_GAP;
+        reverseFlags[i] = CODON_GAP;
     }
-    #endif
-    return simdi8_movemask(test) != 0;
 }
 
-void Orf::findForward(const char *sequence, const size_t sequenceLength, std::vector<SequenceLocation> &result,
+void Orf::findForward(const char *codonFlags, const size_t sequenceLength, std::vector<SequenceLocation> &result,
                       const size_t minLength, const size_t maxLength, const size_t maxGaps, const unsigned int frames,
                       const unsigned int startMode, const Strand strand) {
     // An open reading frame can beginning in any of the three codon start position
@@ -262,15 +247,9 @@ void Orf::findForward(const char *sequence, const size_t sequenceLength, std::ve
     // Offset the start position by reading frame
     size_t from[FRAMES] = {frameOffset[0], frameOffset[1], frameOffset[2]};
 
-    simd_int startCodonsHi = simdi_load((simd_int*)startCodons);
-    simd_int startCodonsLo = simdi_loadu((simd_int*)(startCodons + 16));
-
-    simd_int stopCodonsHi = simdi_load((simd_int*)stopCodons);
-    simd_int stopCodonsLo = simdi_loadu((simd_int*)(stopCodons + 16));
-
     for (size_t i = 0;  i < sequenceLength - (FRAMES - 1);  i += FRAMES) {
         for(size_t position = i; position < i + FRAMES; position++) {
-            const char* codon = sequence + position;
+            const char flags = codonFlags[position];
             size_t frame = position % FRAMES;
 
             // skip frames outside of out the frame mask
@@ -278,8 +257,9 @@ void Orf::findForward(const char *sequence, const size_t sequenceLength, std::ve
                 continue;
             }
 
-            bool thisIncomplete = isIncomplete(codon);
-            bool isLast = !thisIncomplete && isIncomplete(codon + FRAMES);
+            bool thisIncomplete = position + 2 >= sequenceLength;
+            bool isLast = !thisIncomplete && (position + FRAMES + 2 >= sequenceLength);
+            bool isStart = (flags & CODON_START) != 0;
 
             // START_TO_STOP returns the longest fragment such that the first codon is a start
             // ANY_TO_STOP returns the longest fragment
@@ -288,15 +268,12 @@ void Orf::findForward(const char *sequence, const size_t sequenceLength, std::ve
            
             bool shouldStart;
             if((startMode == START_TO_STOP)) {
-                shouldStart = isInsideOrf[frame] == false 
-                            && ((startCodonCount > 4) ? isInCodons<8>(codon, startCodonsHi, startCodonsLo)
-                                                      : isInCodons<4>(codon, startCodonsHi, startCodonsLo));
+                shouldStart = isInsideOrf[frame] == false && isStart;
             } else if(startMode == ANY_TO_STOP) {
                 shouldStart = isInsideOrf[frame] == false;
             } else {
                 // LAST_START_TO_STOP:
-                shouldStart = ((startCodonCount > 4) ? isInCodons<8>(codon, startCodonsHi, startCodonsLo)
-                                                     : isInCodons<4>(codon, startCodonsHi, startCodonsLo));
+                shouldStart = isStart;
             }
 
             // do not start a new orf on the last codon
@@ -312,13 +289,12 @@ void Orf::findForward(const char *sequence, const size_t sequenceLength, std::ve
             if(isInsideOrf[frame]) {
                 countLength[frame]++;
 
-                if(isGapOrN(codon)) {
+                if(flags & CODON_GAP) {
                     countGaps[frame]++;
                 }
             }
 
-            const bool stop = (stopCodonCount > 4) ? isInCodons<8>(codon, stopCodonsHi, stopCodonsLo)
-                                                   : isInCodons<4>(codon, stopCodonsHi, stopCodonsLo);
+            const bool stop = (flags & CODON_STOP) != 0;
             if(isInsideOrf[frame] && (stop || isLast)) {
                 isInsideOrf[frame] = false;
 
@@ -5,6 +5,7 @@
 #include <string>
 #include "Matcher.h"
 #include "DBReader.h"
+#include "CodonTable.h"
 
 class Orf
 {
@@ -39,6 +40,29 @@ public:
 
         SequenceLocation(){}
     };
+
+    // Fixed size record of the binary location index (<orfDB>.orf) written by extractorfs.
+    // Record i belongs to the ORF with key i, so readers do not need to parse the text headers.
+    struct PackedLocation {
+        unsigned int id;
+        unsigned int from;
+        unsigned int to;
+        signed char strand;
+        unsigned char hasIncompleteStart;
+        unsigned char hasIncompleteEnd;
+        unsigned char padding;
+
+        PackedLocation(const SequenceLocation &loc) :
+                id(loc.id), from(static_cast<unsigned int>(loc.from)), to(static_cast<unsigned int>(loc.to)),
+                strand(static_cast<signed char>(loc.strand)),
+                hasIncompleteStart(loc.hasIncompleteStart), hasIncompleteEnd(loc.hasIncompleteEnd), padding(0) {}
+
+        SequenceLocation unpack() const {
+            SequenceLocation loc(from, to, hasIncompleteStart, hasIncompleteEnd, static_cast<Strand>(strand));
+            loc.id = id;
+            return loc;
+        }
+    };
     
     Orf(const unsigned int requestedGenCode, bool useAllTableStarts);
     ~Orf();
@@ -57,7 +81,8 @@ public:
                  const unsigned int reverseFrames = FRAME_1 | FRAME_2 | FRAME_3,
                  const unsigned int startMode = 0);
 
-    void findForward(const char *sequence, const size_t sequenceLength,
+    // codonFlags holds the CodonFlag bits of the codon starting at every position of the sequence
+    void findForward(const char *codonFlags, const size_t sequenceLength,
                      std::vector<Orf::SequenceLocation> &result,
                      const size_t minLength, const size_t maxLength, const size_t maxGaps,
                      const unsigned int frames, const unsigned int startMode, const Strand strand);
@@ -74,10 +99,19 @@ private:
     char* reverseComplement;
     size_t bufferSize;
 
-    char* stopCodons;
-    size_t stopCodonCount;
-    char* startCodons;
-    size_t startCodonCount;
+    enum CodonFlag {
+        CODON_VALID = 1,
+        CODON_START = 2,
+        CODON_STOP  = 4,
+        CODON_GAP   = 8
+    };
+
+    // start and stop flags of all unambiguous codons
+    CodonTable codonTable;
+    char* forwardFlags;
+    char* reverseFlags;
+
+    void fillCodonFlags();
 };
 
 #endif
@@ -43,6 +43,12 @@ Parameters::Parameters():
         PARAM_SUB_MAT(PARAM_SUB_MAT_ID,"--sub-mat", "Sub Matrix", "amino acid substitution matrix file",typeid(std::string),(void *) &scoringMatrixFile, "", MMseqsParameter::COMMAND_COMMON|MMseqsParameter::COMMAND_EXPERT),
         PARAM_NO_COMP_BIAS_CORR(PARAM_NO_COMP_BIAS_CORR_ID,"--comp-bias-corr", "Compositional bias","correct for locally biased amino acid composition [0,1]",typeid(int), (void *) &compBiasCorrection, "^[0-1]{1}$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_PROFILE|MMseqsParameter::COMMAND_EXPERT),
         PARAM_SPACED_KMER_MODE(PARAM_SPACED_KMER_MODE_ID,"--spaced-kmer-mode", "Spaced Kmer", "0: use consecutive positions a k-mers; 1: use spaced k-mers",typeid(int), (void *) &spacedKmer,  "^[0-1]{1}", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_QUERY_BATCH_SIZE(PARAM_QUERY_BATCH_SIZE_ID,"--query-batch-size", "Query batch size", "number of queries per thread whose k-mers are matched together in one sorted pass over the index table (1: one query at a time)",typeid(int), (void *) &queryBatchSize,  "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_KMER_CACHE_SIZE(PARAM_KMER_CACHE_SIZE_ID,"--kmer-cache-size", "k-mer list cache size", "number of similar k-mer lists shared by all threads, frequent query k-mers are expanded only once (0: no cache)",typeid(int), (void *) &kmerCacheSize,  "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_NUMA_MODE(PARAM_NUMA_MODE_ID,"--numa-mode", "NUMA mode", "0: no NUMA placement; 1: copy the index table to every NUMA node if memory allows, otherwise interleave it; 2: interleave the index table over the NUMA nodes. Threads are pinned to the nodes in modes 1 and 2",typeid(int), (void *) &numaMode,  "^[0-2]{1}$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_MPI_CHUNKS(PARAM_MPI_CHUNKS_ID,"--mpi-chunks", "MPI chunks", "0: every MPI rank processes a fixed share of the queries; >0: ranks request the next of this many query chunks from the master when they are done, so faster ranks process more chunks (prefilter: number of query splits, target splits are handed out the same way)",typeid(int), (void *) &mpiChunks,  "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_CHECKPOINT_CHUNKS(PARAM_CHECKPOINT_CHUNKS_ID,"--checkpoint-chunks", "Checkpoint chunks", "0: no checkpoints; >0: write the result in this many query chunks (prefilter: query splits, or the target splits if the target is split) and record every finished chunk in <resultDB>.checkpoint. A restarted run with the same settings skips the finished chunks",typeid(int), (void *) &checkpointChunks,  "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_METRICS_FILE(PARAM_METRICS_FILE_ID,"--metrics-file", "Metrics file", "write a JSON file with the time per prefilter stage, histograms of the posting list lengths and hits per query, and the idle time of every thread for each split (empty: no metrics)",typeid(std::string), (void *) &metricsFile,  "", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
         PARAM_REMOVE_TMP_FILES(PARAM_REMOVE_TMP_FILES_ID, "--remove-tmp-files", "Remove Temporary Files" , "Delete temporary files", typeid(bool), (void *) &removeTmpFiles, "",MMseqsParameter::COMMAND_EXPERT),
         PARAM_INCLUDE_IDENTITY(PARAM_INCLUDE_IDENTITY_ID,"--add-self-matches", "Include identical Seq. Id.","artificially add entries of queries with themselves (for clustering)",typeid(bool), (void *) &includeIdentity, "", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
         PARAM_RES_LIST_OFFSET(PARAM_RES_LIST_OFFSET_ID,"--offset-result", "Offset result","Offset result list",typeid(int), (void *) &resListOffset, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PREFILTER|MMseqsParameter::COMMAND_EXPERT),
@@ -121,6 +127,7 @@ Parameters::Parameters():
         PARAM_INCLUDE_ONLY_EXTENDABLE(PARAM_INCLUDE_ONLY_EXTENDABLE_ID, "--include-only-extendable", "Include only extendable", "Include only extendable", typeid(bool), (void*) &includeOnlyExtendable, "", MMseqsParameter::COMMAND_CLUSTLINEAR),
         PARAM_SKIP_N_REPEAT_KMER(PARAM_SKIP_N_REPEAT_KMER_ID, "--skip-n-repeat-kmer", "Skip sequence with n repeating k-mers", "Skip sequence with >= n exact repeating k-mers", typeid(int), (void*) &skipNRepeatKmer, "^[0-9]{1}[0-9]*", MMseqsParameter::COMMAND_CLUSTLINEAR|MMseqsParameter::COMMAND_EXPERT),
         PARAM_HASH_SHIFT(PARAM_HASH_SHIFT_ID, "--hash-shift", "Shift hash", "Shift k-mer hash", typeid(int), (void*) &hashShift, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_CLUSTLINEAR|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_KMER_SELECT_MODE(PARAM_KMER_SELECT_MODE_ID, "--kmer-select-mode", "K-mer selection mode", "K-mer selection: k-mers with lowest hash 0, windowed minimizers 1", typeid(int), (void*) &kmerSelectMode, "^[0-1]{1}$", MMseqsParameter::COMMAND_CLUSTLINEAR|MMseqsParameter::COMMAND_EXPERT),
         // workflow
         PARAM_RUNNER(PARAM_RUNNER_ID, "--mpi-runner", "Sets the MPI runner","use MPI on compute grid with this MPI command (e.g. \"mpirun -np 42\")",typeid(std::string),(void *) &runner, "", MMseqsParameter::COMMAND_EXPERT),
         // search workflow
@@ -139,6 +146,7 @@ Parameters::Parameters():
         PARAM_ORF_FORWARD_FRAMES(PARAM_ORF_FORWARD_FRAMES_ID, "--forward-frames", "Forward Frames", "comma-seperated list of ORF frames on the forward strand to be extracted", typeid(std::string), (void *) &forwardFrames, ""),
         PARAM_ORF_REVERSE_FRAMES(PARAM_ORF_REVERSE_FRAMES_ID, "--reverse-frames", "Reverse Frames", "comma-seperated list of ORF frames on the reverse strand to be extracted", typeid(std::string), (void *) &reverseFrames, ""),
         PARAM_USE_ALL_TABLE_STARTS(PARAM_USE_ALL_TABLE_STARTS_ID,"--use-all-table-starts", "Use all table starts", "use all alteratives for a start codon in the genetic table, if false - only ATG (AUG)",typeid(bool),(void *) &useAllTableStarts, ""),
+        PARAM_TRANSLATE(PARAM_TRANSLATE_ID,"--translate", "Translate orfs", "translate the orfs directly into an amino acid database instead of writing their nucleotide sequences",typeid(bool),(void *) &translate, ""),
         // indexdb
         PARAM_INCLUDE_HEADER(PARAM_INCLUDE_HEADER_ID, "--include-headers", "Include Header", "Include the header index into the index", typeid(bool), (void *) &includeHeader, ""),
         // createdb
@@ -199,7 +207,11 @@ Parameters::Parameters():
         PARAM_RECOVER_DELETED(PARAM_RECOVER_DELETED_ID, "--recover-deleted", "Recover Deleted", "Indicates if sequences are allowed to be be removed during updating", typeid(bool), (void*) &recoverDeleted, ""),
         PARAM_LCA_RANKS(PARAM_LCA_RANKS_ID, "--lca-ranks", "LCA Ranks", "Ranks to return in LCA computation", typeid(std::string), (void*) &lcaRanks, ""),
         PARAM_BLACKLIST(PARAM_BLACKLIST_ID, "--blacklist", "Blacklisted Taxa", "Comma separted list of ignored taxa in LCA computation", typeid(std::string), (void*)&blacklist, "([0-9]+,)?[0-9]+"),
-        PARAM_LCA_MODE(PARAM_LCA_MODE_ID, "--lca-mode", "LCA Mode", "LCA Mode: No LCA 0, Single Search LCA 1, 2bLCA 2", typeid(int), (void*) &lcaMode, "^[0-2]{1}$")
+        PARAM_LCA_MODE(PARAM_LCA_MODE_ID, "--lca-mode", "LCA Mode", "LCA Mode: No LCA 0, Single Search LCA 1, 2bLCA 2", typeid(int), (void*) &lcaMode, "^[0-2]{1}$"),
+        // createsubdb
+        PARAM_SUBDB_MODE(PARAM_SUBDB_MODE_ID, "--subdb-mode", "Subdb Mode", "SubDB Mode: copy data 0, soft link data and write only the index 1", typeid(int), (void*) &subDbMode, "^[0-1]{1}$"),
+        // quantizeprofiledb
+        PARAM_QUANT_BITS(PARAM_QUANT_BITS_ID, "--quant-bits", "Quantisation Bits", "Bits per profile score: 8 (lossless scores) or 4 (16 levels per profile)", typeid(int), (void*) &quantBits, "^[48]{1}$")
 {
     if (instance) {
         Debug(Debug::ERROR) << "Parameter instance already exists!\n";
@@ -228,6 +240,8 @@ Parameters::Parameters():
     align.push_back(PARAM_PCA);
     align.push_back(PARAM_PCB);
     align.push_back(PARAM_SCORE_BIAS);
+    align.push_back(PARAM_MPI_CHUNKS);
+    align.push_back(PARAM_CHECKPOINT_CHUNKS);
     align.push_back(PARAM_THREADS);
     align.push_back(PARAM_V);
 
@@ -252,6 +266,12 @@ Parameters::Parameters():
     prefilter.push_back(PARAM_MIN_DIAG_SCORE);
     prefilter.push_back(PARAM_INCLUDE_IDENTITY);
     prefilter.push_back(PARAM_SPACED_KMER_MODE);
+    prefilter.push_back(PARAM_QUERY_BATCH_SIZE);
+    prefilter.push_back(PARAM_KMER_CACHE_SIZE);
+    prefilter.push_back(PARAM_NUMA_MODE);
+    prefilter.push_back(PARAM_MPI_CHUNKS);
+    prefilter.push_back(PARAM_CHECKPOINT_CHUNKS);
+    prefilter.push_back(PARAM_METRICS_FILE);
     prefilter.push_back(PARAM_NO_PRELOAD);
     prefilter.push_back(PARAM_PCA);
     prefilter.push_back(PARAM_PCB);
@@ -268,6 +288,19 @@ Parameters::Parameters():
     // onlyverbosity
     onlyverbosity.push_back(PARAM_V);
 
+    // createsubdb
+    createsubdb.push_back(PARAM_SUBDB_MODE);
+    createsubdb.push_back(PARAM_V);
+
+    // quantizeprofiledb
+    quantizeprofiledb.push_back(PARAM_SUB_MAT);
+    quantizeprofiledb.push_back(PARAM_QUANT_BITS);
+    quantizeprofiledb.push_back(PARAM_MAX_SEQ_LEN);
+    quantizeprofiledb.push_back(PARAM_PCA);
+    quantizeprofiledb.push_back(PARAM_PCB);
+    quantizeprofiledb.push_back(PARAM_THREADS);
+    quantizeprofiledb.push_back(PARAM_V);
+
     // rescorediagonal
     rescorediagonal.push_back(PARAM_SUB_MAT);
     rescorediagonal.push_back(PARAM_RESCORE_MODE);
@@ -446,6 +479,8 @@ Parameters::Parameters():
     extractorfs.push_back(PARAM_ORF_REVERSE_FRAMES);    
     extractorfs.push_back(PARAM_TRANSLATION_TABLE);
     extractorfs.push_back(PARAM_USE_ALL_TABLE_STARTS);
+    extractorfs.push_back(PARAM_TRANSLATE);
+    extractorfs.push_back(PARAM_ADD_ORF_STOP);
     extractorfs.push_back(PARAM_ID_OFFSET);    
     extractorfs.push_back(PARAM_THREADS);
     extractorfs.push_back(PARAM_V);
@@ -587,6 +622,7 @@ Parameters::Parameters():
     kmermatcher.push_back(PARAM_C);
     kmermatcher.push_back(PARAM_MAX_SEQ_LEN);
     kmermatcher.push_back(PARAM_HASH_SHIFT);
+    kmermatcher.push_back(PARAM_KMER_SELECT_MODE);
     kmermatcher.push_back(PARAM_SPLIT_MEMORY_LIMIT);
     kmermatcher.push_back(PARAM_INCLUDE_ONLY_EXTENDABLE);
     kmermatcher.push_back(PARAM_SKIP_N_REPEAT_KMER);
@@ -1192,6 +1228,12 @@ void Parameters::setDefaults() {
     maskMode = 1;
     minDiagScoreThr = 15;
     spacedKmer = true;
+    queryBatchSize = 1;
+    kmerCacheSize = 0;
+    numaMode = NUMA_MODE_OFF;
+    mpiChunks = 0;
+    checkpointChunks = 0;
+    metricsFile = "";
     includeIdentity = false;
     alignmentMode = ALIGNMENT_MODE_FAST_AUTO;
     evalThr = 0.001;
@@ -1290,6 +1332,7 @@ void Parameters::setDefaults() {
     forwardFrames = "1,2,3";
     reverseFrames = "1,2,3";
     useAllTableStarts = false;
+    translate = false;
 
     // createdb
     identifierOffset = 0;
@@ -1364,6 +1407,7 @@ void Parameters::setDefaults() {
     includeOnlyExtendable = false;
     skipNRepeatKmer = 0;
     hashShift = 5;
+    kmerSelectMode = Parameters::KMER_SELECT_TOP_HASH;
 
     // result2stats
     stat = "";
@@ -1383,6 +1427,12 @@ void Parameters::setDefaults() {
 
     // taxonomy
     lcaMode = 2;
+
+    // createsubdb
+    subDbMode = Parameters::SUBDB_MODE_HARD;
+
+    // quantizeprofiledb
+    quantBits = Parameters::PROFILE_QUANT_BITS_8;
 }
 
 std::vector<MMseqsParameter> Parameters::combineList(const std::vector<MMseqsParameter> &par1,
@@ -76,6 +76,10 @@ public:
     static const int QUERY_DB_SPLIT = 1;
     static const int DETECT_BEST_DB_SPLIT = 2;
 
+    static const int NUMA_MODE_OFF = 0;
+    static const int NUMA_MODE_REPLICATE = 1;
+    static const int NUMA_MODE_INTERLEAVE = 2;
+
     static const int TAXONOMY_NO_LCA = 0;
     static const int TAXONOMY_SINGLE_SEARCH = 1;
     static const int TAXONOMY_2BLCA = 2;
@@ -124,10 +128,21 @@ public:
     static const int RESCORE_MODE_SUBSTITUTION = 1;
     static const int RESCORE_MODE_ALIGNMENT = 2;
 
+    // kmermatcher k-mer selection
+    static const int KMER_SELECT_TOP_HASH = 0;
+    static const int KMER_SELECT_MINIMIZER = 1;
     // header type
     static const int HEADER_TYPE_UNICLUST = 1;
     static const int HEADER_TYPE_METACLUST = 2;
 
+    // createsubdb
+    static const int SUBDB_MODE_HARD = 0;
+    static const int SUBDB_MODE_SOFT = 1;
+
+    // quantizeprofiledb
+    static const int PROFILE_QUANT_BITS_8 = 8;
+    static const int PROFILE_QUANT_BITS_4 = 4;
+
     // path to databases
     std::string db1;
     std::string db1Index;
@@ -194,6 +209,12 @@ public:
 
     int    minDiagScoreThr;              // min diagonal score
     int    spacedKmer;                   // Spaced Kmers
+    int    queryBatchSize;               // Queries matched together against the index table
+    int    kmerCacheSize;                // Similar k-mer lists shared by all threads
+    int    numaMode;                     // Placement of the index table on NUMA nodes
+    int    mpiChunks;                    // Query chunks handed out to MPI ranks on request
+    int    checkpointChunks;             // Query chunks recorded in a progress manifest
+    std::string metricsFile;             // JSON file with the prefilter stage times
     int    split;                        // Split database in n equal chunks
     int    splitMode;                    // Split by query or target DB
     int    splitMemoryLimit;             // Maximum amount of memory a split can use
@@ -247,6 +268,7 @@ public:
     std::string forwardFrames;
     std::string reverseFrames;
     bool useAllTableStarts;
+    bool translate;
 
     // convertprofiledb
     int profileMode;
@@ -307,6 +329,7 @@ public:
     bool includeOnlyExtendable;
     int skipNRepeatKmer;
     int hashShift;
+    int kmerSelectMode;
 
     // indexdb
     bool includeHeader;
@@ -392,6 +415,12 @@ public:
     // taxonomy
     int lcaMode;
 
+    // createsubdb
+    int subDbMode;
+
+    // quantizeprofiledb
+    int quantBits;
+
     static Parameters& getInstance()
     {
         if (instance == NULL) {
@@ -439,6 +468,12 @@ public:
     PARAMETER(PARAM_SUB_MAT)
     PARAMETER(PARAM_NO_COMP_BIAS_CORR)
     PARAMETER(PARAM_SPACED_KMER_MODE)
+    PARAMETER(PARAM_QUERY_BATCH_SIZE)
+    PARAMETER(PARAM_KMER_CACHE_SIZE)
+    PARAMETER(PARAM_NUMA_MODE)
+    PARAMETER(PARAM_MPI_CHUNKS)
+    PARAMETER(PARAM_CHECKPOINT_CHUNKS)
+    PARAMETER(PARAM_METRICS_FILE)
     PARAMETER(PARAM_REMOVE_TMP_FILES)
     PARAMETER(PARAM_INCLUDE_IDENTITY)
     PARAMETER(PARAM_RES_LIST_OFFSET)
@@ -532,6 +567,7 @@ public:
     PARAMETER(PARAM_INCLUDE_ONLY_EXTENDABLE)
     PARAMETER(PARAM_SKIP_N_REPEAT_KMER)
     PARAMETER(PARAM_HASH_SHIFT)
+    PARAMETER(PARAM_KMER_SELECT_MODE)
 
     // workflow
     PARAMETER(PARAM_RUNNER)
@@ -554,6 +590,7 @@ public:
     PARAMETER(PARAM_ORF_FORWARD_FRAMES)
     PARAMETER(PARAM_ORF_REVERSE_FRAMES)
     PARAMETER(PARAM_USE_ALL_TABLE_STARTS)
+    PARAMETER(PARAM_TRANSLATE)
 
     // indexdb
     PARAMETER(PARAM_INCLUDE_HEADER)
@@ -639,10 +676,18 @@ public:
     // taxonomy
     PARAMETER(PARAM_LCA_MODE)
 
+    // createsubdb
+    PARAMETER(PARAM_SUBDB_MODE)
+
+    // quantizeprofiledb
+    PARAMETER(PARAM_QUANT_BITS)
+
     std::vector<MMseqsParameter> empty;
     std::vector<MMseqsParameter> rescorediagonal;
     std::vector<MMseqsParameter> alignbykmer;
     std::vector<MMseqsParameter> onlyverbosity;
+    std::vector<MMseqsParameter> createsubdb;
+    std::vector<MMseqsParameter> quantizeprofiledb;
     std::vector<MMseqsParameter> createFasta;
     std::vector<MMseqsParameter> convertprofiledb;
     std::vector<MMseqsParameter> sequence2profile;
@@ -27,6 +27,7 @@ Sequence::Sequence(size_t maxLen, int seqType, const BaseMatrix *subMat, const u
     this->kmerWindow = NULL;
     this->aaPosInSpacedPattern = NULL;
     this->shouldAddPC = shouldAddPC;
+    this->profileNeedsDecode = false;
     if(spacedPatternSize){
         this->kmerWindow = new int[kmerSize];
         this->aaPosInSpacedPattern = new unsigned char[kmerSize];
@@ -268,6 +269,13 @@ void Sequence::mapProfileStateSequence(const char * sequence){
 
 
 void Sequence::mapProfile(const char * sequence, bool mapScores){
+    const unsigned char marker = static_cast<unsigned char>(sequence[0]);
+    if (marker == PROFILE_QUANT8_MARKER || marker == PROFILE_QUANT4_MARKER) {
+        mapQuantisedProfile(sequence, mapScores);
+        return;
+    }
+    profileNeedsDecode = false;
+
     char * data = (char *) sequence;
     size_t currPos = 0;
     float scoreBias = 0.0;
@@ -368,6 +376,99 @@ void Sequence::mapProfile(const char * sequence, bool mapScores){
 }
 
 
+void Sequence::mapQuantisedProfile(const char * sequence, bool mapScores){
+    const unsigned char *data = (const unsigned char *) sequence;
+    const bool isFourBit = (data[0] == PROFILE_QUANT4_MARKER);
+    uint32_t entryLength;
+    memcpy(&entryLength, data + 1, sizeof(uint32_t));
+    data += 1 + sizeof(uint32_t);
+
+    int minScore = 0;
+    int step = 1;
+    if (isFourBit) {
+        minScore = static_cast<int8_t>(data[0]);
+        step = data[1];
+        data += 2;
+    }
+
+    size_t l = entryLength;
+    if (l >= this->maxLen) {
+        Debug(Debug::ERROR) << "ERROR: Sequence with id: " << this->dbKey << " is longer than maxRes.\n";
+        l = this->maxLen;
+    }
+    this->L = l;
+
+    // scores are stored in the alignment layout, 8 bit rows are copied as they are
+    const size_t rowSize = isFourBit ? (entryLength + 1) / 2 : entryLength;
+    for (size_t aa = 0; aa < PROFILE_AA_SIZE; aa++) {
+        const unsigned char *row = data + aa * rowSize;
+        int8_t *alnRow = profile_for_alignment + aa * this->L;
+        if (isFourBit) {
+            for (int i = 0; i < this->L; i++) {
+                const int level = (row[i / 2] >> ((i & 1) * 4)) & 0x0F;
+                alnRow[i] = static_cast<int8_t>(minScore + level * step);
+            }
+        } else {
+            memcpy(alnRow, row, this->L * sizeof(int8_t));
+        }
+    }
+
+    const unsigned char *query = data + PROFILE_AA_SIZE * rowSize;
+    const unsigned char *consensus = query + entryLength;
+    const unsigned char *neff = consensus + entryLength;
+    for (int i = 0; i < this->L; i++) {
+        int_sequence[i] = query[i];
+        int_consensus_sequence[i] = consensus[i];
+        neffM[i] = MathUtil::convertNeffToFloat(neff[i]);
+    }
+
+    profileNeedsDecode = true;
+    if (mapScores == false) {
+        decodeQuantisedProfile();
+        return;
+    }
+
+    for (int i = 0; i < this->L; i++) {
+        for (size_t aa = 0; aa < PROFILE_AA_SIZE; aa++) {
+            profile_score[i * profile_row_size + aa] = profile_for_alignment[aa * this->L + i] * 4;
+        }
+    }
+
+    if (aaBiasCorrection == true) {
+        SubstitutionMatrix::calcGlobalAaBiasCorrection(subMat, profile_score, pNullBuffer, profile_row_size, this->L);
+    }
+
+    // sort profile scores and index for KmerGenerator (prefilter step)
+    for (int i = 0; i < this->L; i++) {
+        unsigned int indexArray[PROFILE_AA_SIZE] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19 };
+        Util::rankedDescSort20(&profile_score[i * profile_row_size], (unsigned int *) &indexArray);
+        memcpy(&profile_index[i * profile_row_size], &indexArray, PROFILE_AA_SIZE * sizeof(int));
+    }
+
+    // only the bias correction changes the alignment profile
+    if (aaBiasCorrection == true) {
+        for (int i = 0; i < this->L; i++) {
+            for (size_t aa_num = 0; aa_num < PROFILE_AA_SIZE; aa_num++) {
+                unsigned int aa_idx = profile_index[i * profile_row_size + aa_num];
+                profile_for_alignment[aa_idx * this->L + i] = profile_score[i * profile_row_size + aa_num] / 4;
+            }
+        }
+    }
+}
+
+void Sequence::decodeQuantisedProfile(){
+    // scores are in half bits (see mapProfile), with aaBiasCorrection the decoded
+    // probabilities include the correction
+    for (int i = 0; i < this->L; i++) {
+        float *column = &profile[i * PROFILE_AA_SIZE];
+        for (size_t aa = 0; aa < PROFILE_AA_SIZE; aa++) {
+            const float bitScore = static_cast<float>(profile_for_alignment[aa * this->L + i]) / 2.0f;
+            column[aa] = MathUtil::fpow2(bitScore) * subMat->pBack[aa];
+        }
+        MathUtil::NormalizeTo1(column, PROFILE_AA_SIZE);
+    }
+    profileNeedsDecode = false;
+}
 
 void Sequence::mapProfileState(const char * sequenze){
     mapProfile(sequenze, false);
@@ -568,6 +669,9 @@ unsigned int Sequence::getEffectiveKmerSize() {
 }
 
 const float *Sequence::getProfile() {
+    if (profileNeedsDecode) {
+        decodeQuantisedProfile();
+    }
     return profile;
 }
 
@@ -200,6 +200,16 @@ public:
     static const size_t PROFILE_AA_SIZE = 20;
     // 20 AA, 1 query, 1 consensus, 2 for Neff M,
     static const size_t PROFILE_READIN_SIZE = 23;
+
+    // Quantised profile entries (written by quantizeprofiledb) start with one of these markers.
+    // scoreMask never produces them, so they can be mixed with the column-wise format above.
+    // Layout: marker, uint32 L, [4 bit only: int8 min score, uint8 step],
+    //         20 score rows in the [aa][L] layout of profile_for_alignment
+    //         (8 bit: L bytes per row, 4 bit: (L+1)/2 bytes per row, even positions in the low nibble),
+    //         L query residues, L consensus residues, L Neff chars.
+    // Pseudocounts are part of the stored scores and are not added again when mapping.
+    static const unsigned char PROFILE_QUANT8_MARKER = 0xFF;
+    static const unsigned char PROFILE_QUANT4_MARKER = 0xFE;
     ScoreMatrix **profile_matrix;
     // Memory layout of this profile is qL * AA
     //   Query lenght
@@ -259,6 +269,12 @@ public:
 
 private:
     void mapSequence(const char *seq);
+
+    // map a quantised profile entry, see PROFILE_QUANT8_MARKER
+    void mapQuantisedProfile(const char *sequence, bool mapScores);
+
+    // recover probabilities of a quantised profile from profile_for_alignment
+    void decodeQuantisedProfile();
     size_t id;
     unsigned int dbKey;
     const char *seqData;
@@ -301,5 +317,8 @@ private:
     
     // should add pseudo-counts when loading the profile?
     bool shouldAddPC;
+
+    // profile only holds probabilities after decodeQuantisedProfile
+    bool profileNeedsDecode;
 };
 #endif
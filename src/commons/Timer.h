@@ -10,16 +10,21 @@ public:
     };
 
     std::string lap() {
-        struct timeval end;
-        gettimeofday(&end, NULL);
         std::ostringstream ss;
-        double timediff = (end.tv_sec - start.tv_sec) + 1e-6 * (end.tv_usec - start.tv_usec);
+        double timediff = elapsed();
         time_t sec = (time_t)timediff;
         time_t msec = (time_t)((timediff - sec) * 1e3);
         ss << (sec / 3600) << "h " << (sec % 3600 / 60) << "m " << (sec % 60) << "s " << msec << "ms";
         return ss.str();
     }
 
+    // seconds since construction or the last reset
+    double elapsed() {
+        struct timeval end;
+        gettimeofday(&end, NULL);
+        return (end.tv_sec - start.tv_sec) + 1e-6 * (end.tv_usec - start.tv_usec);
+    }
+
     void reset() {
         gettimeofday(&start, NULL);
     }
@@ -29,6 +29,7 @@
 #include <string>
 #include "Debug.h"
 #include "Util.h"
+#include "CodonTable.h"
 #include <set>
 #include <cmath>
 
@@ -251,6 +252,7 @@ public:
     // translation tables specific to each genetic code instance
     char  m_AminoAcid [4097];
     char  m_OrfStart  [4097];
+    CodonTable m_CodonTable;
 
     // translation finite state machine base codes - ncbi4na
     enum EBaseCode {
@@ -485,11 +487,106 @@ public:
                 }
             }
         }
+
+        // two bit codon table (A=0, C=1, G=2, T=3) for the SIMD kernels
+        static int  twoBitToCodonIdx [4] = {2, 1, 3, 0};
+        for (x = 0; x < 4; x++) {
+            for (y = 0; y < 4; y++) {
+                for (z = 0; z < 4; z++) {
+                    cd = 16 * twoBitToCodonIdx [x] + 4 * twoBitToCodonIdx [y] + twoBitToCodonIdx [z];
+                    m_CodonTable.setValue(16 * x + 4 * y + z, ncbieaa->at(cd));
+                }
+            }
+        }
     };
 
+    // amino acid of the codon at nucl and of its reverse complement
+    char translateCodon(const char *nucl) {
+        int state = 0;
+        for (int k = 0; k < 3; ++k) {
+            state = getCodonState(state, nucl[k]);
+        }
+        return getCodonResidue(state);
+    }
+
+    char translateReverseCodon(const char *nucl) {
+        int state = 0;
+        for (int k = 0; k < 3; ++k) {
+            state = getCodonState(state, nucl[k]);
+        }
+        return getCodonResidue(sm_RvCmpState[state]);
+    }
+
+    // Translates all six reading frames in one pass over the sequence.
+    // frames[0..2] are the forward frames starting at offset 0, 1, 2, frames[3..5] the frames of the
+    // reverse complement starting at its offset 0, 1, 2. Every frame needs room for L / 3 residues.
+    void translateSixFrames(const char *nucl, size_t L, char *frames[6], size_t lengths[6]) {
+        for (size_t f = 0; f < 3; f++) {
+            lengths[f] = (L >= f + 3) ? (L - f) / 3 : 0;
+            lengths[f + 3] = lengths[f];
+        }
+        if (L < 3) {
+            return;
+        }
+        const size_t codons = L - 2;
+        const __m128i reverseMask = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        __m128i missing = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 64 <= L; i += 48) {
+            __m128i forward[3];
+            __m128i reverse[3];
+            m_CodonTable.lookupBlock(nucl + i, forward, reverse);
+            for (size_t m = 0; m < 3; m++) {
+                // codons i + m + 3t are residue i / 3 + t of forward frame m
+                __m128i residues = CodonTable::everyThird(forward[0], forward[1], forward[2], m);
+                missing = _mm_or_si128(missing, _mm_cmpeq_epi8(residues, _mm_setzero_si128()));
+                _mm_storeu_si128((__m128i *) (frames[m] + i / 3), residues);
+
+                // on the reverse complement they are at k = codons - 1 - (i + m + 3t), in descending order
+                size_t k = codons - 1 - (i + m);
+                residues = CodonTable::everyThird(reverse[0], reverse[1], reverse[2], m);
+                missing = _mm_or_si128(missing, _mm_cmpeq_epi8(residues, _mm_setzero_si128()));
+                _mm_storeu_si128((__m128i *) (frames[3 + k % 3] + k / 3 - 15), _mm_shuffle_epi8(residues, reverseMask));
+            }
+        }
+        for (; i < codons; i++) {
+            size_t k = codons - 1 - i;
+            frames[i % 3][i / 3] = translateCodon(nucl + i);
+            frames[3 + k % 3][k / 3] = translateReverseCodon(nucl + i);
+        }
+
+        // codons with ambiguous or unknown bases go through the state machine
+        if (_mm_movemask_epi8(missing) != 0) {
+            for (size_t f = 0; f < 3; f++) {
+                for (size_t j = 0; j < lengths[f]; j++) {
+                    if (frames[f][j] == '\0') {
+                        frames[f][j] = translateCodon(nucl + f + 3 * j);
+                    }
+                    if (frames[3 + f][j] == '\0') {
+                        frames[3 + f][j] = translateReverseCodon(nucl + codons - 1 - (f + 3 * j));
+                    }
+                }
+            }
+        }
+    }
+
     void translate(char *aa, const char *nucl, int L) {
+        int i = 0;
+        // 16 codons per block, the block reads 64 bytes
+        for (; i + 64 <= L; i += 48) {
+            __m128i forward[3];
+            m_CodonTable.lookupBlock(nucl + i, forward, NULL);
+            __m128i residues = CodonTable::everyThird(forward[0], forward[1], forward[2], 0);
+            _mm_storeu_si128((__m128i *) (aa + i / 3), residues);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(residues, _mm_setzero_si128())) != 0) {
+                for (int j = i; j < i + 48; j += 3) {
+                    aa[j / 3] = translateCodon(nucl + j);
+                }
+            }
+        }
+
         int state = 0;
-        for (int i = 0;  i < L;  i += 3) {
+        for (;  i < L;  i += 3) {
             // loop through one codon at a time
             for (int k = 0;  k < 3;  ++k) {
                 state = getCodonState(state, nucl[i+k]);
@@ -16,6 +16,7 @@
 #endif
 
 #include <fstream>
+#include <cstring>
 #include <algorithm>
 
 KSEQ_INIT(int, read)
@@ -193,17 +194,34 @@ index[y] = tmp2;      \
 
 // find start and end position of an identifier in a FASTA header
 std::pair<ssize_t,ssize_t> Util::getFastaHeaderPosition(const std::string& header) {
+    return getFastaHeaderPosition(header.c_str(), header.length());
+}
+
+static size_t findFirstOf(const char *str, size_t length, size_t start, char c1, char c2) {
+    for (size_t i = start; i < length; ++i) {
+        if (str[i] == c1 || str[i] == c2) {
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+static bool startWithAt(const char *prefix, size_t prefixLength, const char *str, size_t length, size_t offset) {
+    return offset + prefixLength <= length && memcmp(str + offset, prefix, prefixLength) == 0;
+}
+
+std::pair<ssize_t,ssize_t> Util::getFastaHeaderPosition(const char *header, size_t length) {
     const std::pair<size_t, size_t> errorPosition = std::make_pair(-1, -1);
-    if (header.length() == 0)
+    if (length == 0)
         return errorPosition;
 
     size_t offset = 0;
-    if (Util::startWith("consensus_", header)) {
+    if (startWithAt("consensus_", 10, header, length, 0)) {
         offset = 10;
     }
 
     struct Databases {
-        std::string prefix;
+        const char *prefix;
         unsigned int length;
         unsigned int verticalBarPos;
     };
@@ -227,11 +245,11 @@ std::pair<ssize_t,ssize_t> Util::getFastaHeaderPosition(const std::string& heade
     const unsigned int database_count = 14;
 
     for (size_t i = 0; i < database_count; ++i) {
-        if (Util::startWith(databases[i].prefix, header, offset)) {
+        if (startWithAt(databases[i].prefix, databases[i].length, header, length, offset)) {
             size_t start = offset + databases[i].length;
             if (databases[i].verticalBarPos > 1) {
                 for (size_t j = 0; j < databases[i].verticalBarPos - 1; ++j) {
-                    size_t end = header.find_first_of('|', start);
+                    size_t end = findFirstOf(header, length, start, '|', '|');
                     if (end != std::string::npos) {
                         start = end + 1;
                     } else {
@@ -240,16 +258,16 @@ std::pair<ssize_t,ssize_t> Util::getFastaHeaderPosition(const std::string& heade
                 }
             }
 
-            size_t end = header.find_first_of('|', start);
+            size_t end = findFirstOf(header, length, start, '|', '|');
             if (end != std::string::npos) {
                 return std::make_pair(start, end);
             } else {
-                end = header.find_first_of(" \n", start);
+                end = findFirstOf(header, length, start, ' ', '\n');
                 if (end != std::string::npos) {
                     return std::make_pair(start, end);
                 } else {
                     // return until the end of the line
-                    return std::make_pair(start, header.length());
+                    return std::make_pair(start, length);
                 }
             }
         }
@@ -257,12 +275,12 @@ std::pair<ssize_t,ssize_t> Util::getFastaHeaderPosition(const std::string& heade
 
     // if we can not find one of the existing database ids,
     // we use the first part of the string or the whole string
-    size_t end = header.find_first_of(" \n", offset);
+    size_t end = findFirstOf(header, length, offset, ' ', '\n');
     if (end != std::string::npos) {
         return std::make_pair(offset, end);
     } else {
         // return until the end of the line
-        return std::make_pair(offset, header.length());
+        return std::make_pair(offset, length);
     }
 }
 
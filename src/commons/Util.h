@@ -217,6 +217,8 @@ public:
 
 
     static std::pair<ssize_t,ssize_t> getFastaHeaderPosition(const std::string& header);
+    // same for a header that is not zero terminated
+    static std::pair<ssize_t,ssize_t> getFastaHeaderPosition(const char *header, size_t length);
     static std::string parseFastaHeader(const std::string& header);
 
     static inline char toUpper(char character){
@@ -111,14 +111,20 @@ std::vector<struct Command> commands = {
                 "Compute taxonomy and lowest common ancestor for each sequence.",
                 NULL,
                 "Milot Mirdita <milot@mirdita.de>",
-                "<i:queryDB> <i:targetDB> <i:targetTaxonMapping> <i:NcbiTaxdmpDir> <o:taxaDB> <tmpDir>",
+                "<i:queryDB> <i:targetDB> <i:targetTaxonMapping> <i:NcbiTaxdmpDir|taxonomyFile> <o:taxaDB> <tmpDir>",
                 CITATION_MMSEQS2
         },
         {"lca",                  lca,                  &par.lca,                  COMMAND_TAXONOMY,
                 "Compute the lowest common ancestor from a set of taxa.",
                 NULL,
                 "Milot Mirdita <milot@mirdita.de>",
-                "<i:taxaDB> <i:NcbiTaxdmpDir> <o:taxaDB>",
+                "<i:taxaDB> <i:NcbiTaxdmpDir|taxonomyFile> <o:taxaDB>",
+                CITATION_MMSEQS2},
+        {"createtaxdb",          createtaxdb,          &par.onlyverbosity,        COMMAND_TAXONOMY,
+                "Convert the NCBI taxdump into a binary taxonomy file that lca and taxonomy map directly.",
+                "The file contains the flat node and taxon id tables, the Euler tour and the range minimum query table. It can be used instead of the NcbiTaxdmpDir.",
+                "Milot Mirdita <milot@mirdita.de>",
+                "<i:NcbiTaxdmpDir> <o:taxonomyFile>",
                 CITATION_MMSEQS2},
 // multi hit search
         {"multihitdb",           multihitdb,           &par.multihitdb,           COMMAND_MULTIHIT,
@@ -288,7 +294,7 @@ std::vector<struct Command> commands = {
                 "Clovis Galiez & Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
                 "<i:resultDB> <o:resultDB>",
                 CITATION_MMSEQS2},
-        {"createsubdb",          createsubdb,          &par.onlyverbosity,        COMMAND_DB,
+        {"createsubdb",          createsubdb,          &par.createsubdb,         COMMAND_DB,
                 "Create a subset of a DB from a file of IDs of entries",
                 NULL,
                 "Milot Mirdita <milot@mirdita.de>",
@@ -336,6 +342,12 @@ std::vector<struct Command> commands = {
                 "Milot Mirdita <milot@mirdita.de>",
                 "<i:profileDB> <o:pssmFile>",
                 CITATION_MMSEQS2},
+        {"quantizeprofiledb",    quantizeprofiledb,    &par.quantizeprofiledb,    COMMAND_DB,
+                "Converts a profile database into a compact database of 8 or 4 bit quantised scores.",
+                "Pseudocounts are added before quantising. The result can be used as query or target of prefilter and align.",
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:profileDB> <o:profileDB>",
+                CITATION_MMSEQS2},
         {"profile2cs",         profile2cs,         &par.profile2cs,         COMMAND_DB,
                 "Converts a profile database into a column state sequence.",
                 NULL,
@@ -15,6 +15,7 @@ template<unsigned int BINSIZE> CacheFriendlyOperations<BINSIZE>::CacheFriendlyOp
     // find nearest upper power of 2^(x)
     initBinSize = pow(2, ceil(log(initBinSize)/log(2)));
     binSize = initBinSize;
+    defaultBinSize = initBinSize;
     tmpElementBuffer = new(std::nothrow) TmpResult[binSize];
     Util::checkAllocation(tmpElementBuffer, "Could not allocate tmpElementBuffer memory in CacheFriendlyOperations");
 
@@ -35,6 +36,17 @@ template<unsigned int BINSIZE> size_t CacheFriendlyOperations<BINSIZE>::countEle
                                                                               size_t outputSize, unsigned short indexFrom, unsigned short indexTo,
                                                                               bool computeTotalScore)
 {
+    // size the bins for the number of hits up front, growing them one overflow at a time
+    // would hash large queries several times
+    const size_t hitsPerBin = (input[indexTo] - input[indexFrom]) / BINCOUNT;
+    if (hitsPerBin + hitsPerBin / 4 > binSize) {
+        binSize = pow(2, ceil(log(hitsPerBin + hitsPerBin / 4)/log(2)));
+        reallocBinMemory(BINCOUNT, binSize);
+    } else if (binSize > defaultBinSize && hitsPerBin + hitsPerBin / 4 <= defaultBinSize) {
+        // an earlier query grew the bins, free the memory again
+        binSize = defaultBinSize;
+        reallocBinMemory(BINCOUNT, binSize);
+    }
     newStart:
     setupBinPointer(bins, BINCOUNT, binDataFrame, binSize);
     CounterResult * lastPosition = (binDataFrame + BINCOUNT * binSize) - 1;
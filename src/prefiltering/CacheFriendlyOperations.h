@@ -80,6 +80,8 @@ private:
     // needed for lower bit hashing function
     const static unsigned int BINCOUNT = MASK_0_5 + 1;
     size_t binSize;
+    // bin size for the default hit buffer of the QueryMatcher
+    size_t defaultBinSize;
     // pointer for hashing
     CounterResult ** bins;
     // array to keep the bin elements
@@ -1,6 +1,13 @@
 #include "IndexBuilder.h"
 #include "tantan.h"
 
+#include <cstring>
+#include <new>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
 char* getScoreLookup(BaseMatrix &matrix) {
     char *idScoreLookup = NULL;
     idScoreLookup = new char[matrix.alphabetSize];
@@ -53,6 +60,9 @@ public:
 };
 
 
+// k-mers of one bucket share the high bits, the low bits fit into an unsigned short
+static const unsigned int BUCKET_BITS = 16;
+
 void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedLookup, SequenceLookup **unmaskedLookup,
                                 BaseMatrix &subMat, Sequence *seq,
                                 DBReader<unsigned int> *dbr, size_t dbFrom, size_t dbTo, int kmerThr) {
@@ -64,7 +74,7 @@ void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedL
     size_t dbSize = dbTo - dbFrom;
     DbInfo* info = new DbInfo(dbFrom, dbTo, seq->getEffectiveKmerSize(), isProfile, dbr->getSeqLens());
 
-    SequenceLookup *sequenceLookup;
+    SequenceLookup *sequenceLookup = NULL;
     if (unmaskedLookup != NULL && maskedLookup == NULL) {
         *unmaskedLookup = new SequenceLookup(dbSize, info->aaDbSize);
         sequenceLookup = *unmaskedLookup;
@@ -89,6 +99,22 @@ void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedL
         idScoreLookup = getScoreLookup(subMat);
     }
 
+    // Sequence k-mers are counted per chunk of consecutive sequences and per bucket of k-mers instead
+    // of incrementing shared counters. The chunks are filled in the same order in the second pass,
+    // so every bucket receives its entries sorted by sequence id.
+    unsigned int threads = 1;
+#ifdef OPENMP
+    threads = static_cast<unsigned int>(omp_get_max_threads());
+#endif
+    const size_t tableSize = indexTable->getTableSize();
+    const size_t bucketCount = (tableSize >> BUCKET_BITS) + 1;
+    const size_t chunkCount = std::max(static_cast<size_t>(1), std::min(dbSize, static_cast<size_t>(threads) * 4));
+    size_t *chunkBucketCounts = NULL;
+    if (isProfile == false) {
+        chunkBucketCounts = new size_t[chunkCount * bucketCount];
+        memset(chunkBucketCounts, 0, chunkCount * bucketCount * sizeof(size_t));
+    }
+
     size_t maskedResidues = 0;
     size_t totalKmerCount = 0;
     #pragma omp parallel
@@ -102,51 +128,60 @@ void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedL
             generator->setDivideStrategy(s.profile_matrix);
         }
 
-        unsigned int *buffer = new unsigned int[seq->getMaxLen()];
+        IndexEntryLocalTmp *buffer = new IndexEntryLocalTmp[seq->getMaxLen()];
         char *charSequence = new char[seq->getMaxLen()];
 
-        #pragma omp for schedule(dynamic, 100) reduction(+:totalKmerCount, maskedResidues)
-        for (size_t id = dbFrom; id < dbTo; id++) {
-            Debug::printProgress(id - dbFrom);
-
-            s.resetCurrPos();
-            char *seqData = dbr->getData(id);
-            unsigned int qKey = dbr->getDbKey(id);
-            s.mapSequence(id - dbFrom, qKey, seqData);
-
-            // count similar or exact k-mers based on sequence type
-            if (isProfile) {
-                // Find out if we should also mask profiles
-                totalKmerCount += indexTable->addSimilarKmerCount(&s, generator);
-                (*unmaskedLookup)->addSequence(s.int_consensus_sequence, s.L, id - dbFrom, info->sequenceOffsets[id - dbFrom]);
-            } else {
-                // Do not mask if column state sequences are used
-                if (unmaskedLookup != NULL) {
-                    (*unmaskedLookup)->addSequence(s.int_sequence, s.L, id - dbFrom, info->sequenceOffsets[id - dbFrom]);
-                }
-                if (maskedLookup != NULL) {
-                    for (int i = 0; i < s.L; ++i) {
-                        charSequence[i] = (char) s.int_sequence[i];
+        #pragma omp for schedule(dynamic, 1) reduction(+:totalKmerCount, maskedResidues)
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            size_t *bucketCounts = (chunkBucketCounts != NULL) ? chunkBucketCounts + chunk * bucketCount : NULL;
+            const size_t chunkFrom = dbFrom + (chunk * dbSize) / chunkCount;
+            const size_t chunkTo = dbFrom + ((chunk + 1) * dbSize) / chunkCount;
+            for (size_t id = chunkFrom; id < chunkTo; id++) {
+                Debug::printProgress(id - dbFrom);
+
+                s.resetCurrPos();
+                char *seqData = dbr->getData(id);
+                unsigned int qKey = dbr->getDbKey(id);
+                s.mapSequence(id - dbFrom, qKey, seqData);
+
+                // count similar or exact k-mers based on sequence type
+                if (isProfile) {
+                    // Find out if we should also mask profiles
+                    totalKmerCount += indexTable->addSimilarKmerCount(&s, generator);
+                    (*unmaskedLookup)->addSequence(s.int_consensus_sequence, s.L, id - dbFrom, info->sequenceOffsets[id - dbFrom]);
+                } else {
+                    // Do not mask if column state sequences are used
+                    if (unmaskedLookup != NULL) {
+                        (*unmaskedLookup)->addSequence(s.int_sequence, s.L, id - dbFrom, info->sequenceOffsets[id - dbFrom]);
                     }
-                    // s.print();
-                    maskedResidues += tantan::maskSequences(charSequence,
-                                                            charSequence + s.L,
-                                                            50 /*options.maxCycleLength*/,
-                                                            probMatrix->probMatrixPointers,
-                                                            0.005 /*options.repeatProb*/,
-                                                            0.05 /*options.repeatEndProb*/,
-                                                            0.9 /*options.repeatOffsetProbDecay*/,
-                                                            0, 0,
-                                                            0.9 /*options.minMaskProb*/,
-                                                            probMatrix->hardMaskTable);
-
-                    for (int i = 0; i < s.L; i++) {
-                        s.int_sequence[i] = charSequence[i];
+                    if (maskedLookup != NULL) {
+                        for (int i = 0; i < s.L; ++i) {
+                            charSequence[i] = (char) s.int_sequence[i];
+                        }
+                        // s.print();
+                        maskedResidues += tantan::maskSequences(charSequence,
+                                                                charSequence + s.L,
+                                                                50 /*options.maxCycleLength*/,
+                                                                probMatrix->probMatrixPointers,
+                                                                0.005 /*options.repeatProb*/,
+                                                                0.05 /*options.repeatEndProb*/,
+                                                                0.9 /*options.repeatOffsetProbDecay*/,
+                                                                0, 0,
+                                                                0.9 /*options.minMaskProb*/,
+                                                                probMatrix->hardMaskTable);
+
+                        for (int i = 0; i < s.L; i++) {
+                            s.int_sequence[i] = charSequence[i];
+                        }
+                        (*maskedLookup)->addSequence(s.int_sequence, s.L, id - dbFrom, info->sequenceOffsets[id - dbFrom]);
                     }
-                    (*maskedLookup)->addSequence(s.int_sequence, s.L, id - dbFrom, info->sequenceOffsets[id - dbFrom]);
-                }
 
-                totalKmerCount += indexTable->addKmerCount(&s, &idxer, buffer, kmerThr, idScoreLookup);
+                    const size_t kmerCount = indexTable->getSequenceKmers(&s, &idxer, buffer, kmerThr, idScoreLookup);
+                    for (size_t i = 0; i < kmerCount; i++) {
+                        bucketCounts[buffer[i].kmer >> BUCKET_BITS]++;
+                    }
+                    totalKmerCount += kmerCount;
+                }
             }
         }
 
@@ -189,52 +224,135 @@ void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedL
 //    Debug(Debug::INFO) << "Index table: Remove "<< lowSelectiveResidues <<" none selective residues\n";
 //    Debug(Debug::INFO) << "Index table: init... from "<< dbFrom << " to "<< dbTo << "\n";
 
-    indexTable->initMemory(info->tableSize);
-    indexTable->init();
+    if (isProfile) {
+        indexTable->initMemory(info->tableSize);
+        indexTable->init();
+    } else {
+        indexTable->initMemory(info->tableSize, totalKmerCount);
+    }
 
     delete info;
     info = NULL;
 
     Debug(Debug::INFO) << "Index table: fill...\n";
+    if (isProfile) {
+        #pragma omp parallel
+        {
+            Sequence s(seq->getMaxLen(), seq->getSeqType(), &subMat, seq->getKmerSize(), seq->isSpaced(), false);
+            Indexer idxer(static_cast<unsigned int>(indexTable->getAlphabetSize()), seq->getKmerSize());
+            KmerGenerator generator(seq->getKmerSize(), indexTable->getAlphabetSize(), kmerThr);
+            generator.setDivideStrategy(s.profile_matrix);
+
+            #pragma omp for schedule(dynamic, 100)
+            for (size_t id = dbFrom; id < dbTo; id++) {
+                s.resetCurrPos();
+                Debug::printProgress(id - dbFrom);
+                s.mapSequence(id - dbFrom, dbr->getDbKey(id), dbr->getData(id));
+                indexTable->addSimilarSequence(&s, &generator, &idxer);
+            }
+        }
+        indexTable->sortDBSeqLists();
+        Debug(Debug::INFO) << "\nIndex table: removing duplicate entries...\n";
+        indexTable->revertPointer();
+    } else {
+        fillBuckets(indexTable, subMat, seq, dbr, sequenceLookup, dbFrom, dbTo, kmerThr, idScoreLookup,
+                    chunkBucketCounts, chunkCount, bucketCount);
+        delete[] chunkBucketCounts;
+    }
+    if(idScoreLookup!=NULL){
+        delete[] idScoreLookup;
+    }
+    Debug(Debug::INFO) << "\nIndex table init done.\n\n";
+}
+
+void IndexBuilder::fillBuckets(IndexTable *indexTable, BaseMatrix &subMat, Sequence *seq, DBReader<unsigned int> *dbr,
+                               SequenceLookup *sequenceLookup, size_t dbFrom, size_t dbTo, int kmerThr, char *idScoreLookup,
+                               size_t *chunkBucketCounts, size_t chunkCount, size_t bucketCount) {
+    const size_t dbSize = dbTo - dbFrom;
+    const size_t tableSize = indexTable->getTableSize();
+
+    // prefix sum over buckets and, inside a bucket, over chunks gives the first entry of every chunk
+    size_t *bucketStart = new size_t[bucketCount + 1];
+    size_t offset = 0;
+    for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+        bucketStart[bucket] = offset;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            const size_t count = chunkBucketCounts[chunk * bucketCount + bucket];
+            chunkBucketCounts[chunk * bucketCount + bucket] = offset;
+            offset += count;
+        }
+    }
+    bucketStart[bucketCount] = offset;
+
+    // low k-mer bits of every entry until the buckets are sorted
+    IndexEntryLocal *entries = indexTable->getEntries();
+    unsigned short *kmerLow = new(std::nothrow) unsigned short[offset];
+    Util::checkAllocation(kmerLow, "Could not allocate kmerLow memory in IndexBuilder::fillBuckets");
+
     #pragma omp parallel
     {
         Sequence s(seq->getMaxLen(), seq->getSeqType(), &subMat, seq->getKmerSize(), seq->isSpaced(), false);
         Indexer idxer(static_cast<unsigned int>(indexTable->getAlphabetSize()), seq->getKmerSize());
         IndexEntryLocalTmp *buffer = new IndexEntryLocalTmp[seq->getMaxLen()];
 
-        KmerGenerator *generator = NULL;
-        if (isProfile) {
-            generator = new KmerGenerator(seq->getKmerSize(), indexTable->getAlphabetSize(), kmerThr);
-            generator->setDivideStrategy(s.profile_matrix);
-        }
-
-        #pragma omp for schedule(dynamic, 100)
-        for (size_t id = dbFrom; id < dbTo; id++) {
-            s.resetCurrPos();
-            Debug::printProgress(id - dbFrom);
-
-            unsigned int qKey = dbr->getDbKey(id);
-            if (isProfile) {
-                s.mapSequence(id - dbFrom, qKey, dbr->getData(id));
-                indexTable->addSimilarSequence(&s, generator, &idxer);
-            } else {
-                s.mapSequence(id - dbFrom, qKey, sequenceLookup->getSequence(id - dbFrom));
-                indexTable->addSequence(&s, &idxer, buffer, kmerThr, idScoreLookup);
+        #pragma omp for schedule(dynamic, 1)
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            size_t *bucketPos = chunkBucketCounts + chunk * bucketCount;
+            const size_t chunkFrom = dbFrom + (chunk * dbSize) / chunkCount;
+            const size_t chunkTo = dbFrom + ((chunk + 1) * dbSize) / chunkCount;
+            for (size_t id = chunkFrom; id < chunkTo; id++) {
+                Debug::printProgress(id - dbFrom);
+                s.resetCurrPos();
+                s.mapSequence(id - dbFrom, dbr->getDbKey(id), sequenceLookup->getSequence(id - dbFrom));
+                const size_t kmerCount = indexTable->getSequenceKmers(&s, &idxer, buffer, kmerThr, idScoreLookup);
+                for (size_t i = 0; i < kmerCount; i++) {
+                    const size_t pos = bucketPos[buffer[i].kmer >> BUCKET_BITS]++;
+                    entries[pos].seqId = buffer[i].seqId;
+                    entries[pos].position_j = buffer[i].position_j;
+                    kmerLow[pos] = static_cast<unsigned short>(buffer[i].kmer);
+                }
             }
         }
+        delete[] buffer;
+    }
 
-        if (generator != NULL) {
-            delete generator;
+    // stable counting sort of every bucket by k-mer, the lists stay sorted by sequence id
+    size_t *offsets = indexTable->getOffsets();
+    #pragma omp parallel
+    {
+        const size_t bucketWidth = static_cast<size_t>(1) << BUCKET_BITS;
+        size_t *kmerStart = new size_t[bucketWidth];
+        std::vector<IndexEntryLocal> sorted;
+
+        #pragma omp for schedule(dynamic, 1)
+        for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+            const size_t from = bucketStart[bucket];
+            const size_t to = bucketStart[bucket + 1];
+            const size_t firstKmer = bucket << BUCKET_BITS;
+            const size_t kmers = std::min(bucketWidth, tableSize - std::min(tableSize, firstKmer));
+            memset(kmerStart, 0, kmers * sizeof(size_t));
+            for (size_t i = from; i < to; i++) {
+                kmerStart[kmerLow[i]]++;
+            }
+            size_t start = 0;
+            for (size_t kmer = 0; kmer < kmers; kmer++) {
+                const size_t count = kmerStart[kmer];
+                kmerStart[kmer] = start;
+                offsets[firstKmer + kmer] = from + start;
+                start += count;
+            }
+            sorted.resize(to - from);
+            for (size_t i = from; i < to; i++) {
+                sorted[kmerStart[kmerLow[i]]++] = entries[i];
+            }
+            if (to > from) {
+                memcpy(entries + from, sorted.data(), (to - from) * sizeof(IndexEntryLocal));
+            }
         }
-
-        delete [] buffer;
-    }
-    if(idScoreLookup!=NULL){
-        delete[] idScoreLookup;
+        delete[] kmerStart;
     }
+    offsets[tableSize] = bucketStart[bucketCount];
 
-    indexTable->sortDBSeqLists();
-    Debug(Debug::INFO) << "\nIndex table: removing duplicate entries...\n";
-    indexTable->revertPointer();
-    Debug(Debug::INFO) << "Index table init done.\n\n";
+    delete[] kmerLow;
+    delete[] bucketStart;
 }
@@ -8,6 +8,12 @@ public:
     static void fillDatabase(IndexTable *indexTable, SequenceLookup **maskedLookup, SequenceLookup **unmaskedLookup,
                              BaseMatrix &subMat, Sequence *seq,
                              DBReader<unsigned int> *dbr, size_t dbFrom, size_t dbTo, int kmerThr);
+
+private:
+    // writes the k-mers of the sequences bucket by bucket without shared counters, the lists end up sorted by sequence id
+    static void fillBuckets(IndexTable *indexTable, BaseMatrix &subMat, Sequence *seq, DBReader<unsigned int> *dbr,
+                            SequenceLookup *sequenceLookup, size_t dbFrom, size_t dbTo, int kmerThr, char *idScoreLookup,
+                            size_t *chunkBucketCounts, size_t chunkCount, size_t bucketCount);
 };
 
 #endif
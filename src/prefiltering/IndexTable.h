@@ -127,56 +127,6 @@ public:
         return countUniqKmer;
     }
 
-    // count k-mers in the sequence, so enough memory for the sequence lists can be allocated in the end
-    size_t addKmerCount(Sequence *s, Indexer *idxer, unsigned int *seqKmerPosBuffer,
-                        int threshold, char *diagonalScore) {
-        s->resetCurrPos();
-        size_t countKmer = 0;
-        bool removeX = (s->getSequenceType() == Sequence::NUCLEOTIDES ||
-                        s->getSequenceType() == Sequence::AMINO_ACIDS);
-        const int xIndex = s->subMat->aa2int[(int)'X'];
-        while(s->hasNextKmer()){
-            const int * kmer = s->nextKmer();
-            if(removeX){
-                int xCount = 0;
-                for(int pos = 0; pos < kmerSize; pos++){
-                    xCount += (kmer[pos] == xIndex);
-                }
-                if(xCount > 0){
-                    continue;
-                }
-            }
-            if(threshold > 0){
-                int score = 0;
-                for(int pos = 0; pos < kmerSize; pos++){
-                    score += diagonalScore[kmer[pos]];
-                }
-                if(score < threshold){
-                    continue;
-                }
-            }
-            unsigned int kmerIdx = idxer->int2index(kmer, 0, kmerSize);
-            seqKmerPosBuffer[countKmer] = kmerIdx;
-            countKmer++;
-        }
-        if(countKmer > 1){
-            std::sort(seqKmerPosBuffer, seqKmerPosBuffer + countKmer);
-        }
-        size_t countUniqKmer = 0;
-        unsigned int prevKmerIdx = UINT_MAX;
-        for(size_t i = 0; i < countKmer; i++){
-            unsigned int kmerIdx = seqKmerPosBuffer[i];
-            if(prevKmerIdx != kmerIdx){
-                //table[kmerIdx] += 1;
-                // size increases by one
-                __sync_fetch_and_add(&(offsets[kmerIdx]), 1);
-                countUniqKmer++;
-            }
-            prevKmerIdx = kmerIdx;
-        }
-        return countUniqKmer;
-    }
-
     // get list of DB sequences containing this k-mer
     inline IndexEntryLocal *getDBSeqList(int kmer, size_t *matchedListSize) {
         const ptrdiff_t diff = offsets[kmer + 1] - offsets[kmer];
@@ -184,6 +134,21 @@ public:
         return (entries + offsets[kmer]);
     }
 
+    // Lookups of similar k-mers hit random places of the offsets and entries arrays.
+    // The matcher keeps a window of lookups in flight: the offset of the k-mer
+    // PREFETCH_OFFSET_DISTANCE ahead and the list head of the k-mer PREFETCH_LIST_DISTANCE
+    // ahead are prefetched, by then the offset of the latter is already cached.
+    static const size_t PREFETCH_OFFSET_DISTANCE = 16;
+    static const size_t PREFETCH_LIST_DISTANCE = 8;
+
+    inline void prefetchOffset(unsigned int kmer) const {
+        __builtin_prefetch(offsets + kmer);
+    }
+
+    inline void prefetchDBSeqList(unsigned int kmer) const {
+        __builtin_prefetch(entries + offsets[kmer]);
+    }
+
     void sortDBSeqLists() {
         #pragma omp parallel for
         for (size_t i = 0; i < getTableSize(); i++) {
@@ -221,6 +186,15 @@ public:
         Util::checkAllocation(entries, "Could not allocate entries memory in IndexTable::initMemory");
     }
 
+    // init the arrays for tableEntriesNum entries, the offsets are set by the caller
+    void initMemory(size_t dbSize, size_t tableEntriesNum) {
+        this->tableEntriesNum = tableEntriesNum;
+        this->size = dbSize;
+
+        entries = new(std::nothrow) IndexEntryLocal[tableEntriesNum];
+        Util::checkAllocation(entries, "Could not allocate entries memory in IndexTable::initMemory");
+    }
+
     // allocates memory for index tables
     void init() {
         // set the pointers in the index table to the start of the list for a certain k-mer
@@ -332,11 +306,10 @@ public:
         }
     }
 
-    // add k-mers of the sequence to the index table
-    void addSequence (Sequence* s, Indexer * idxer,
-                      IndexEntryLocalTmp * buffer,
-                      int threshold, char * diagonalScore){
-        // iterate over all k-mers of the sequence and add the id of s to the sequence list of the k-mer (tableDummy)
+    // writes the k-mers of the sequence that are added to the index table to buffer, sorted by k-mer.
+    // Every k-mer is kept once with its first position. Returns the number of k-mers.
+    size_t getSequenceKmers(Sequence* s, Indexer * idxer, IndexEntryLocalTmp * buffer,
+                            int threshold, char * diagonalScore){
         s->resetCurrPos();
         idxer->reset();
         size_t kmerPos = 0;
@@ -363,12 +336,7 @@ public:
                     continue;
                 }
             }
-            unsigned int kmerIdx = idxer->int2index(kmer, 0, kmerSize);
-            // if region got masked do not add kmer
-            if (offsets[kmerIdx + 1] - offsets[kmerIdx] == 0)
-                continue;
-
-            buffer[kmerPos].kmer = kmerIdx;
+            buffer[kmerPos].kmer = idxer->int2index(kmer, 0, kmerSize);
             buffer[kmerPos].seqId      = s->getId();
             buffer[kmerPos].position_j = s->getCurrentPosition();
             kmerPos++;
@@ -378,17 +346,16 @@ public:
             std::sort(buffer, buffer+kmerPos, IndexEntryLocalTmp::comapreByIdAndPos);
         }
 
+        size_t uniqueKmers = 0;
         unsigned int prevKmer = UINT_MAX;
         for(size_t pos = 0; pos < kmerPos; pos++){
-            unsigned int kmerIdx = buffer[pos].kmer;
-            if(kmerIdx != prevKmer){
-                size_t offset = __sync_fetch_and_add(&(offsets[kmerIdx]), 1);
-                IndexEntryLocal *entry = &entries[offset];
-                entry->seqId      = buffer[pos].seqId;
-                entry->position_j = buffer[pos].position_j;
+            if(buffer[pos].kmer != prevKmer){
+                buffer[uniqueKmers] = buffer[pos];
+                uniqueKmers++;
             }
-            prevKmer = kmerIdx;
+            prevKmer = buffer[pos].kmer;
         }
+        return uniqueKmers;
     }
 
     // prints the IndexTable
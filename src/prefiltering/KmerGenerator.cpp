@@ -2,18 +2,28 @@
 #include <algorithm>    // std::reverse
 #include <MathUtil.h>
 #include "simd.h"
+#include "Util.h"
+#include <cstring>
+#include <new>
 
 
 KmerGenerator::KmerGenerator(size_t kmerSize, size_t alphabetSize, short threshold ){
     this->threshold = threshold;
     this->kmerSize = kmerSize;
     this->indexer = new Indexer((int) alphabetSize, (int)kmerSize);
+    this->cache = NULL;
+    this->cacheHits = 0;
+    this->cacheLookups = 0;
 //    calcDivideStrategy();
 }
 
 void KmerGenerator::setThreshold(short threshold){
 	this->threshold = threshold;
 } 
+
+void KmerGenerator::setCache(KmerListCache * cache){
+    this->cache = cache;
+}
 KmerGenerator::~KmerGenerator(){
     delete [] this->stepMultiplicator;
     delete [] this->highestScorePerArray;
@@ -108,6 +118,18 @@ void KmerGenerator::initDataStructure(size_t divide_steps){
 
 
 ScoreMatrix KmerGenerator::generateKmerList(const int * int_seq){
+    // the list is returned in the output arrays of the last step
+    const size_t last = divideStepCount - 2;
+    unsigned int exactKmer = 0;
+    if(cache != NULL){
+        exactKmer = indexer->int2index(int_seq, 0, kmerSize);
+        size_t size;
+        cacheLookups++;
+        if(cache->get(exactKmer, threshold, outputScoreArray[last], outputIndexArray[last], &size)){
+            cacheHits++;
+            return ScoreMatrix(outputScoreArray[last], outputIndexArray[last], size, MAX_KMER_RESULT_SIZE);
+        }
+    }
     int dividerBefore=0;
     // pre compute phase
     // find first threshold
@@ -179,6 +201,9 @@ ScoreMatrix KmerGenerator::generateKmerList(const int * int_seq){
 //
 //        return ScoreMatrix(outputScoreArray[0], outputIndexArray[0], 1, 0);
 //    }
+    if(cache != NULL){
+        cache->put(exactKmer, threshold, outputScoreArray[i-1], outputIndexArray[i-1], sizeInputMatrix);
+    }
     return ScoreMatrix(outputScoreArray[i-1], outputIndexArray[i-1], sizeInputMatrix, MAX_KMER_RESULT_SIZE);
 }
 
@@ -215,3 +240,105 @@ int KmerGenerator::calculateArrayProduct(const short        * __restrict scoreAr
     return counter;
 }
 
+
+KmerListCache::KmerListCache(size_t capacity, size_t maxListSize) : maxListSize(maxListSize) {
+    // power of two number of sets, so that the set index is a mask of the hash
+    setCount = 1;
+    while (setCount * WAYS < capacity) {
+        setCount *= 2;
+    }
+    sets = new Set[setCount];
+    for (size_t i = 0; i < setCount; i++) {
+        sets[i].version = 0;
+        sets[i].hand = 0;
+        for (size_t j = 0; j < WAYS; j++) {
+            sets[i].slots[j].key = EMPTY_KEY;
+            sets[i].slots[j].size = 0;
+            sets[i].slots[j].referenced = 0;
+        }
+    }
+    const size_t entries = setCount * WAYS * maxListSize;
+    scores = new(std::nothrow) short[entries];
+    Util::checkAllocation(scores, "Could not allocate scores memory in KmerListCache");
+    indices = new(std::nothrow) unsigned int[entries];
+    Util::checkAllocation(indices, "Could not allocate indices memory in KmerListCache");
+}
+
+KmerListCache::~KmerListCache() {
+    delete[] sets;
+    delete[] scores;
+    delete[] indices;
+}
+
+bool KmerListCache::get(unsigned int kmer, short threshold, short *score, unsigned int *index, size_t *size) {
+    const uint64_t key = makeKey(kmer, threshold);
+    const size_t setIdx = setIndex(key);
+    Set &set = sets[setIdx];
+    const unsigned int version = set.version;
+    if (version & 1) {
+        return false;
+    }
+    __sync_synchronize();
+    for (size_t i = 0; i < WAYS; i++) {
+        Slot &slot = set.slots[i];
+        if (slot.key != key) {
+            continue;
+        }
+        // a torn size is caught by the version check below but must not overrun the buffers
+        const size_t listSize = slot.size;
+        if (listSize > maxListSize) {
+            return false;
+        }
+        const size_t offset = (setIdx * WAYS + i) * maxListSize;
+        memcpy(score, scores + offset, listSize * sizeof(short));
+        memcpy(index, indices + offset, listSize * sizeof(unsigned int));
+        __sync_synchronize();
+        if (set.version != version) {
+            return false;
+        }
+        // only written once so that hot sets stay read-only
+        if (slot.referenced == 0) {
+            slot.referenced = 1;
+        }
+        *size = listSize;
+        return true;
+    }
+    return false;
+}
+
+void KmerListCache::put(unsigned int kmer, short threshold, const short *score, const unsigned int *index, size_t size) {
+    if (size > maxListSize) {
+        return;
+    }
+    const uint64_t key = makeKey(kmer, threshold);
+    const size_t setIdx = setIndex(key);
+    Set &set = sets[setIdx];
+    const unsigned int version = set.version;
+    if ((version & 1) || __sync_bool_compare_and_swap(&set.version, version, version + 1) == false) {
+        return;
+    }
+    bool cached = false;
+    for (size_t i = 0; i < WAYS; i++) {
+        cached |= (set.slots[i].key == key);
+    }
+    if (cached == false) {
+        // clock: skip and clear referenced slots until an unreferenced one is found
+        size_t victim;
+        while (true) {
+            victim = set.hand;
+            set.hand = (set.hand + 1) % WAYS;
+            if (set.slots[victim].referenced == 0) {
+                break;
+            }
+            set.slots[victim].referenced = 0;
+        }
+        const size_t offset = (setIdx * WAYS + victim) * maxListSize;
+        memcpy(scores + offset, score, size * sizeof(short));
+        memcpy(indices + offset, index, size * sizeof(unsigned int));
+        set.slots[victim].key = key;
+        set.slots[victim].size = static_cast<unsigned int>(size);
+        set.slots[victim].referenced = 0;
+    }
+    __sync_synchronize();
+    set.version = version + 2;
+}
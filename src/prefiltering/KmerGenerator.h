@@ -2,10 +2,12 @@
 #define KMERGENERATOR_H 
 #include <string>
 #include <vector>
+#include <stdint.h>
 #include "Indexer.h"
 #include "ScoreMatrix.h"
 #include "Debug.h"
 
+class KmerListCache;
 
 class KmerGenerator 
 {
@@ -24,6 +26,13 @@ class KmerGenerator
         void setDivideStrategy(ScoreMatrix ** one);
 
 	void setThreshold(short threshold);
+
+        /* looks up and stores lists in a cache shared by all threads, only valid
+         for generators with the same divide strategy and score matrices */
+        void setCache(KmerListCache * cache);
+
+        size_t getCacheHits() { return cacheHits; }
+        size_t getCacheLookups() { return cacheLookups; }
     private:
     
         /*creates the product between two arrays and write it to the output array */
@@ -60,10 +69,63 @@ class KmerGenerator
         short        ** outputScoreArray;
         unsigned int ** outputIndexArray;
 
+        KmerListCache * cache;
+        size_t cacheHits;
+        size_t cacheLookups;
+
 
         /* init the output vectors for the kmer calculation*/
         void initDataStructure(size_t divideSteps);
     
 };
+
+// Similar k-mer lists shared by the k-mer generators of all threads, keyed by the exact k-mer
+// and the threshold the list was generated with. The slots are grouped into sets of WAYS.
+// Each set is versioned like a seqlock: readers copy a list without taking a lock and treat it
+// as a miss if a writer changed the set meanwhile. Writers skip the insert if the set is locked
+// and replace slots with the clock policy, so frequent k-mers stay cached.
+class KmerListCache {
+public:
+    KmerListCache(size_t capacity, size_t maxListSize);
+    ~KmerListCache();
+
+    // copies the list into score and index, returns false if it is not cached
+    bool get(unsigned int kmer, short threshold, short *score, unsigned int *index, size_t *size);
+    // lists longer than maxListSize are not cached
+    void put(unsigned int kmer, short threshold, const short *score, const unsigned int *index, size_t size);
+
+private:
+    static const size_t WAYS = 4;
+    static const uint64_t EMPTY_KEY = UINT64_MAX;
+
+    struct Slot {
+        uint64_t key;
+        unsigned int size;
+        unsigned char referenced;
+    };
+
+    struct Set {
+        // odd while a writer changes the set
+        volatile unsigned int version;
+        unsigned int hand;
+        Slot slots[WAYS];
+    };
+
+    static uint64_t makeKey(unsigned int kmer, short threshold) {
+        return (static_cast<uint64_t>(kmer) << 16) | static_cast<unsigned short>(threshold);
+    }
+
+    size_t setIndex(uint64_t key) const {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & (setCount - 1);
+    }
+
+    size_t setCount;
+    size_t maxListSize;
+    Set *sets;
+    // list of slot i of set s starts at (s * WAYS + i) * maxListSize
+    short *scores;
+    unsigned int *indices;
+};
+
 #endif
 
@@ -0,0 +1,156 @@
+#include "NumaIndexTable.h"
+#include "Parameters.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <cstring>
+#include <new>
+
+const size_t NumaIndexTable::STRIPE_SIZE;
+
+template <typename T>
+static T *allocateArray(size_t size) {
+    // the pages are only allocated when they are written
+    T *array = new(std::nothrow) T[size];
+    Util::checkAllocation(array, "Could not allocate memory in NumaIndexTable");
+    return array;
+}
+
+NumaIndexTable::NumaIndexTable(int mode, IndexTable *indexTable, SequenceLookup *sequenceLookup, unsigned int threads)
+        : indexTable(indexTable), sequenceLookup(sequenceLookup), threads(threads), active(false), replicated(false) {
+    const size_t nodes = topology.nodeCount();
+    const size_t tableSize = indexTable->getTableSize();
+    const size_t entryCount = indexTable->getTableEntriesNum();
+    size_t size = entryCount * sizeof(IndexEntryLocal) + (tableSize + 1) * sizeof(size_t);
+    if (sequenceLookup != NULL) {
+        size += sequenceLookup->getDataSize() + 1 + (sequenceLookup->getSequenceCount() + 1) * sizeof(size_t);
+    }
+
+    if (mode == Parameters::NUMA_MODE_OFF || nodes < 2 || threads < nodes) {
+        if (mode != Parameters::NUMA_MODE_OFF) {
+            Debug(Debug::INFO) << "NUMA mode: " << nodes << " node(s) for " << threads << " thread(s), placement disabled.\n";
+        }
+        return;
+    }
+
+    active = true;
+    replicated = (mode == Parameters::NUMA_MODE_REPLICATE);
+    // the original stays resident and becomes the copy of the first node, the free memory
+    // reported for that node already excludes it, so only the other nodes need room for a copy
+    for (size_t node = 0; replicated && node < nodes; node++) {
+        // keep a tenth of the free memory for the matchers of the node
+        const size_t required = (node == 0) ? size / 10 : size + size / 10;
+        if (topology.getFreeMemory(node) < required) {
+            replicated = false;
+        }
+    }
+    Debug(Debug::INFO) << "NUMA mode: " << (replicated ? "copying" : "interleaving") << " the index table ("
+                       << size << " bytes) " << (replicated ? "to each of " : "over ") << nodes << " nodes.\n";
+
+    // move the pages of the original instead of copying it
+    bool moved = placeArray((const char *) indexTable->getEntries(), entryCount * sizeof(IndexEntryLocal));
+    moved &= placeArray((const char *) indexTable->getOffsets(), (tableSize + 1) * sizeof(size_t));
+    if (sequenceLookup != NULL) {
+        moved &= placeArray(sequenceLookup->getData(), sequenceLookup->getDataSize() + 1);
+        moved &= placeArray((const char *) sequenceLookup->getOffsets(), (sequenceLookup->getSequenceCount() + 1) * sizeof(size_t));
+    }
+    if (moved == false) {
+        Debug(Debug::WARNING) << "Could not move the index table pages, they stay where they are\n";
+    }
+    if (replicated == false) {
+        return;
+    }
+
+    // the replicas are bound to their node before they are written, so the pages end up there
+    // no matter which thread copies them
+    std::vector<Stripe> stripes;
+    bool bound = true;
+    for (size_t node = 1; node < nodes; node++) {
+        Copy copy;
+        memset(&copy, 0, sizeof(Copy));
+        copy.entries = allocateArray<IndexEntryLocal>(entryCount);
+        copy.offsets = allocateArray<size_t>(tableSize + 1);
+        bound &= addStripes(stripes, (const char *) indexTable->getEntries(), (char *) copy.entries,
+                            entryCount * sizeof(IndexEntryLocal), node);
+        bound &= addStripes(stripes, (const char *) indexTable->getOffsets(), (char *) copy.offsets,
+                            (tableSize + 1) * sizeof(size_t), node);
+        if (sequenceLookup != NULL) {
+            copy.lookupData = allocateArray<char>(sequenceLookup->getDataSize() + 1);
+            copy.lookupOffsets = allocateArray<size_t>(sequenceLookup->getSequenceCount() + 1);
+            bound &= addStripes(stripes, sequenceLookup->getData(), copy.lookupData,
+                                sequenceLookup->getDataSize() + 1, node);
+            bound &= addStripes(stripes, (const char *) sequenceLookup->getOffsets(), (char *) copy.lookupOffsets,
+                                (sequenceLookup->getSequenceCount() + 1) * sizeof(size_t), node);
+        }
+        copies.push_back(copy);
+    }
+    if (bound == false) {
+        Debug(Debug::WARNING) << "Could not bind the index table copies to their NUMA nodes\n";
+    }
+
+    // every stripe is copied whatever the size of the team OpenMP starts
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+    for (size_t i = 0; i < stripes.size(); i++) {
+        memcpy(stripes[i].target, stripes[i].source, stripes[i].length);
+    }
+
+    for (size_t i = 0; i < copies.size(); i++) {
+        Copy &copy = copies[i];
+        copy.indexTable = new IndexTable(indexTable->getAlphabetSize(), indexTable->getKmerSize(), true);
+        copy.indexTable->initTableByExternalData(indexTable->getSize(), entryCount, copy.entries, copy.offsets);
+        copy.sequenceLookup = NULL;
+        if (sequenceLookup != NULL) {
+            copy.sequenceLookup = new SequenceLookup(sequenceLookup->getSequenceCount());
+            copy.sequenceLookup->initLookupByExternalData(copy.lookupData, sequenceLookup->getDataSize(), copy.lookupOffsets);
+        }
+    }
+}
+
+NumaIndexTable::~NumaIndexTable() {
+    for (size_t i = 0; i < copies.size(); i++) {
+        delete copies[i].indexTable;
+        delete copies[i].sequenceLookup;
+        delete[] copies[i].entries;
+        delete[] copies[i].offsets;
+        delete[] copies[i].lookupData;
+        delete[] copies[i].lookupOffsets;
+    }
+}
+
+size_t NumaIndexTable::pinThread(unsigned int thread) {
+    if (active == false) {
+        return 0;
+    }
+    const size_t node = topology.nodeOfThread(thread, threads);
+    if (topology.pinThread(node) == false) {
+        Debug(Debug::WARNING) << "Could not pin thread " << thread << " to NUMA node " << node << "\n";
+    }
+    return node;
+}
+
+void NumaIndexTable::unpinThread() {
+    if (active == false) {
+        return;
+    }
+    if (topology.unpinThread() == false) {
+        Debug(Debug::WARNING) << "Could not reset the CPU affinity of the thread\n";
+    }
+}
+
+bool NumaIndexTable::placeArray(const char *data, size_t size) {
+    if (replicated) {
+        return topology.bindMemory(data, size, 0);
+    }
+    return topology.interleaveMemory(data, size);
+}
+
+bool NumaIndexTable::addStripes(std::vector<Stripe> &stripes, const char *source, char *target, size_t size, size_t node) {
+    for (size_t from = 0; from < size; from += STRIPE_SIZE) {
+        Stripe stripe;
+        stripe.source = source + from;
+        stripe.target = target + from;
+        stripe.length = std::min(STRIPE_SIZE, size - from);
+        stripes.push_back(stripe);
+    }
+    return topology.bindMemory(target, size, node);
+}
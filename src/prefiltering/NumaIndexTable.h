@@ -0,0 +1,72 @@
+#ifndef MMSEQS_NUMAINDEXTABLE_H
+#define MMSEQS_NUMAINDEXTABLE_H
+
+// Places the index table and the sequence lookup of the prefilter on the NUMA nodes.
+// In replicate mode the original is moved to the first node and every other node gets its own copy,
+// the matchers use the copy of the node their thread is pinned to. In interleave mode the pages of the
+// original are spread over all nodes, nothing is copied.
+// The copies are bound to their node before they are written.
+
+#include <cstddef>
+#include <vector>
+
+#include "NumaTopology.h"
+#include "IndexTable.h"
+#include "SequenceLookup.h"
+
+class NumaIndexTable {
+public:
+    NumaIndexTable(int mode, IndexTable *indexTable, SequenceLookup *sequenceLookup, unsigned int threads);
+    ~NumaIndexTable();
+
+    // pins the calling thread to its node, returns the node
+    size_t pinThread(unsigned int thread);
+
+    // lets the calling thread run on all CPUs of the process again
+    void unpinThread();
+
+    IndexTable *getIndexTable(size_t node) {
+        return (replicated && node > 0) ? copies[node - 1].indexTable : indexTable;
+    }
+
+    SequenceLookup *getSequenceLookup(size_t node) {
+        return (replicated && node > 0) ? copies[node - 1].sequenceLookup : sequenceLookup;
+    }
+
+private:
+    struct Copy {
+        IndexEntryLocal *entries;
+        size_t *offsets;
+        char *lookupData;
+        size_t *lookupOffsets;
+        IndexTable *indexTable;
+        SequenceLookup *sequenceLookup;
+    };
+
+    // a stripe of a copy written by one thread
+    struct Stripe {
+        const char *source;
+        char *target;
+        size_t length;
+    };
+
+    // the copies are written in stripes of 2 MB, the size of a transparent huge page
+    static const size_t STRIPE_SIZE = 2 * 1024 * 1024;
+
+    NumaTopology topology;
+    // not owned, used by the first node
+    IndexTable *indexTable;
+    SequenceLookup *sequenceLookup;
+    unsigned int threads;
+    bool active;
+    bool replicated;
+    // copies of the other nodes
+    std::vector<Copy> copies;
+
+    // moves the pages of the original to the first node or interleaves them
+    bool placeArray(const char *data, size_t size);
+    // splits the copy of an array into stripes and binds the target to the node
+    bool addStripes(std::vector<Stripe> &stripes, const char *source, char *target, size_t size, size_t node);
+};
+
+#endif
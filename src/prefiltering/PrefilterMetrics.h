@@ -0,0 +1,84 @@
+#ifndef MMSEQS_PREFILTERMETRICS_H
+#define MMSEQS_PREFILTERMETRICS_H
+
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+
+// Time per stage and histograms of one prefilter thread, only collected if a metrics file is requested.
+// Every thread fills its own instance, they are merged after the split.
+struct PrefilterMetrics {
+    enum Stage {
+        KMER_GENERATION,    // composition bias and similar k-mer lists
+        INDEX_LOOKUP,       // copying the posting lists out of the index table
+        DIAGONAL_COUNTING,  // CacheFriendlyOperations, finding hits on the same diagonal
+        UNGAPPED_RESCORING, // UngappedAlignment of the diagonals
+        SORTING,            // selecting and sorting the best hits
+        WRITING,            // formatting and writing the result
+        STAGE_COUNT
+    };
+
+    // bin i counts values in [2^(i-1), 2^i), bin 0 counts zeros
+    static const size_t HISTOGRAM_BINS = 33;
+
+    double stageTime[STAGE_COUNT];
+    // sizes of the posting lists that were looked up
+    size_t listLengths[HISTOGRAM_BINS];
+    // hits found per query before the --max-seqs limit
+    size_t hitsPerQuery[HISTOGRAM_BINS];
+    size_t queries;
+    // time in the query loop and time waiting for the other threads at its end
+    double busyTime;
+    double idleTime;
+
+    PrefilterMetrics() {
+        reset();
+    }
+
+    void reset() {
+        memset(stageTime, 0, sizeof(stageTime));
+        memset(listLengths, 0, sizeof(listLengths));
+        memset(hitsPerQuery, 0, sizeof(hitsPerQuery));
+        queries = 0;
+        busyTime = 0.0;
+        idleTime = 0.0;
+    }
+
+    void merge(const PrefilterMetrics &other) {
+        for (size_t i = 0; i < STAGE_COUNT; i++) {
+            stageTime[i] += other.stageTime[i];
+        }
+        for (size_t i = 0; i < HISTOGRAM_BINS; i++) {
+            listLengths[i] += other.listLengths[i];
+            hitsPerQuery[i] += other.hitsPerQuery[i];
+        }
+        queries += other.queries;
+        busyTime += other.busyTime;
+        idleTime += other.idleTime;
+    }
+
+    static size_t histogramBin(size_t value) {
+        size_t bin = 0;
+        while (value != 0 && bin < HISTOGRAM_BINS - 1) {
+            bin++;
+            value >>= 1;
+        }
+        return bin;
+    }
+
+    // monotonic seconds, cheaper than the gettimeofday of Timer and unaffected by clock changes
+    static double now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + 1e-9 * ts.tv_nsec;
+    }
+
+    static const char *stageName(size_t stage) {
+        static const char *names[STAGE_COUNT] = {
+                "kmerGeneration", "indexLookup", "diagonalCounting", "ungappedRescoring", "sorting", "writing"
+        };
+        return names[stage];
+    }
+};
+
+#endif
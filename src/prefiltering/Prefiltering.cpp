@@ -6,7 +6,10 @@
 #include "PatternCompiler.h"
 #include "FileUtil.h"
 #include "IndexBuilder.h"
+#include "NumaIndexTable.h"
 #include "Timer.h"
+#include "Checkpoint.h"
+#include "PrefilterMetrics.h"
 
 namespace prefilter {
 #include "ExpOpt3_8_polished.cs32.lib.h"
@@ -16,6 +19,8 @@ namespace prefilter {
 #include <omp.h>
 #endif
 
+const size_t Prefiltering::PLANNER_QUERY_SAMPLE;
+
 Prefiltering::Prefiltering(const std::string &targetDB,
                            const std::string &targetDBIndex,
                            int querySeqType, int targetSeqType_,
@@ -43,7 +48,13 @@ Prefiltering::Prefiltering(const std::string &targetDB,
         aaBiasCorrection(par.compBiasCorrection != 0),
         covThr(par.covThr), covMode(par.covMode), includeIdentical(par.includeIdentity),
         noPreload(par.noPreload),
-        threads(static_cast<unsigned int>(par.threads)) {
+        threads(static_cast<unsigned int>(par.threads)),
+        queryBatchSize(static_cast<size_t>(par.queryBatchSize)),
+        kmerCacheSize(static_cast<size_t>(par.kmerCacheSize)),
+        numaMode(par.numaMode),
+        mpiChunks(par.mpiChunks),
+        checkpointChunks(par.checkpointChunks),
+        metricsFile(par.metricsFile) {
 #ifdef OPENMP
     Debug(Debug::INFO) << "Using " << threads << " threads.\n";
 #endif
@@ -145,6 +156,23 @@ Prefiltering::Prefiltering(const std::string &targetDB,
     if(targetSeqType != Sequence::NUCLEOTIDES){
         kmerThr = getKmerThreshold(sensitivity, querySeqType, kmerScore, kmerSize);
     }
+    // replace the estimated split setting by one measured on a sample of the queries
+    if (templateDBIsIndex == false && (originalSplits == Parameters::AUTO_SPLIT_DETECTION || par.splitMode == Parameters::DETECT_BEST_DB_SPLIT)) {
+        std::string checkpointDB = par.db3;
+#ifdef HAVE_MPI
+        checkpointDB = Util::createTmpFileNames(par.db3, par.db3Index, MMseqsMPI::rank).first;
+#endif
+        // a restarted run has to continue with the split of its checkpoint, the timings could give another one
+        if (restoreCheckpointSplit(par.db1, par.db1Index, checkpointDB) == false) {
+            planSplit(par.db1, par.db1Index, memoryLimit,
+                      originalSplits == Parameters::AUTO_SPLIT_DETECTION, par.splitMode == Parameters::DETECT_BEST_DB_SPLIT);
+        }
+#ifdef HAVE_MPI
+        // the measured timings differ between the ranks, all of them have to split the same way
+        MPI_Bcast(&splits, 1, MPI_INT, MMseqsMPI::MASTER, MPI_COMM_WORLD);
+        MPI_Bcast(&splitMode, 1, MPI_INT, MMseqsMPI::MASTER, MPI_COMM_WORLD);
+#endif
+    }
     if (templateDBIsIndex == true) {
         if (splits != originalSplits) {
             Debug(Debug::WARNING) << "Required split count does not match index table split count. Recomputing index table!\n";
@@ -163,6 +191,16 @@ Prefiltering::Prefiltering(const std::string &targetDB,
         }
     }
 
+    // checkpoints are taken per split, a target that fits in one split is searched in query chunks instead
+    if (checkpointChunks > 0) {
+        if (splitMode == Parameters::TARGET_DB_SPLIT && splits == 1) {
+            splitMode = Parameters::QUERY_DB_SPLIT;
+        }
+        if (splitMode == Parameters::QUERY_DB_SPLIT) {
+            splits = std::max(checkpointChunks, splits);
+        }
+    }
+
     Debug(Debug::INFO) << "Target database: " << targetDB << "(Size: " << tdbr->getSize() << ")\n";
 
     if (splitMode == Parameters::QUERY_DB_SPLIT) {
@@ -236,7 +274,7 @@ void Prefiltering::setupSplit(DBReader<unsigned int>& dbr, const int alphabetSiz
                                                   dbr.getSize(), dbr.getAminoAcidDBSize(),  maxResListLen, alphabetSize,
                                                   *kmerSize == 0 ? // if auto detect kmerSize
                                                   IndexTable::computeKmerSize(dbr.getAminoAcidDBSize()) : *kmerSize, querySeqTyp,
-                                                  threads);
+                                                  threads, ESTIMATED_RESIDUE_BYTES);
     if (neededSize > 0.9 * memoryLimit) {
         // memory is not enough to compute everything at once
         //TODO add PROFILE_STATE (just 6-mers)
@@ -287,7 +325,8 @@ void Prefiltering::setupSplit(DBReader<unsigned int>& dbr, const int alphabetSiz
     Debug(Debug::INFO) << "Use kmer size " << *kmerSize << " and split "
                        << *split << " using " << Parameters::getSplitModeName(*splitMode) << " split mode.\n";
     neededSize = estimateMemoryConsumption((*splitMode == Parameters::TARGET_DB_SPLIT) ? *split : 1, dbr.getSize(),
-                                           dbr.getAminoAcidDBSize(), maxResListLen, alphabetSize, *kmerSize, querySeqTyp, threads);
+                                           dbr.getAminoAcidDBSize(), maxResListLen, alphabetSize, *kmerSize, querySeqTyp, threads,
+                                           ESTIMATED_RESIDUE_BYTES);
     Debug(Debug::INFO) << "Needed memory (" << neededSize << " byte) of total memory (" << memoryLimit
                        << " byte)\n";
     if (neededSize > 0.9 * memoryLimit) {
@@ -299,6 +338,224 @@ void Prefiltering::setupSplit(DBReader<unsigned int>& dbr, const int alphabetSiz
     }
 }
 
+Prefiltering::SampleTiming Prefiltering::measureSample(DBReader<unsigned int> *qdbr, const std::vector<size_t> &querySample,
+                                                       size_t dbFrom, size_t dbSize, ScoreMatrix *two, ScoreMatrix *three) {
+    SampleTiming timing;
+    timing.residues = 0;
+    unsigned int *seqLens = tdbr->getSeqLens();
+    for (size_t i = dbFrom; i < dbFrom + dbSize; i++) {
+        timing.residues += seqLens[i];
+    }
+
+    Timer timer;
+    SequenceLookup *lookup;
+    IndexTable *table = buildIndexTable(dbFrom, dbSize, getIndexKmerThr(), &lookup);
+    timing.buildTime = timer.elapsed();
+    timing.indexBytes = table->getTableEntriesNum() * table->getSizeOfEntry();
+    if (diagonalScoring == true && lookup != NULL) {
+        timing.indexBytes += lookup->getDataSize();
+    } else if (lookup != NULL) {
+        delete lookup;
+        lookup = NULL;
+    }
+
+    EvalueComputation evaluer(tdbr->getAminoAcidDBSize(), subMat, 0, 0, false);
+    const bool isProfileQuery = (querySeqType == Sequence::HMM_PROFILE || querySeqType == Sequence::PROFILE_STATE_PROFILE);
+    timer.reset();
+#pragma omp parallel
+    {
+        Sequence seq(maxSeqLen, querySeqType, subMat, kmerSize, spacedKmer, aaBiasCorrection);
+        QueryMatcher matcher(table, lookup, subMat, evaluer, seqLens + dbFrom, kmerThr, 1.0,
+                             kmerSize, dbSize, maxSeqLen, seq.getEffectiveKmerSize(),
+                             maxResListLen, aaBiasCorrection, diagonalScoring, minDiagScoreThr, takeOnlyBestKmer);
+        if (isProfileQuery) {
+            matcher.setProfileMatrix(seq.profile_matrix);
+        } else {
+            matcher.setSubstitutionMatrix(three, two);
+        }
+
+#pragma omp for schedule(dynamic, 10)
+        for (size_t i = 0; i < querySample.size(); i++) {
+            const size_t id = querySample[i];
+            seq.mapSequence(id, qdbr->getDbKey(id), qdbr->getData(id));
+            matcher.matchQuery(&seq, UINT_MAX);
+        }
+    }
+    timing.queryTime = timer.elapsed() / querySample.size();
+
+    delete table;
+    if (lookup != NULL) {
+        delete lookup;
+    }
+    return timing;
+}
+
+void Prefiltering::planSplit(const std::string &queryDB, const std::string &queryDBIndex, const size_t memoryLimit,
+                             const bool autoSplit, const bool autoSplitMode) {
+    int processes = 1;
+#ifdef HAVE_MPI
+    processes = MMseqsMPI::numProc;
+#endif
+    // one process with an index that fits into memory has nothing to plan
+    if (processes == 1 && splits == 1) {
+        return;
+    }
+
+    DBReader<unsigned int> qdbr(queryDB.c_str(), queryDBIndex.c_str());
+    qdbr.open(DBReader<unsigned int>::NOSORT);
+    const size_t queryCount = qdbr.getSize();
+    if (queryCount == 0 || tdbr->getSize() == 0) {
+        qdbr.close();
+        return;
+    }
+
+    // same random query sample as in setKmerThreshold
+    std::vector<size_t> querySample(std::min(queryCount, PLANNER_QUERY_SAMPLE));
+    srand(1);
+    for (size_t i = 0; i < querySample.size(); i++) {
+        querySample[i] = rand() % queryCount;
+    }
+
+    ScoreMatrix *two = NULL;
+    ScoreMatrix *three = NULL;
+    if (querySeqType == Sequence::AMINO_ACIDS) {
+        subMat->alphabetSize = subMat->alphabetSize - 1;
+        two = getScoreMatrix(*subMat, 2);
+        three = getScoreMatrix(*subMat, 3);
+        subMat->alphabetSize = alphabetSize;
+    }
+
+    // match the sample against a block of target sequences from the middle of the database and against its first sequence,
+    // the difference separates the cost that grows with the target from the fixed cost of k-mer generation
+    const size_t totalResidues = tdbr->getAminoAcidDBSize();
+    const size_t sampleBlocks = std::max(totalResidues / PLANNER_SAMPLE_RESIDUES, static_cast<size_t>(1));
+    size_t sampleFrom = 0;
+    size_t sampleSize = 0;
+    Util::decomposeDomainByAminoAcid(totalResidues, tdbr->getSeqLens(), tdbr->getSize(),
+                                     sampleBlocks / 2, sampleBlocks, &sampleFrom, &sampleSize);
+    Debug(Debug::INFO) << "Split planner: match " << querySample.size() << " queries against "
+                       << sampleSize << " target sequences\n";
+    Timer timer;
+    const SampleTiming full = measureSample(&qdbr, querySample, sampleFrom, sampleSize, two, three);
+    const SampleTiming first = measureSample(&qdbr, querySample, sampleFrom, 1, two, three);
+    tdbr->remapData();
+    qdbr.close();
+    if (two != NULL) {
+        ScoreMatrix::cleanup(two);
+    }
+    if (three != NULL) {
+        ScoreMatrix::cleanup(three);
+    }
+
+    double querySlope = 0.0;
+    double buildSlope = 0.0;
+    if (full.residues > first.residues) {
+        const double residueDiff = static_cast<double>(full.residues - first.residues);
+        querySlope = std::max(0.0, (full.queryTime - first.queryTime) / residueDiff);
+        buildSlope = std::max(0.0, (full.buildTime - first.buildTime) / residueDiff);
+    }
+    const double sampleResidues = static_cast<double>(std::max(full.residues, static_cast<size_t>(1)));
+    const double queryFixed = std::max(0.0, full.queryTime - querySlope * sampleResidues);
+    const double buildFixed = std::max(0.0, full.buildTime - buildSlope * sampleResidues);
+    const double residueBytes = full.indexBytes / sampleResidues;
+    const double residues = static_cast<double>(totalResidues);
+    Debug(Debug::INFO) << "Split planner: " << queryFixed * 1e3 << " ms k-mer generation and "
+                       << querySlope * residues * 1e3 << " ms matching per query, "
+                       << residueBytes << " byte index per residue (" << timer.lap() << ")\n";
+
+    // predict the wall time of every split setting, a process runs ceil(split / processes) splits
+    const int modes[2] = { Parameters::TARGET_DB_SPLIT, Parameters::QUERY_DB_SPLIT };
+    int bestMode = -1;
+    int bestSplit = -1;
+    double bestTime = 0.0;
+    for (size_t m = 0; m < 2; m++) {
+        const int mode = modes[m];
+        if (autoSplitMode == false && mode != splitMode) {
+            continue;
+        }
+        int splitFrom = autoSplit ? 1 : splits;
+        int splitTo = autoSplit ? ((mode == Parameters::TARGET_DB_SPLIT) ? PLANNER_MAX_SPLIT : 1) : splits;
+        int modeSplit = -1;
+        double modeTime = 0.0;
+        size_t modeMemory = 0;
+        for (int split = splitFrom; split <= splitTo; split++) {
+            const int splitCount = std::max(split, processes);
+            const double processSplits = static_cast<double>((splitCount + processes - 1) / processes);
+            double time;
+            size_t memory;
+            if (mode == Parameters::TARGET_DB_SPLIT) {
+                time = processSplits * (queryCount * (queryFixed + querySlope * residues / splitCount)
+                                        + buildFixed + buildSlope * residues / splitCount);
+                memory = estimateMemoryConsumption(splitCount, tdbr->getSize(), totalResidues, maxResListLen,
+                                                   alphabetSize - 1, kmerSize, querySeqType, threads, residueBytes);
+            } else {
+                time = processSplits * (static_cast<double>(queryCount) / splitCount) * (queryFixed + querySlope * residues)
+                       + buildFixed + buildSlope * residues;
+                memory = estimateMemoryConsumption(1, tdbr->getSize(), totalResidues, maxResListLen,
+                                                   alphabetSize - 1, kmerSize, querySeqType, threads, residueBytes);
+            }
+            if (memory > 0.9 * memoryLimit) {
+                continue;
+            }
+            if (modeSplit == -1 || time < modeTime) {
+                modeSplit = split;
+                modeTime = time;
+                modeMemory = memory;
+            }
+        }
+        if (modeSplit == -1) {
+            Debug(Debug::INFO) << "Split planner: " << Parameters::getSplitModeName(mode) << " split does not fit into "
+                               << memoryLimit << " byte\n";
+            continue;
+        }
+        Debug(Debug::INFO) << "Split planner: " << Parameters::getSplitModeName(mode) << " split " << modeSplit
+                           << " predicts " << modeTime << " s and " << modeMemory << " byte\n";
+        if (bestSplit == -1 || modeTime < bestTime) {
+            bestMode = mode;
+            bestSplit = modeSplit;
+            bestTime = modeTime;
+        }
+    }
+
+    if (bestSplit == -1) {
+        Debug(Debug::WARNING) << "Split planner: no split setting fits into memory, keep split " << splits << "\n";
+        return;
+    }
+    splits = bestSplit;
+    splitMode = bestMode;
+    Debug(Debug::INFO) << "Split planner: use split " << splits << " using "
+                       << Parameters::getSplitModeName(splitMode) << " split mode.\n";
+}
+
+bool Prefiltering::restoreCheckpointSplit(const std::string &queryDB, const std::string &queryDBIndex, const std::string &resultDB) {
+    if (checkpointChunks == 0) {
+        return false;
+    }
+    // "prefilter <split mode> <split count> <from split> <split process count> <query size> <target size>
+    //  <k-mer size> <k-mer threshold> <max seqs>", see runSplits
+    std::vector<std::string> settings = Util::split(Checkpoint::readSettings(resultDB), " ");
+    if (settings.size() != 10 || settings[0] != "prefilter") {
+        return false;
+    }
+    size_t querySize = tdbr->getSize();
+    if (isSameQTDB(queryDB) == false) {
+        DBReader<unsigned int> qdbr(queryDB.c_str(), queryDBIndex.c_str());
+        qdbr.open(DBReader<unsigned int>::NOSORT);
+        querySize = qdbr.getSize();
+        qdbr.close();
+    }
+    // the checkpoint is discarded by runSplits anyway if it was written for something else
+    if (settings[5] != SSTR(querySize) || settings[6] != SSTR(tdbr->getSize())
+        || settings[7] != SSTR(kmerSize) || settings[8] != SSTR(kmerThr) || settings[9] != SSTR(maxResListLen)) {
+        return false;
+    }
+    splitMode = Util::fast_atoi<int>(settings[1].c_str());
+    splits = Util::fast_atoi<int>(settings[2].c_str());
+    Debug(Debug::INFO) << "Split planner: use split " << splits << " using "
+                       << Parameters::getSplitModeName(splitMode) << " split mode of the checkpoint.\n";
+    return true;
+}
+
 void Prefiltering::mergeOutput(const std::string &outDB, const std::string &outDBIndex,
                                const std::vector<std::pair<std::string, std::string>> &filenames) {
     Timer timer;
@@ -420,21 +677,9 @@ void Prefiltering::getIndexTable(int /*split*/, size_t dbFrom, size_t dbSize) {
     } else {
         Timer timer;
 
-        Sequence tseq(maxSeqLen, targetSeqType, subMat, kmerSize, spacedKmer, aaBiasCorrection);
-        int localKmerThr = (querySeqType == Sequence::HMM_PROFILE ||
-                            querySeqType == Sequence::PROFILE_STATE_PROFILE ||
-                            querySeqType == Sequence::NUCLEOTIDES ||
-                            (targetSeqType != Sequence::HMM_PROFILE && takeOnlyBestKmer == true) ) ? 0 : kmerThr;
-
-        // remove X or N for seeding
-        int adjustAlphabetSize = (targetSeqType == Sequence::NUCLEOTIDES || targetSeqType == Sequence::AMINO_ACIDS)
-                           ? alphabetSize -1 : alphabetSize;
-        indexTable = new IndexTable(adjustAlphabetSize, kmerSize, false);
-        SequenceLookup **maskedLookup   = maskMode == 1 ? &sequenceLookup : NULL;
-        SequenceLookup **unmaskedLookup = maskMode == 0 ? &sequenceLookup : NULL;
-
-        Debug(Debug::INFO) << "Index table k-mer threshold: " << localKmerThr << "\n";
-        IndexBuilder::fillDatabase(indexTable, maskedLookup, unmaskedLookup, *subMat,  &tseq, tdbr, dbFrom, dbFrom + dbSize, localKmerThr);
+        const int indexKmerThr = getIndexKmerThr();
+        Debug(Debug::INFO) << "Index table k-mer threshold: " << indexKmerThr << "\n";
+        indexTable = buildIndexTable(dbFrom, dbSize, indexKmerThr, &sequenceLookup);
 
         if (diagonalScoring == false) {
             delete sequenceLookup;
@@ -472,6 +717,27 @@ void Prefiltering::getIndexTable(int /*split*/, size_t dbFrom, size_t dbSize) {
     }
 }
 
+int Prefiltering::getIndexKmerThr() {
+    if (querySeqType == Sequence::HMM_PROFILE || querySeqType == Sequence::PROFILE_STATE_PROFILE ||
+        querySeqType == Sequence::NUCLEOTIDES || (targetSeqType != Sequence::HMM_PROFILE && takeOnlyBestKmer == true)) {
+        return 0;
+    }
+    return kmerThr;
+}
+
+IndexTable *Prefiltering::buildIndexTable(size_t dbFrom, size_t dbSize, int indexKmerThr, SequenceLookup **lookup) {
+    Sequence tseq(maxSeqLen, targetSeqType, subMat, kmerSize, spacedKmer, aaBiasCorrection);
+    // remove X or N for seeding
+    int adjustAlphabetSize = (targetSeqType == Sequence::NUCLEOTIDES || targetSeqType == Sequence::AMINO_ACIDS)
+                             ? alphabetSize -1 : alphabetSize;
+    IndexTable *table = new IndexTable(adjustAlphabetSize, kmerSize, false);
+    *lookup = NULL;
+    SequenceLookup **maskedLookup   = maskMode == 1 ? lookup : NULL;
+    SequenceLookup **unmaskedLookup = maskMode == 0 ? lookup : NULL;
+    IndexBuilder::fillDatabase(table, maskedLookup, unmaskedLookup, *subMat, &tseq, tdbr, dbFrom, dbFrom + dbSize, indexKmerThr);
+    return table;
+}
+
 bool Prefiltering::isSameQTDB(const std::string &queryDB) {
     //  check if when qdb and tdb have the same name an index extension exists
     std::string check(targetDB);
@@ -496,24 +762,34 @@ void Prefiltering::runMpiSplits(const std::string &queryDB, const std::string &q
                                 const std::string &resultDB, const std::string &resultDBIndex) {
 
     splits = std::max(MMseqsMPI::numProc, splits);
-    size_t fromSplit = 0;
-    size_t splitCount = 1;
-    // if split size is great than nodes than we have to
-    // distribute all splits equally over all nodes
-    unsigned int * splitCntPerProc = new unsigned int[MMseqsMPI::numProc];
-    memset(splitCntPerProc, 0, sizeof(unsigned int) * MMseqsMPI::numProc);
-    for(int i = 0; i < splits; i++){
-        splitCntPerProc[i % MMseqsMPI::numProc] += 1;
-    }
-    for(int i = 0; i < MMseqsMPI::rank; i++){
-        fromSplit += splitCntPerProc[i];
-    }
+    std::pair<std::string, std::string> result = Util::createTmpFileNames(resultDB, resultDBIndex, MMseqsMPI::rank);
+    int hasResult = 0;
+    if (mpiChunks > 0) {
+        // ranks request the next split when they are done, more query splits than ranks let the faster ranks
+        // take over work from the slower ones. Every target split needs its own index table, so their number stays.
+        if (splitMode == Parameters::QUERY_DB_SPLIT) {
+            splits = std::max(mpiChunks, splits);
+        }
+        hasResult = runSplits(queryDB, queryDBIndex, result.first, result.second, 0, splits, true) == true ? 1 : 0;
+    } else {
+        size_t fromSplit = 0;
+        size_t splitCount = 1;
+        // if split size is great than nodes than we have to
+        // distribute all splits equally over all nodes
+        unsigned int * splitCntPerProc = new unsigned int[MMseqsMPI::numProc];
+        memset(splitCntPerProc, 0, sizeof(unsigned int) * MMseqsMPI::numProc);
+        for(int i = 0; i < splits; i++){
+            splitCntPerProc[i % MMseqsMPI::numProc] += 1;
+        }
+        for(int i = 0; i < MMseqsMPI::rank; i++){
+            fromSplit += splitCntPerProc[i];
+        }
 
-    splitCount = splitCntPerProc[MMseqsMPI::rank];
-    delete[] splitCntPerProc;
+        splitCount = splitCntPerProc[MMseqsMPI::rank];
+        delete[] splitCntPerProc;
 
-    std::pair<std::string, std::string> result = Util::createTmpFileNames(resultDB, resultDBIndex, MMseqsMPI::rank);
-    int hasResult = runSplits(queryDB, queryDBIndex, result.first, result.second, fromSplit, splitCount) == true ? 1 : 0;
+        hasResult = runSplits(queryDB, queryDBIndex, result.first, result.second, fromSplit, splitCount) == true ? 1 : 0;
+    }
 
     int *results = NULL;
     if (MMseqsMPI::isMaster()) {
@@ -548,7 +824,7 @@ void Prefiltering::runMpiSplits(const std::string &queryDB, const std::string &q
 
 bool Prefiltering::runSplits(const std::string &queryDB, const std::string &queryDBIndex,
                              const std::string &resultDB, const std::string &resultDBIndex,
-                             size_t fromSplit, size_t splitProcessCount) {
+                             size_t fromSplit, size_t splitProcessCount, bool requestSplits) {
     bool sameQTDB = isSameQTDB(queryDB);
     DBReader<unsigned int> *qdbr;
     if (templateDBIsIndex == false && sameQTDB == true) {
@@ -576,20 +852,60 @@ bool Prefiltering::runSplits(const std::string &queryDB, const std::string &quer
 
     bool hasResult = false;
     size_t totalSplits = std::min(dbSize, (size_t) splits);
-    if (splitProcessCount > 1) {
+    if (requestSplits) {
+        if (checkpointChunks > 0) {
+            Debug(Debug::WARNING) << "Checkpoints are not supported together with MPI chunks, the splits are not recorded.\n";
+        }
+        // every rank takes the next free split from the master until none are left
+        std::vector<std::pair<std::string, std::string> > splitFiles;
+        MPIWorkQueue queue(totalSplits);
+        size_t split;
+        while (queue.next(&split)) {
+            std::pair<std::string, std::string> filenamePair = Util::createTmpFileNames(resultDB, resultDBIndex, split);
+            if (runSplit(qdbr, filenamePair.first.c_str(), filenamePair.second.c_str(), split, totalSplits, sameQTDB)) {
+                splitFiles.push_back(filenamePair);
+            }
+        }
+        Debug(Debug::INFO) << "Processed " << splitFiles.size() << " of " << totalSplits << " splits\n";
+        if (splitFiles.size() > 0) {
+            mergeFiles(resultDB, resultDBIndex, splitFiles);
+            hasResult = true;
+        }
+    } else if (splitProcessCount > 1 || checkpointChunks > 0) {
+        // every finished split is recorded in the checkpoint, a restarted run computes only the missing ones
+        Checkpoint *checkpoint = NULL;
+        if (checkpointChunks > 0) {
+            std::string settings = "prefilter " + SSTR(splitMode) + " " + SSTR(totalSplits) + " "
+                                   + SSTR(fromSplit) + " " + SSTR(splitProcessCount) + " "
+                                   + SSTR(qdbr->getSize()) + " " + SSTR(tdbr->getSize()) + " "
+                                   + SSTR(kmerSize) + " " + SSTR(kmerThr) + " " + SSTR(maxResListLen);
+            checkpoint = new Checkpoint(resultDB, settings);
+        }
+
         // splits template database into x sequence steps
         std::vector<std::pair<std::string, std::string> > splitFiles;
         for (size_t i = fromSplit; i < (fromSplit + splitProcessCount) && i < totalSplits; i++) {
             std::pair<std::string, std::string> filenamePair = Util::createTmpFileNames(resultDB, resultDBIndex, i);
+            if (checkpoint != NULL && checkpoint->isDone(i, filenamePair)) {
+                Debug(Debug::INFO) << "Prefiltering step " << (i + 1) << " of " << totalSplits << " is already done\n";
+                splitFiles.push_back(filenamePair);
+                continue;
+            }
             if (runSplit(qdbr, filenamePair.first.c_str(), filenamePair.second.c_str(), i, totalSplits, sameQTDB)) {
                 splitFiles.push_back(filenamePair);
-
+                if (checkpoint != NULL) {
+                    checkpoint->commit(i, filenamePair);
+                }
             }
         }
         if (splitFiles.size() > 0) {
             mergeFiles(resultDB, resultDBIndex, splitFiles);
             hasResult = true;
         }
+        if (checkpoint != NULL) {
+            checkpoint->remove();
+            delete checkpoint;
+        }
     } else if (splitProcessCount == 1) {
         if (runSplit(qdbr, resultDB.c_str(), resultDBIndex.c_str(), fromSplit, totalSplits, sameQTDB)) {
             hasResult = true;
@@ -601,6 +917,10 @@ bool Prefiltering::runSplits(const std::string &queryDB, const std::string &quer
         delete qdbr;
     }
 
+    if (metricsFile.empty() == false) {
+        writeMetrics(totalSplits);
+    }
+
     return hasResult;
 }
 
@@ -614,8 +934,9 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
     size_t queryFrom = 0;
     size_t querySize = qdbr->getSize();
 
+    // only a target split sees part of the hits of a query
     size_t maxResults = maxResListLen;
-    if (splitCount > 1) {
+    if (splitCount > 1 && splitMode == Parameters::TARGET_DB_SPLIT) {
         size_t fourTimesStdDeviation = 4*sqrt(static_cast<double>(maxResListLen) / static_cast<double>(splitCount));
         maxResults = (maxResListLen / splitCount) + std::max(static_cast<size_t >(1), fourTimesStdDeviation);
     }
@@ -673,6 +994,8 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
     size_t resSize = 0;
     size_t realResSize = 0;
     size_t diagonalOverflow = 0;
+    size_t kmerCacheHits = 0;
+    size_t kmerCacheLookups = 0;
     size_t totalQueryDBSize = querySize;
 
 #ifdef OPENMP
@@ -693,14 +1016,10 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
     char *notEmpty = new char[querySize];
     memset(notEmpty, 0, querySize * sizeof(char)); // init notEmpty
 
+    // OpenMP may start fewer threads than requested, the lists of the missing ones stay empty
     std::list<int> **reslens = new std::list<int> *[localThreads];
-    #pragma omp parallel num_threads(localThreads)
-    {
-        int thread_idx = 0;
-#ifdef OPENMP
-        thread_idx = omp_get_thread_num();
-#endif
-        reslens[thread_idx] = new std::list<int>();
+    for (unsigned int i = 0; i < localThreads; i++) {
+        reslens[i] = new std::list<int>();
     }
 
     Debug(Debug::INFO) << "Starting prefiltering scores calculation (step " << (split + 1) << " of " << splitCount << ")\n";
@@ -708,59 +1027,144 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
     Debug(Debug::INFO) << "Target db start  " << (dbFrom + 1) << " to " << dbFrom + dbSize << "\n";
     EvalueComputation evaluer(tdbr->getAminoAcidDBSize(), subMat, 0, 0, false);
 
+    // profile queries generate their k-mer lists from the query profile, only sequences can share them
+    KmerListCache *kmerListCache = NULL;
+    const bool isProfileQuery = (querySeqType == Sequence::HMM_PROFILE || querySeqType == Sequence::PROFILE_STATE_PROFILE);
+    if (kmerCacheSize > 0 && isProfileQuery == false && takeOnlyBestKmer == false) {
+        kmerListCache = new KmerListCache(kmerCacheSize, KMER_CACHE_MAX_LIST_SIZE);
+    }
+
+    NumaIndexTable numaIndexTable(numaMode, indexTable, sequenceLookup, localThreads);
+
+    // every thread fills its own metrics, the end of its query loop tells how long it waited for the others
+    const bool collectMetrics = (metricsFile.empty() == false);
+    std::vector<PrefilterMetrics> threadMetrics(collectMetrics ? localThreads : 0);
+    std::vector<double> threadLoopEnd(collectMetrics ? localThreads : 0, 0.0);
+    unsigned int teamSize = 1;
+    const double splitStart = collectMetrics ? PrefilterMetrics::now() : 0.0;
+
 #pragma omp parallel num_threads(localThreads)
     {
         unsigned int thread_idx = 0;
 #ifdef OPENMP
         thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#pragma omp master
+        teamSize = static_cast<unsigned int>(omp_get_num_threads());
 #endif
+        // the thread allocates its matcher buffers after pinning, so they are local as well
+        const size_t node = numaIndexTable.pinThread(thread_idx);
         Sequence seq(maxSeqLen, querySeqType, subMat, kmerSize, spacedKmer, aaBiasCorrection);
 
-        QueryMatcher matcher(indexTable, sequenceLookup, subMat, evaluer, tdbr->getSeqLens() + dbFrom, kmerThr, kmerMatchProb,
+        QueryMatcher matcher(numaIndexTable.getIndexTable(node), numaIndexTable.getSequenceLookup(node), subMat, evaluer, tdbr->getSeqLens() + dbFrom, kmerThr, kmerMatchProb,
                              kmerSize, dbSize, maxSeqLen, seq.getEffectiveKmerSize(),
                              maxResults, aaBiasCorrection, diagonalScoring, minDiagScoreThr, takeOnlyBestKmer);
 
-        if (querySeqType == Sequence::HMM_PROFILE || querySeqType == Sequence::PROFILE_STATE_PROFILE) {
+        if (isProfileQuery) {
             matcher.setProfileMatrix(seq.profile_matrix);
         } else {
             matcher.setSubstitutionMatrix(_3merSubMatrix, _2merSubMatrix);
+            matcher.setKmerListCache(kmerListCache);
         }
 
-#pragma omp for schedule(dynamic, 10) reduction (+: kmersPerPos, resSize, dbMatches, doubleMatches, querySeqLenSum, diagonalOverflow)
-        for (size_t id = queryFrom; id < queryFrom + querySize; id++) {
-            Debug::printProgress(id);
-            // get query sequence
-            char *seqData = qdbr->getData(id);
-            unsigned int qKey = qdbr->getDbKey(id);
-            seq.mapSequence(id, qKey, seqData);
-            // only the corresponding split should include the id (hack for the hack)
-            size_t targetSeqId = UINT_MAX;
-            if (id >= dbFrom && id < (dbFrom + dbSize) && (sameQTDB || includeIdentical)) {
-                targetSeqId = tdbr->getId(seq.getDbKey());
-                if (targetSeqId != UINT_MAX) {
-                    targetSeqId = targetSeqId - dbFrom;
+        PrefilterMetrics *metrics = NULL;
+        if (collectMetrics) {
+            metrics = &threadMetrics[thread_idx];
+            matcher.setMetrics(metrics);
+        }
+        const double loopStart = (metrics != NULL) ? PrefilterMetrics::now() : 0.0;
+
+        // with a batch size of one every query is matched on its own as before
+        const size_t batchSize = std::max(queryBatchSize, static_cast<size_t>(1));
+        const size_t chunkSize = (batchSize > 1) ? 1 : 10;
+#pragma omp for schedule(dynamic, chunkSize) reduction (+: kmersPerPos, resSize, dbMatches, doubleMatches, querySeqLenSum, diagonalOverflow, kmerCacheHits, kmerCacheLookups) nowait
+        for (size_t batchStart = queryFrom; batchStart < queryFrom + querySize; batchStart += batchSize) {
+            const size_t batchEnd = std::min(batchStart + batchSize, queryFrom + querySize);
+            if (batchSize > 1) {
+                matcher.clearBatch();
+                for (size_t id = batchStart; id < batchEnd; id++) {
+                    seq.mapSequence(id, qdbr->getDbKey(id), qdbr->getData(id));
+                    matcher.addBatchQuery(&seq);
                 }
+                matcher.prepareBatch();
             }
-            // calculate prefiltering results
-            std::pair<hit_t *, size_t> prefResults = matcher.matchQuery(&seq, targetSeqId);
-            size_t resultSize = prefResults.second;
-            // write
-            writePrefilterOutput(qdbr, &tmpDbw, thread_idx, id, prefResults, dbFrom, resListOffset, maxResults);
-
-            // update statistics counters
-            if (resultSize != 0) {
-                notEmpty[id - queryFrom] = 1;
-            }
+            // queries before gatheredEnd have their hits in the hit buffer of the matcher
+            size_t gatheredEnd = batchStart;
+            for (size_t id = batchStart; id < batchEnd; id++) {
+                Debug::printProgress(id);
+                // get query sequence
+                char *seqData = qdbr->getData(id);
+                unsigned int qKey = qdbr->getDbKey(id);
+                seq.mapSequence(id, qKey, seqData);
+                // only the corresponding split should include the id (hack for the hack)
+                size_t targetSeqId = UINT_MAX;
+                if (id >= dbFrom && id < (dbFrom + dbSize) && (sameQTDB || includeIdentical)) {
+                    targetSeqId = tdbr->getId(seq.getDbKey());
+                    if (targetSeqId != UINT_MAX) {
+                        targetSeqId = targetSeqId - dbFrom;
+                    }
+                }
+                // calculate prefiltering results
+                std::pair<hit_t *, size_t> prefResults;
+                if (batchSize > 1 && matcher.isBatchQuery(id - batchStart)) {
+                    if (id >= gatheredEnd) {
+                        gatheredEnd = batchStart + matcher.gatherBatch(id - batchStart);
+                    }
+                    prefResults = matcher.matchBatchQuery(&seq, id - batchStart, targetSeqId);
+                } else {
+                    prefResults = matcher.matchQuery(&seq, targetSeqId);
+                }
+                size_t resultSize = prefResults.second;
+                // write
+                const double writeStart = (metrics != NULL) ? PrefilterMetrics::now() : 0.0;
+                writePrefilterOutput(qdbr, &tmpDbw, thread_idx, id, prefResults, dbFrom, resListOffset, maxResults);
+                if (metrics != NULL) {
+                    metrics->stageTime[PrefilterMetrics::WRITING] += PrefilterMetrics::now() - writeStart;
+                    metrics->hitsPerQuery[PrefilterMetrics::histogramBin(resultSize)]++;
+                    metrics->queries++;
+                }
 
-            kmersPerPos += (size_t) matcher.getStatistics()->kmersPerPos;
-            dbMatches += matcher.getStatistics()->dbMatches;
-            doubleMatches += matcher.getStatistics()->doubleMatches;
-            querySeqLenSum += seq.L;
-            diagonalOverflow += matcher.getStatistics()->diagonalOverflow;
-            resSize += resultSize;
-            realResSize += std::min(resultSize, maxResults);
-            reslens[thread_idx]->emplace_back(resultSize);
+                // update statistics counters
+                if (resultSize != 0) {
+                    notEmpty[id - queryFrom] = 1;
+                }
+
+                kmersPerPos += (size_t) matcher.getStatistics()->kmersPerPos;
+                dbMatches += matcher.getStatistics()->dbMatches;
+                doubleMatches += matcher.getStatistics()->doubleMatches;
+                querySeqLenSum += seq.L;
+                diagonalOverflow += matcher.getStatistics()->diagonalOverflow;
+                kmerCacheHits += matcher.getStatistics()->kmerCacheHits;
+                kmerCacheLookups += matcher.getStatistics()->kmerCacheLookups;
+                resSize += resultSize;
+                realResSize += std::min(resultSize, maxResults);
+                reslens[thread_idx]->emplace_back(resultSize);
+            }
         } // step end
+        if (metrics != NULL) {
+            threadLoopEnd[thread_idx] = PrefilterMetrics::now();
+            metrics->busyTime = threadLoopEnd[thread_idx] - loopStart;
+        }
+        // the OpenMP threads are reused by later parallel regions
+        numaIndexTable.unpinThread();
+    }
+
+    if (collectMetrics) {
+        const double splitEnd = PrefilterMetrics::now();
+        // threads that OpenMP did not start would count as idle for the whole split
+        threadMetrics.resize(teamSize);
+        threadLoopEnd.resize(teamSize);
+        for (unsigned int i = 0; i < teamSize; i++) {
+            threadMetrics[i].idleTime = splitEnd - threadLoopEnd[i];
+        }
+        statistics_t stats(kmersPerPos / totalQueryDBSize,
+                           dbMatches / totalQueryDBSize,
+                           doubleMatches / totalQueryDBSize,
+                           querySeqLenSum, diagonalOverflow,
+                           resSize / totalQueryDBSize);
+        stats.kmerCacheHits = kmerCacheHits;
+        stats.kmerCacheLookups = kmerCacheLookups;
+        splitMetrics.push_back(formatSplitMetrics(split, splitCount, queryFrom, querySize, dbFrom, dbSize, maxResults,
+                                                  splitEnd - splitStart, stats, threadMetrics));
     }
 
     if (Debug::debugLevel >= Debug::INFO) {
@@ -769,6 +1173,8 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
                            doubleMatches / totalQueryDBSize,
                            querySeqLenSum, diagonalOverflow,
                            resSize / totalQueryDBSize);
+        stats.kmerCacheHits = kmerCacheHits;
+        stats.kmerCacheLookups = kmerCacheLookups;
 
         size_t empty = 0;
         for (size_t id = 0; id < querySize; id++) {
@@ -780,6 +1186,7 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
         printStatistics(stats, reslens, localThreads, empty, maxResults);
     }
     Debug(Debug::INFO) << "\nTime for prefiltering scores calculation: " << timer.lap() << "\n";
+    delete kmerListCache;
     tmpDbw.close(); // sorts the index
 
     // sort by ids
@@ -862,6 +1269,9 @@ void Prefiltering::printStatistics(const statistics_t &stats, std::list<int> **r
     Debug(Debug::INFO) << "\n" << stats.kmersPerPos << " k-mers per position.\n";
     Debug(Debug::INFO) << stats.dbMatches << " DB matches per sequence.\n";
     Debug(Debug::INFO) << stats.diagonalOverflow << " Overflows.\n";
+    if (stats.kmerCacheLookups > 0) {
+        Debug(Debug::INFO) << 100.0 * stats.kmerCacheHits / stats.kmerCacheLookups << "% of the k-mer lists found in the cache.\n";
+    }
     Debug(Debug::INFO) << stats.resultsPassedPrefPerSeq << " sequences passed prefiltering per query sequence";
     if (stats.resultsPassedPrefPerSeq > maxResults)
         Debug(Debug::INFO) << " (ATTENTION: max. " << maxResults
@@ -875,6 +1285,94 @@ void Prefiltering::printStatistics(const statistics_t &stats, std::list<int> **r
     Debug(Debug::INFO) << empty << " sequences with 0 size result lists.\n";
 }
 
+static void appendHistogram(std::ostringstream &out, const size_t *histogram) {
+    out << "[";
+    bool first = true;
+    for (size_t bin = 0; bin < PrefilterMetrics::HISTOGRAM_BINS; bin++) {
+        if (histogram[bin] == 0) {
+            continue;
+        }
+        const size_t from = (bin == 0) ? 0 : (static_cast<size_t>(1) << (bin - 1));
+        const size_t to = (bin == 0) ? 0 : (static_cast<size_t>(1) << bin) - 1;
+        out << (first ? "" : ", ") << "{\"from\": " << from << ", \"to\": " << to << ", \"count\": " << histogram[bin] << "}";
+        first = false;
+    }
+    out << "]";
+}
+
+std::string Prefiltering::formatSplitMetrics(size_t split, size_t splitCount, size_t queryFrom, size_t querySize,
+                                             size_t dbFrom, size_t dbSize, size_t maxResults, double wallTime,
+                                             const statistics_t &stats, const std::vector<PrefilterMetrics> &threadMetrics) {
+    PrefilterMetrics total;
+    for (size_t i = 0; i < threadMetrics.size(); i++) {
+        total.merge(threadMetrics[i]);
+    }
+
+    std::ostringstream out;
+    out << "    {\n";
+    out << "      \"split\": " << split << ",\n";
+    out << "      \"splitCount\": " << splitCount << ",\n";
+    out << "      \"queryFrom\": " << queryFrom << ", \"querySize\": " << querySize << ",\n";
+    out << "      \"targetFrom\": " << dbFrom << ", \"targetSize\": " << dbSize << ",\n";
+    out << "      \"maxResults\": " << maxResults << ",\n";
+    out << "      \"wallTime\": " << wallTime << ",\n";
+    out << "      \"kmersPerPosition\": " << stats.kmersPerPos << ",\n";
+    out << "      \"dbMatchesPerQuery\": " << stats.dbMatches << ",\n";
+    out << "      \"doubleMatchesPerQuery\": " << stats.doubleMatches << ",\n";
+    out << "      \"hitsPerQuery\": " << stats.resultsPassedPrefPerSeq << ",\n";
+    out << "      \"diagonalOverflows\": " << stats.diagonalOverflow << ",\n";
+    out << "      \"kmerCacheHits\": " << stats.kmerCacheHits << ", \"kmerCacheLookups\": " << stats.kmerCacheLookups << ",\n";
+    // summed over all threads, divide by the thread count for the share of the wall time
+    out << "      \"stageTime\": {";
+    for (size_t stage = 0; stage < PrefilterMetrics::STAGE_COUNT; stage++) {
+        out << (stage == 0 ? "" : ", ") << "\"" << PrefilterMetrics::stageName(stage) << "\": " << total.stageTime[stage];
+    }
+    out << "},\n";
+    out << "      \"postingListLengths\": ";
+    appendHistogram(out, total.listLengths);
+    out << ",\n";
+    out << "      \"hitsPerQueryHistogram\": ";
+    appendHistogram(out, total.hitsPerQuery);
+    out << ",\n";
+    out << "      \"threads\": [";
+    for (size_t i = 0; i < threadMetrics.size(); i++) {
+        out << (i == 0 ? "" : ", ") << "{\"queries\": " << threadMetrics[i].queries
+            << ", \"busyTime\": " << threadMetrics[i].busyTime << ", \"idleTime\": " << threadMetrics[i].idleTime << "}";
+    }
+    out << "]\n";
+    out << "    }";
+    return out.str();
+}
+
+void Prefiltering::writeMetrics(size_t totalSplits) {
+    std::string fileName = metricsFile;
+#ifdef HAVE_MPI
+    if (MMseqsMPI::isMaster() == false) {
+        fileName += "." + SSTR(MMseqsMPI::rank);
+    }
+#endif
+    FILE *file = FileUtil::openFileOrDie(fileName.c_str(), "w", false);
+    std::ostringstream out;
+    out << "{\n";
+    out << "  \"kmerSize\": " << kmerSize << ",\n";
+    out << "  \"kmerThreshold\": " << kmerThr << ",\n";
+    out << "  \"sensitivity\": " << sensitivity << ",\n";
+    out << "  \"maxSeqs\": " << maxResListLen << ",\n";
+    out << "  \"splitMode\": \"" << (splitMode == Parameters::TARGET_DB_SPLIT ? "target" : "query") << "\",\n";
+    out << "  \"splits\": " << totalSplits << ",\n";
+    out << "  \"threads\": " << threads << ",\n";
+    out << "  \"splitRuns\": [\n";
+    for (size_t i = 0; i < splitMetrics.size(); i++) {
+        out << splitMetrics[i] << ((i + 1 < splitMetrics.size()) ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+    const std::string json = out.str();
+    fwrite(json.c_str(), sizeof(char), json.size(), file);
+    fclose(file);
+    Debug(Debug::INFO) << "Prefilter metrics written to " << fileName << "\n";
+}
+
 BaseMatrix *Prefiltering::getSubstitutionMatrix(const std::string &scoringMatrixFile, size_t alphabetSize, float bitFactor, bool profileState) {
     Debug(Debug::INFO) << "Substitution matrices...\n";
     BaseMatrix *subMat;
@@ -1003,10 +1501,9 @@ int Prefiltering::getKmerThreshold(const float sensitivity, const int querySeqTy
 size_t Prefiltering::estimateMemoryConsumption(int split, size_t dbSize, size_t resSize,
                                                size_t maxHitsPerQuery,
                                                int alphabetSize, int kmerSize, unsigned int querySeqType,
-                                               int threads) {
-    // for each residue in the database we need 7 byte
+                                               int threads, double residueBytes) {
     size_t dbSizeSplit = (dbSize) / split;
-    size_t residueSize = (resSize / split * 7);
+    size_t residueSize = static_cast<size_t>(resSize / split * residueBytes);
     // 21^7 * pointer size is needed for the index
     size_t indexTableSize = static_cast<size_t>(pow(alphabetSize, kmerSize)) * sizeof(size_t *);
     // memory needed for the threads
@@ -1044,7 +1541,8 @@ std::pair<int, int> Prefiltering::optimizeSplit(size_t totalMemoryInByte, DBRead
                 size_t aaUpperBoundForKmerSize = IndexTable::getUpperBoundAACountForKmerSize(optKmerSize);
                 if ((tdbr->getAminoAcidDBSize() / optSplit) < aaUpperBoundForKmerSize) {
                     size_t neededSize = estimateMemoryConsumption(optSplit, tdbr->getSize(), tdbr->getAminoAcidDBSize(),
-                                                                  0, alphabetSize, optKmerSize, querySeqType, threads);
+                                                                  0, alphabetSize, optKmerSize, querySeqType, threads,
+                                                                  ESTIMATED_RESIDUE_BYTES);
                     if (neededSize < 0.9 * totalMemoryInByte) {
                         return std::make_pair(optKmerSize, optSplit);
                     }
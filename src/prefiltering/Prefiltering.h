@@ -35,7 +35,7 @@ public:
 
     bool runSplits(const std::string &queryDB, const std::string &queryDBIndex,
                    const std::string &resultDB, const std::string &resultDBIndex,
-                   size_t fromSplit, size_t splitProcessCount);
+                   size_t fromSplit, size_t splitProcessCount, bool requestSplits = false);
 
     // merge file
     void mergeFiles(const std::string &outDb, const std::string &outDBIndex,
@@ -53,6 +53,14 @@ public:
 
 private:
     static const size_t BUFFER_SIZE = 1000000;
+    // longer similar k-mer lists are not cached, every cached list takes 6 bytes per k-mer
+    static const size_t KMER_CACHE_MAX_LIST_SIZE = 512;
+    // index entry and sequence lookup bytes per target residue if they are not measured
+    static const size_t ESTIMATED_RESIDUE_BYTES = 7;
+    // the split planner matches this many queries against this many target residues
+    static const size_t PLANNER_QUERY_SAMPLE = 1000;
+    static const size_t PLANNER_SAMPLE_RESIDUES = 5000000;
+    static const int PLANNER_MAX_SPLIT = 100;
 
     const std::string targetDB;
     const std::string targetDBIndex;
@@ -93,6 +101,14 @@ private:
     const bool includeIdentical;
     const bool noPreload;
     const unsigned int threads;
+    const size_t queryBatchSize;
+    const size_t kmerCacheSize;
+    const int numaMode;
+    const int mpiChunks;
+    const int checkpointChunks;
+    // JSON file with the stage times and histograms of every split, empty if not requested
+    const std::string metricsFile;
+    std::vector<std::string> splitMetrics;
 
     bool runSplit(DBReader<unsigned int> *qdbr, const std::string &resultDB, const std::string &resultDBIndex,
                   size_t split, size_t splitCount, bool sameQTDB);
@@ -105,7 +121,28 @@ private:
     static size_t estimateMemoryConsumption(int split, size_t dbSize, size_t resSize,
                                             size_t maxHitsPerQuery,
                                             int alphabetSize, int kmerSize, unsigned int querySeqType,
-                                            int threads);
+                                            int threads, double residueBytes);
+
+    struct SampleTiming {
+        size_t residues;
+        size_t indexBytes;
+        // wall time of the index build and per query
+        double buildTime;
+        double queryTime;
+    };
+
+    // build the index of the target sequences dbFrom to dbFrom + dbSize and match the query sample against it
+    SampleTiming measureSample(DBReader<unsigned int> *qdbr, const std::vector<size_t> &querySample,
+                               size_t dbFrom, size_t dbSize, ScoreMatrix *two, ScoreMatrix *three);
+
+    // choose the split count and mode with the lowest predicted wall time that fits into memoryLimit
+    // from the index size and query throughput measured on a sample
+    void planSplit(const std::string &queryDB, const std::string &queryDBIndex, const size_t memoryLimit,
+                   const bool autoSplit, const bool autoSplitMode);
+
+    // takes the split count and mode from the checkpoint of the result, returns false if there is none
+    // or it was written for other databases or settings
+    bool restoreCheckpointSplit(const std::string &queryDB, const std::string &queryDBIndex, const std::string &resultDB);
 
     static size_t estimateHDDMemoryConsumption(size_t dbSize, size_t maxResListLen);
 
@@ -115,6 +152,11 @@ private:
     // needed for index lookup
     void getIndexTable(int split, size_t dbFrom, size_t dbSize);
 
+    // k-mer threshold of the index table, profiles and exact k-mer matching index only the exact k-mers
+    int getIndexKmerThr();
+
+    IndexTable *buildIndexTable(size_t dbFrom, size_t dbSize, int indexKmerThr, SequenceLookup **lookup);
+
     /*
      * Set the k-mer similarity threshold that regulates the length of k-mer lists for each k-mer in the query sequence.
      * As a result, the prefilter always has roughly the same speed for different k-mer and alphabet sizes.
@@ -129,6 +171,12 @@ private:
     void printStatistics(const statistics_t &stats, std::list<int> **reslens,
                          unsigned int resLensSize, size_t empty, size_t maxResults);
 
+    std::string formatSplitMetrics(size_t split, size_t splitCount, size_t queryFrom, size_t querySize,
+                                   size_t dbFrom, size_t dbSize, size_t maxResults, double wallTime,
+                                   const statistics_t &stats, const std::vector<PrefilterMetrics> &threadMetrics);
+
+    void writeMetrics(size_t totalSplits);
+
     void mergeOutput(const std::string &outDb, const std::string &outDBIndex,
                      const std::vector<std::pair<std::string, std::string>> &filenames);
 
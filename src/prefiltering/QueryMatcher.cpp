@@ -42,17 +42,21 @@ QueryMatcher::QueryMatcher(IndexTable *indexTable, SequenceLookup *sequenceLooku
     this->takeOnlyBestKmer = takeOnlyBestKmer;
 
     this->stats = new statistics_t();
+    this->metrics = NULL;
     // assure that the whole database can be matched (extreme case)
     // this array will need 500 MB for 50 Mio. sequences ( dbSize * 2 * 5byte)
     this->dbSize = dbSize;
     this->counterResultSize = std::max((size_t)1000000, dbSize);
+    this->defaultCounterResultSize = counterResultSize;
     this->maxDbMatches = std::max((size_t)1000000, dbSize) * 2;
     this->resList = (hit_t *) mem_align(ALIGN_INT, maxHitsPerQuery * sizeof(hit_t) );
-    this->databaseHits = new(std::nothrow) IndexEntryLocal[maxDbMatches];
+    // grows for queries with more hits
+    this->hitBufferSize = maxDbMatches;
+    this->databaseHits = new(std::nothrow) IndexEntryLocal[hitBufferSize];
     Util::checkAllocation(databaseHits, "Could not allocate databaseHits memory in QueryMatcher");
     this->foundDiagonals = (CounterResult*)calloc(counterResultSize, sizeof(CounterResult));
     Util::checkAllocation(foundDiagonals, "Could not allocate foundDiagonals memory in QueryMatcher");
-    this->lastSequenceHit = this->databaseHits + maxDbMatches;
+    this->lastSequenceHit = this->databaseHits + hitBufferSize;
     this->indexPointer = new(std::nothrow) IndexEntryLocal*[maxSeqLen + 1];
     Util::checkAllocation(indexPointer, "Could not allocate indexPointer memory in QueryMatcher");
     this->diagonalScoring = diagonalScoring;
@@ -86,6 +90,8 @@ QueryMatcher::QueryMatcher(IndexTable *indexTable, SequenceLookup *sequenceLooku
         }
     }
     compositionBias = new float[maxSeqLen];
+    // only allocated if queries are matched in batches
+    stagingHits = NULL;
 }
 
 QueryMatcher::~QueryMatcher(){
@@ -93,6 +99,9 @@ QueryMatcher::~QueryMatcher(){
     free(resList);
     delete [] scoreSizes;
     delete [] databaseHits;
+    if(stagingHits != NULL){
+        delete [] stagingHits;
+    }
     delete [] indexPointer;
     free(foundDiagonals);
     if(logScoreFactorial != NULL){
@@ -122,12 +131,7 @@ size_t QueryMatcher::evaluateBins(IndexEntryLocal **hitsByIndex,
     return localResultSize;
 }
 
-std::pair<hit_t *, size_t> QueryMatcher::matchQuery (Sequence * querySeq, unsigned int identityId){
-    querySeq->resetCurrPos();
-//    std::cout << "Id: " << querySeq->getId() << std::endl;
-    memset(scoreSizes, 0, SCORE_RANGE * sizeof(unsigned int));
-
-    // bias correction
+void QueryMatcher::computeCompositionBias(Sequence *querySeq) {
     if(aaBiasCorrection == true){
         if(querySeq->getSeqType() == Sequence::AMINO_ACIDS) {
             SubstitutionMatrix::calcLocalAaBiasCorrection(m, querySeq->int_sequence, querySeq->L, compositionBias);
@@ -137,12 +141,34 @@ std::pair<hit_t *, size_t> QueryMatcher::matchQuery (Sequence * querySeq, unsign
     } else {
         memset(compositionBias, 0, sizeof(float) * querySeq->L);
     }
+}
+
+std::pair<hit_t *, size_t> QueryMatcher::matchQuery (Sequence * querySeq, unsigned int identityId){
+    querySeq->resetCurrPos();
+//    std::cout << "Id: " << querySeq->getId() << std::endl;
+    memset(scoreSizes, 0, SCORE_RANGE * sizeof(unsigned int));
+
+    // bias correction
+    const double biasStart = (metrics != NULL) ? PrefilterMetrics::now() : 0.0;
+    computeCompositionBias(querySeq);
+    if (metrics != NULL) {
+        metrics->stageTime[PrefilterMetrics::KMER_GENERATION] += PrefilterMetrics::now() - biasStart;
+    }
 
     size_t resultSize = match(querySeq, compositionBias);
+    return scoreMatches(querySeq, identityId, resultSize);
+}
+
+std::pair<hit_t *, size_t> QueryMatcher::scoreMatches(Sequence *querySeq, unsigned int identityId, size_t resultSize) {
     std::pair<hit_t *, size_t > queryResult;
+    const double scoreStart = (metrics != NULL) ? PrefilterMetrics::now() : 0.0;
+    double rescoreTime = 0.0;
     if(diagonalScoring == true) {
         // write diagonal scores in count value
         ungappedAlignment->processQuery(querySeq, compositionBias, foundDiagonals, resultSize);
+        if (metrics != NULL) {
+            rescoreTime += PrefilterMetrics::now() - scoreStart;
+        }
         memset(scoreSizes, 0, SCORE_RANGE * sizeof(unsigned int));
 
 
@@ -160,7 +186,11 @@ std::pair<hit_t *, size_t> QueryMatcher::matchQuery (Sequence * querySeq, unsign
             int elementsCntAboveDiagonalThr = radixSortByScoreSize(scoreSizes, foundDiagonals + resultSize, diagonalThr, foundDiagonals, resultSize);
             if(scoreIsTruncated == true){
                 memset(scoreSizes, 0, SCORE_RANGE * sizeof(unsigned int));
+                const double rescoreStart = (metrics != NULL) ? PrefilterMetrics::now() : 0.0;
                 std::pair<size_t, unsigned int> rescoreResult = rescoreHits(querySeq, scoreSizes, foundDiagonals + resultSize, resultSize, ungappedAlignment, maxDiagonalScoreThr);
+                if (metrics != NULL) {
+                    rescoreTime += PrefilterMetrics::now() - rescoreStart;
+                }
                 size_t newResultSize = rescoreResult.first;
                 unsigned int maxSelfScoreMinusDiag = rescoreResult.second;
 
@@ -194,6 +224,10 @@ std::pair<hit_t *, size_t> QueryMatcher::matchQuery (Sequence * querySeq, unsign
             std::sort(resList, resList + queryResult.second, hit_t::compareHitsByPValueAndId);
         }
     }
+    if (metrics != NULL) {
+        metrics->stageTime[PrefilterMetrics::UNGAPPED_RESCORING] += rescoreTime;
+        metrics->stageTime[PrefilterMetrics::SORTING] += PrefilterMetrics::now() - scoreStart - rescoreTime;
+    }
     return queryResult;
 }
 
@@ -201,16 +235,19 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
     // go through the query sequence
     size_t kmerListLen = 0;
     size_t numMatches = 0;
-    size_t overflowNumMatches = 0;
-    size_t overflowHitCount = 0;
     //size_t pos = 0;
-    stats->diagonalOverflow = false;
+    const size_t cacheHits = kmerGenerator->getCacheHits();
+    const size_t cacheLookups = kmerGenerator->getCacheLookups();
+    shrinkBuffers();
     IndexEntryLocal* sequenceHits = databaseHits;
     size_t seqListSize;
-    unsigned short indexStart = 0;
     unsigned short indexTo = 0;
     Indexer idx(indexTable->getAlphabetSize(), kmerSize);
     const int xIndex = m->aa2int[(int)'X'];
+    // stage times are taken twice per position, between the k-mer list generation and the lookups
+    double stageStart = (metrics != NULL) ? PrefilterMetrics::now() : 0.0;
+    double kmerTime = 0.0;
+    double lookupTime = 0.0;
 
     while(seq->hasNextKmer()){
         const int * kmer = seq->nextKmer();
@@ -247,6 +284,11 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
             kmerElementSize = kmerList.elementSize;
             index = kmerList.index;
         }
+        if (metrics != NULL) {
+            const double time = PrefilterMetrics::now();
+            kmerTime += time - stageStart;
+            stageStart = time;
+        }
         //std::cout << kmer << std::endl;
         indexPointer[current_i] = sequenceHits;
         // match the index table
@@ -255,12 +297,33 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
         //std::cout  << "\t" << kmerMatchScore << std::endl;
         kmerListLen += kmerElementSize;
 
+        // fill the lookup window before the first list is copied
+        // std::min takes references, copy the in-class constants so they need no definition
+        const size_t offsetDistance = IndexTable::PREFETCH_OFFSET_DISTANCE;
+        const size_t listDistance = IndexTable::PREFETCH_LIST_DISTANCE;
+        const size_t offsetWindow = std::min(kmerElementSize, offsetDistance);
+        for (size_t kmerPos = 0; kmerPos < offsetWindow; kmerPos++) {
+            indexTable->prefetchOffset(index[kmerPos]);
+        }
+        const size_t listWindow = std::min(kmerElementSize, listDistance);
+        for (size_t kmerPos = 0; kmerPos < listWindow; kmerPos++) {
+            indexTable->prefetchDBSeqList(index[kmerPos]);
+        }
+
         for (unsigned int kmerPos = 0; kmerPos < kmerElementSize; kmerPos++) {
-            // generate k-mer list
+            if (kmerPos + IndexTable::PREFETCH_OFFSET_DISTANCE < kmerElementSize) {
+                indexTable->prefetchOffset(index[kmerPos + IndexTable::PREFETCH_OFFSET_DISTANCE]);
+            }
+            if (kmerPos + IndexTable::PREFETCH_LIST_DISTANCE < kmerElementSize) {
+                indexTable->prefetchDBSeqList(index[kmerPos + IndexTable::PREFETCH_LIST_DISTANCE]);
+            }
 //                        idx.printKmer(index[kmerPos], kmerSize, m->int2aa);
 //                        std::cout << std::endl;
 
             const IndexEntryLocal *entries = indexTable->getDBSeqList(index[kmerPos], &seqListSize);
+            if (metrics != NULL) {
+                metrics->listLengths[PrefilterMetrics::histogramBin(seqListSize)]++;
+            }
 
             /////DEBUG
            /* 
@@ -273,46 +336,40 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
             std::cout << std::endl;
             */
             /////DEBUG
-            // detected overflow while matching
-            if ((sequenceHits + seqListSize) >= lastSequenceHit) {
-                stats->diagonalOverflow = true;
-                // last pointer
-                indexPointer[current_i + 1] = sequenceHits;
-//                std::cout << "Overflow in i=" << indexStart << std::endl;
-                const size_t hitCount = evaluateBins(indexPointer,
-                                                     foundDiagonals + overflowHitCount,
-                                                     counterResultSize - overflowHitCount,
-                                                     indexStart, current_i, (diagonalScoring == false));
-                if(overflowHitCount != 0){ //merge lists
-                    // hitCount is max. dbSize so there can be no overflow in mergeElemens
-                    overflowHitCount = mergeElements(diagonalScoring, foundDiagonals, overflowHitCount +  hitCount);
-                } else {
-                    overflowHitCount = hitCount;
+            // the hit buffer is grown instead of counting the diagonals in several rounds,
+            // its new size follows from the posting list sizes of the remaining similar k-mers of this position
+            if (UNLIKELY(sequenceHits + seqListSize >= lastSequenceHit)) {
+                size_t positionHits = 0;
+                for (size_t i = kmerPos; i < kmerElementSize; i++) {
+                    positionHits += indexTable->getOffset(index[i] + 1) - indexTable->getOffset(index[i]);
                 }
-                // reset pointer position
-                sequenceHits = databaseHits;
-                indexPointer[current_i] = databaseHits;
-                indexStart = current_i;
-                overflowNumMatches += numMatches;
-                numMatches = 0;
-                if((sequenceHits + seqListSize) >= lastSequenceHit){
-                    goto outer;
-                }
-            };
+                growDatabaseHits(numMatches + positionHits + 1, numMatches, current_i);
+                sequenceHits = databaseHits + numMatches;
+            }
             memcpy(sequenceHits, entries, sizeof(IndexEntryLocal) * seqListSize);
             sequenceHits += seqListSize;
             numMatches += seqListSize;
         }
         indexTo = current_i;
+        if (metrics != NULL) {
+            const double time = PrefilterMetrics::now();
+            lookupTime += time - stageStart;
+            stageStart = time;
+        }
     }
-    outer:
     indexPointer[indexTo + 1] = databaseHits + numMatches;
-    size_t hitCount = evaluateBins(indexPointer, foundDiagonals + overflowHitCount,
-                                   counterResultSize - overflowHitCount, indexStart, indexTo,  (diagonalScoring == false));
-    //fill the output
-    if(overflowHitCount != 0){ // overflow occurred
-        hitCount = mergeElements(diagonalScoring, foundDiagonals, overflowHitCount + hitCount);
+    // every double hit needs an earlier hit, so numMatches results always fit
+    if (numMatches >= counterResultSize) {
+        growFoundDiagonals(numMatches + 1);
+    }
+    size_t hitCount = evaluateBins(indexPointer, foundDiagonals, counterResultSize, 0, indexTo, (diagonalScoring == false));
+    if (metrics != NULL) {
+        metrics->stageTime[PrefilterMetrics::KMER_GENERATION] += kmerTime;
+        metrics->stageTime[PrefilterMetrics::INDEX_LOOKUP] += lookupTime;
+        metrics->stageTime[PrefilterMetrics::DIAGONAL_COUNTING] += PrefilterMetrics::now() - stageStart;
     }
+    // the query did not fit into the default hit buffer
+    stats->diagonalOverflow = (numMatches >= maxDbMatches);
     stats->doubleMatches = 0;
     if(diagonalScoring == false) {
         // remove double entries
@@ -321,10 +378,276 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
     }
     stats->kmersPerPos   = ((double)kmerListLen/(double)seq->L);
     stats->querySeqLen   = seq->L;
-    stats->dbMatches     = overflowNumMatches + numMatches;
+    stats->dbMatches     = numMatches;
+    stats->kmerCacheHits = kmerGenerator->getCacheHits() - cacheHits;
+    stats->kmerCacheLookups = kmerGenerator->getCacheLookups() - cacheLookups;
     return hitCount;
 }
 
+void QueryMatcher::addBatchQuery(Sequence *querySeq) {
+    const double stageStart = (metrics != NULL) ? PrefilterMetrics::now() : 0.0;
+    querySeq->resetCurrPos();
+    computeCompositionBias(querySeq);
+
+    BatchQuery query;
+    query.positionFrom = batchPositions.size();
+    query.requestFrom = batchRequests.size();
+    query.kmerListLen = 0;
+    query.L = querySeq->L;
+    query.cacheHits = kmerGenerator->getCacheHits();
+    query.cacheLookups = kmerGenerator->getCacheLookups();
+
+    Indexer idx(indexTable->getAlphabetSize(), kmerSize);
+    const int xIndex = m->aa2int[(int)'X'];
+    // same k-mer generation as in match, the posting lists are only read in gatherBatch
+    while(querySeq->hasNextKmer()){
+        const int * kmer = querySeq->nextKmer();
+        const unsigned char * pos = querySeq->getAAPosInSpacedPattern();
+        const unsigned short current_i = querySeq->getCurrentPosition();
+
+        BatchPosition position;
+        position.requestFrom = batchRequests.size();
+        position.position = current_i;
+        batchPositions.push_back(position);
+
+        float biasCorrection = 0;
+        int xCount = 0;
+        for (int i = 0; i < kmerSize; i++){
+            xCount += (kmer[i] == xIndex);
+            biasCorrection += compositionBias[current_i + static_cast<short>(pos[i])];
+        }
+        if(xCount > 0){
+            continue;
+        }
+        short bias = static_cast<short>((biasCorrection < 0.0) ? biasCorrection - 0.5: biasCorrection + 0.5);
+        short kmerMatchScore = std::max(kmerThr - bias, 0);
+        kmerGenerator->setThreshold(kmerMatchScore);
+
+        SortEntry request;
+        if(takeOnlyBestKmer){
+            request.key = idx.int2index(kmer);
+            request.id = batchRequests.size();
+            batchRequests.push_back(request);
+            query.kmerListLen += 1;
+        }else{
+            ScoreMatrix kmerList = kmerGenerator->generateKmerList(kmer);
+            for (size_t i = 0; i < kmerList.elementSize; i++) {
+                request.key = kmerList.index[i];
+                request.id = batchRequests.size();
+                batchRequests.push_back(request);
+            }
+            query.kmerListLen += kmerList.elementSize;
+        }
+    }
+    query.positionTo = batchPositions.size();
+    query.requestTo = batchRequests.size();
+    query.cacheHits = kmerGenerator->getCacheHits() - query.cacheHits;
+    query.cacheLookups = kmerGenerator->getCacheLookups() - query.cacheLookups;
+    query.hitOffset = 0;
+    query.hitCount = 0;
+    query.batched = false;
+    batchQueries.push_back(query);
+    if (metrics != NULL) {
+        metrics->stageTime[PrefilterMetrics::KMER_GENERATION] += PrefilterMetrics::now() - stageStart;
+    }
+}
+
+static unsigned int bitsToRepresent(size_t value) {
+    unsigned int bits = 0;
+    while (value != 0) {
+        bits++;
+        value >>= 1;
+    }
+    return bits;
+}
+
+void QueryMatcher::radixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &buffer,
+                             unsigned int lowBit, unsigned int highBit) {
+    const unsigned int MAX_RADIX_BITS = 12;
+    size_t counts[1 << MAX_RADIX_BITS];
+    if (highBit <= lowBit) {
+        return;
+    }
+    const unsigned int passes = (highBit - lowBit + MAX_RADIX_BITS - 1) / MAX_RADIX_BITS;
+    const unsigned int radixBits = (highBit - lowBit + passes - 1) / passes;
+    const size_t buckets = static_cast<size_t>(1) << radixBits;
+    buffer.resize(entries.size());
+    for (unsigned int shift = lowBit; shift < highBit; shift += radixBits) {
+        memset(counts, 0, buckets * sizeof(size_t));
+        for (size_t i = 0; i < entries.size(); i++) {
+            counts[(entries[i].key >> shift) & (buckets - 1)]++;
+        }
+        size_t sum = 0;
+        for (size_t i = 0; i < buckets; i++) {
+            size_t count = counts[i];
+            counts[i] = sum;
+            sum += count;
+        }
+        for (size_t i = 0; i < entries.size(); i++) {
+            buffer[counts[(entries[i].key >> shift) & (buckets - 1)]++] = entries[i];
+        }
+        entries.swap(buffer);
+    }
+}
+
+void QueryMatcher::prepareBatch() {
+    const double stageStart = (metrics != NULL) ? PrefilterMetrics::now() : 0.0;
+    // bucket the requests by the highest bits of their k-mer, the offsets and posting lists of
+    // one bucket are close together so a full sort is not needed
+    const unsigned int kmerBits = bitsToRepresent(indexTable->getTableSize() - 1);
+    radixSort(batchRequests, batchSortBuffer, (kmerBits > 10) ? kmerBits - 10 : 0, kmerBits);
+
+    // walk the offsets of the index table bucket by bucket, most similar k-mers have an empty posting list
+    batchLists.clear();
+    for (size_t i = 0; i < batchRequests.size(); i++) {
+        const unsigned int kmer = batchRequests[i].key;
+        const size_t offset = indexTable->getOffset(kmer);
+        const size_t size = indexTable->getOffset(kmer + 1) - offset;
+        if (metrics != NULL) {
+            metrics->listLengths[PrefilterMetrics::histogramBin(size)]++;
+        }
+        if (size > 0) {
+            BatchList list;
+            list.entryOffset = offset;
+            list.requestId = batchRequests[i].id;
+            list.size = static_cast<unsigned int>(size);
+            batchLists.push_back(list);
+        }
+    }
+
+    listOrder.resize(batchLists.size());
+    for (size_t i = 0; i < batchLists.size(); i++) {
+        listOrder[i].key = batchLists[i].requestId;
+        listOrder[i].id = i;
+    }
+    radixSort(listOrder, batchSortBuffer, 0, bitsToRepresent(batchRequests.size()));
+    listStaging.resize(batchLists.size());
+
+    size_t list = 0;
+    for (size_t i = 0; i < batchQueries.size(); i++) {
+        BatchQuery &query = batchQueries[i];
+        query.listFrom = list;
+        size_t hitCount = 0;
+        while (list < listOrder.size() && listOrder[list].key < query.requestTo) {
+            hitCount += batchLists[listOrder[list].id].size;
+            list++;
+        }
+        query.listTo = list;
+        query.hitCount = hitCount;
+        // match would have to evaluate the bins in several rounds
+        query.batched = hitCount < maxDbMatches;
+    }
+    if (metrics != NULL) {
+        metrics->stageTime[PrefilterMetrics::INDEX_LOOKUP] += PrefilterMetrics::now() - stageStart;
+    }
+}
+
+size_t QueryMatcher::gatherBatch(size_t from) {
+    size_t to = from;
+    size_t used = 0;
+    while (to < batchQueries.size() && batchQueries[to].batched && used + batchQueries[to].hitCount <= maxDbMatches) {
+        used += batchQueries[to].hitCount;
+        to++;
+    }
+    if (to == from) {
+        return to;
+    }
+    shrinkBuffers();
+    const double stageStart = (metrics != NULL) ? PrefilterMetrics::now() : 0.0;
+    if (stagingHits == NULL) {
+        stagingHits = new(std::nothrow) IndexEntryLocal[maxDbMatches];
+        Util::checkAllocation(stagingHits, "Could not allocate stagingHits memory in QueryMatcher");
+    }
+
+    // read the posting lists of the gathered queries in the same order
+    const unsigned int requestFrom = batchQueries[from].requestFrom;
+    const unsigned int requestTo = batchQueries[to - 1].requestTo;
+    const IndexEntryLocal *entries = indexTable->getEntries();
+    size_t staged = 0;
+    for (size_t i = 0; i < batchLists.size(); i++) {
+        const BatchList &list = batchLists[i];
+        if (list.requestId < requestFrom || list.requestId >= requestTo) {
+            continue;
+        }
+        memcpy(stagingHits + staged, entries + list.entryOffset, sizeof(IndexEntryLocal) * list.size);
+        listStaging[i] = staged;
+        staged += list.size;
+    }
+
+    // and scatter them into the layout of match, ordered by query, position and similar k-mer
+    size_t hitOffset = 0;
+    for (size_t i = from; i < to; i++) {
+        BatchQuery &query = batchQueries[i];
+        query.hitOffset = hitOffset;
+        for (size_t k = query.listFrom; k < query.listTo; k++) {
+            const unsigned int list = listOrder[k].id;
+            const size_t size = batchLists[list].size;
+            memcpy(databaseHits + hitOffset, stagingHits + listStaging[list], sizeof(IndexEntryLocal) * size);
+            hitOffset += size;
+        }
+    }
+    if (metrics != NULL) {
+        metrics->stageTime[PrefilterMetrics::INDEX_LOOKUP] += PrefilterMetrics::now() - stageStart;
+    }
+    return to;
+}
+
+std::pair<hit_t *, size_t> QueryMatcher::matchBatchQuery(Sequence *querySeq, size_t batchIdx, unsigned int identityId) {
+    memset(scoreSizes, 0, SCORE_RANGE * sizeof(unsigned int));
+    double stageStart = (metrics != NULL) ? PrefilterMetrics::now() : 0.0;
+    computeCompositionBias(querySeq);
+    if (metrics != NULL) {
+        const double time = PrefilterMetrics::now();
+        metrics->stageTime[PrefilterMetrics::KMER_GENERATION] += time - stageStart;
+        stageStart = time;
+    }
+
+    const BatchQuery &query = batchQueries[batchIdx];
+    const size_t hitEnd = query.hitOffset + query.hitCount;
+    unsigned short indexTo = 0;
+    size_t hitPos = query.hitOffset;
+    size_t list = query.listFrom;
+    for (size_t i = query.positionFrom; i < query.positionTo; i++) {
+        const BatchPosition &position = batchPositions[i];
+        while (list < query.listTo && listOrder[list].key < position.requestFrom) {
+            hitPos += batchLists[listOrder[list].id].size;
+            list++;
+        }
+        indexPointer[position.position] = databaseHits + hitPos;
+        indexTo = position.position;
+    }
+    indexPointer[indexTo + 1] = databaseHits + hitEnd;
+    if (query.hitCount >= counterResultSize) {
+        growFoundDiagonals(query.hitCount + 1);
+    }
+    size_t hitCount = evaluateBins(indexPointer, foundDiagonals, counterResultSize, 0, indexTo, (diagonalScoring == false));
+    if (metrics != NULL) {
+        metrics->stageTime[PrefilterMetrics::DIAGONAL_COUNTING] += PrefilterMetrics::now() - stageStart;
+    }
+
+    stats->diagonalOverflow = false;
+    stats->doubleMatches = 0;
+    if(diagonalScoring == false) {
+        updateScoreBins(foundDiagonals, hitCount);
+        stats->doubleMatches = getDoubleDiagonalMatches();
+    }
+    stats->kmersPerPos   = ((double)query.kmerListLen/(double)query.L);
+    stats->querySeqLen   = query.L;
+    stats->dbMatches     = query.hitCount;
+    stats->kmerCacheHits = query.cacheHits;
+    stats->kmerCacheLookups = query.cacheLookups;
+
+    return scoreMatches(querySeq, identityId, hitCount);
+}
+
+void QueryMatcher::clearBatch() {
+    batchQueries.clear();
+    batchPositions.clear();
+    batchRequests.clear();
+    batchLists.clear();
+    listOrder.clear();
+}
+
 size_t QueryMatcher::getDoubleDiagonalMatches(){
     size_t retValue = 0;
     for(size_t i = 1; i < SCORE_RANGE; i++){
@@ -447,19 +770,38 @@ void QueryMatcher::deleteDiagonalMatcher(unsigned int activeCounter){
 #undef DELETE_CASE
 }
 
-size_t QueryMatcher::mergeElements(bool diagonalScoring, CounterResult *foundDiagonals, size_t hitCounter) {
-    size_t overflowHitCount = 0;
-#define MERGE_CASE(x) \
-    case x: overflowHitCount = (diagonalScoring == true) ? \
-                                cachedOperation##x->mergeElementsByDiagonal(foundDiagonals,hitCounter) : \
-                                cachedOperation##x->mergeElementsByScore(foundDiagonals,hitCounter); \
-    break;
+void QueryMatcher::growDatabaseHits(size_t hitCount, size_t usedHits, unsigned short positionTo) {
+    size_t newSize = std::max(hitBufferSize * 2, hitCount);
+    IndexEntryLocal *hits = new(std::nothrow) IndexEntryLocal[newSize];
+    Util::checkAllocation(hits, "Could not allocate databaseHits memory in QueryMatcher");
+    memcpy(hits, databaseHits, sizeof(IndexEntryLocal) * usedHits);
+    for (size_t i = 0; i <= positionTo; i++) {
+        indexPointer[i] = hits + (indexPointer[i] - databaseHits);
+    }
+    delete [] databaseHits;
+    databaseHits = hits;
+    hitBufferSize = newSize;
+    lastSequenceHit = databaseHits + hitBufferSize;
+}
 
-    switch (activeCounter){
-        FOR_EACH(MERGE_CASE,2,4,8,16,32,64,128,256,512,1024,2048)
+void QueryMatcher::growFoundDiagonals(size_t resultCount) {
+    free(foundDiagonals);
+    counterResultSize = resultCount;
+    foundDiagonals = (CounterResult*)calloc(counterResultSize, sizeof(CounterResult));
+    Util::checkAllocation(foundDiagonals, "Could not allocate foundDiagonals memory in QueryMatcher");
+}
+
+void QueryMatcher::shrinkBuffers() {
+    if (hitBufferSize > maxDbMatches) {
+        delete [] databaseHits;
+        hitBufferSize = maxDbMatches;
+        databaseHits = new(std::nothrow) IndexEntryLocal[hitBufferSize];
+        Util::checkAllocation(databaseHits, "Could not allocate databaseHits memory in QueryMatcher");
+        lastSequenceHit = databaseHits + hitBufferSize;
+    }
+    if (counterResultSize > defaultCounterResultSize) {
+        growFoundDiagonals(defaultCounterResultSize);
     }
-#undef MERGE_CASE
-    return overflowHitCount;
 }
 
 size_t QueryMatcher::keepMaxScoreElementOnly(CounterResult *foundDiagonals, size_t resultSize) {
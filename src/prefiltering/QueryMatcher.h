@@ -11,6 +11,7 @@
 #include "CacheFriendlyOperations.h"
 #include "UngappedAlignment.h"
 #include "KmerGenerator.h"
+#include "PrefilterMetrics.h"
 
 
 struct statistics_t{
@@ -20,14 +21,19 @@ struct statistics_t{
     size_t querySeqLen;
     size_t diagonalOverflow;
     size_t resultsPassedPrefPerSeq;
-    statistics_t() : kmersPerPos(0.0) , dbMatches(0) , doubleMatches(0), querySeqLen(0), diagonalOverflow(0), resultsPassedPrefPerSeq(0) {};
+    // similar k-mer lists found in the shared KmerListCache
+    size_t kmerCacheHits;
+    size_t kmerCacheLookups;
+    statistics_t() : kmersPerPos(0.0) , dbMatches(0) , doubleMatches(0), querySeqLen(0), diagonalOverflow(0), resultsPassedPrefPerSeq(0), kmerCacheHits(0), kmerCacheLookups(0) {};
     statistics_t(double kmersPerPos, size_t dbMatches,
                  size_t doubleMatches, size_t querySeqLen, size_t diagonalOverflow, size_t resultsPassedPrefPerSeq) : kmersPerPos(kmersPerPos),
                                                                                                                       dbMatches(dbMatches),
                                                                                                                       doubleMatches(doubleMatches),
                                                                                                                       querySeqLen(querySeqLen),
                                                                                                                       diagonalOverflow(diagonalOverflow),
-                                                                                                                      resultsPassedPrefPerSeq(resultsPassedPrefPerSeq){};
+                                                                                                                      resultsPassedPrefPerSeq(resultsPassedPrefPerSeq),
+                                                                                                                      kmerCacheHits(0),
+                                                                                                                      kmerCacheLookups(0){};
 };
 
 struct hit_t {
@@ -73,6 +79,23 @@ public:
     // identityId is the id of the identitical sequence in the target database if there is any, UINT_MAX otherwise
     std::pair<hit_t *, size_t>  matchQuery(Sequence * querySeq, unsigned int identityId);
 
+    // Double indexing: the similar k-mers of a batch of queries are sorted by k-mer so that the index table
+    // is walked once in sorted order and each posting list is read once per batch.
+    // Add all queries of the batch, call prepareBatch and then for every query in batch order either
+    // matchQuery (if isBatchQuery is false) or gatherBatch (if its hits are not gathered yet) and matchBatchQuery.
+    // The hits of each query end up in the same layout as in matchQuery, so the results are identical.
+    void addBatchQuery(Sequence * querySeq);
+    void prepareBatch();
+    // false if the hits of the query could overflow the hit buffer
+    bool isBatchQuery(size_t batchIdx) const {
+        return batchQueries[batchIdx].batched;
+    }
+    // copy the hits of the consecutive batch queries starting at from that fit into the hit buffer
+    // returns the end of the gathered range
+    size_t gatherBatch(size_t from);
+    std::pair<hit_t *, size_t>  matchBatchQuery(Sequence * querySeq, size_t batchIdx, unsigned int identityId);
+    void clearBatch();
+
     // find duplicates in the diagonal bins
     size_t evaluateBins(IndexEntryLocal **hitsByIndex, CounterResult *output,
                         size_t outputSize, unsigned short indexFrom, unsigned short indexTo, bool computeTotalScore);
@@ -89,6 +112,16 @@ public:
         this->kmerGenerator->setDivideStrategy(three, two );
     }
 
+    // share similar k-mer lists with the matchers of the other threads, not for profile queries
+    void setKmerListCache(KmerListCache * cache) {
+        this->kmerGenerator->setCache(cache);
+    }
+
+    // collect stage times and the posting list histogram, NULL to switch it off
+    void setMetrics(PrefilterMetrics * metrics) {
+        this->metrics = metrics;
+    }
+
     // get statistics
     const statistics_t * getStatistics(){
         return stats;
@@ -166,6 +199,8 @@ protected:
 
     // keeps stats for run
     statistics_t * stats;
+    // stage times of the thread, NULL if not requested
+    PrefilterMetrics * metrics;
     // scoring matrix for local amino acid bias correction
     BaseMatrix * m;
     /* generates kmer lists */
@@ -216,11 +251,12 @@ protected:
 
     // keeps data in inner loop
     IndexEntryLocal * __restrict databaseHits;
+    size_t hitBufferSize;
 
     // evaluated bins
     CounterResult * foundDiagonals;
 
-    // last data pointer (for overflow check)
+    // last data pointer (for growing databaseHits)
     IndexEntryLocal * lastSequenceHit;
 
     // the following variables are needed to calculate the Z-score computation
@@ -245,6 +281,64 @@ protected:
     // match sequence against the IndexTable
     size_t match(Sequence *seq, float *pDouble);
 
+    void computeCompositionBias(Sequence *querySeq);
+
+    // score the hits found by match and fill resList
+    std::pair<hit_t *, size_t> scoreMatches(Sequence *querySeq, unsigned int identityId, size_t resultSize);
+
+    struct BatchQuery {
+        size_t positionFrom;
+        size_t positionTo;
+        size_t requestFrom;
+        size_t requestTo;
+        // non empty posting lists of the query in listOrder
+        size_t listFrom;
+        size_t listTo;
+        // start of the gathered hits in databaseHits
+        size_t hitOffset;
+        size_t hitCount;
+        size_t kmerListLen;
+        size_t cacheHits;
+        size_t cacheLookups;
+        int L;
+        bool batched;
+    };
+
+    // first k-mer request of a query position
+    struct BatchPosition {
+        size_t requestFrom;
+        unsigned short position;
+    };
+
+    struct SortEntry {
+        unsigned int key;
+        unsigned int id;
+    };
+
+    // non empty posting list of a request
+    struct BatchList {
+        size_t entryOffset;
+        unsigned int requestId;
+        unsigned int size;
+    };
+
+    std::vector<BatchQuery> batchQueries;
+    std::vector<BatchPosition> batchPositions;
+    // k-mer and id of every similar k-mer, ordered by k-mer in prepareBatch
+    std::vector<SortEntry> batchRequests;
+    std::vector<SortEntry> batchSortBuffer;
+    // non empty posting lists in k-mer bucket order and their order by request id
+    std::vector<BatchList> batchLists;
+    std::vector<SortEntry> listOrder;
+    // position of each posting list in stagingHits
+    std::vector<size_t> listStaging;
+    // posting lists in the order they were read from the index table, before they are scattered to databaseHits
+    IndexEntryLocal *stagingHits;
+
+    // stable radix sort by the bits lowBit to highBit - 1 of the key
+    static void radixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &buffer,
+                          unsigned int lowBit, unsigned int highBit);
+
     // extract result from databaseHits
     std::pair<hit_t *, size_t> getResult(CounterResult * results,
                                          size_t resultSize,
@@ -263,12 +357,20 @@ protected:
     unsigned int minDiagScoreThr;
     // size of max diagonalMatcher result objects
     size_t counterResultSize;
+    size_t defaultCounterResultSize;
 
     void initDiagonalMatcher(size_t dbsize, unsigned int maxDbMatches);
 
     void deleteDiagonalMatcher(unsigned int activeCounter);
 
-    size_t mergeElements(bool diagonalScoring, CounterResult *foundDiagonals, size_t hitCounter);
+    // reallocate databaseHits for at least hitCount hits and move the index pointers up to positionTo
+    void growDatabaseHits(size_t hitCount, size_t usedHits, unsigned short positionTo);
+
+    // reallocate foundDiagonals for resultCount results, its content is lost
+    void growFoundDiagonals(size_t resultCount);
+
+    // a query with many hits grew the buffers, the next query starts with the default sizes again
+    void shrinkBuffers();
 
     size_t keepMaxScoreElementOnly(CounterResult *foundDiagonals, size_t resultSize);
 
@@ -11,51 +11,147 @@
 #include <fstream>
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <sys/mman.h>
 
-int **makeMatrix(size_t maxNodes) {
-    size_t dimension = maxNodes * 2;
-    int **M = new int*[dimension];
-    int k = (int)(MathUtil::flog2(dimension)) + 1;
-    for (size_t i = 0; i < dimension; ++i) {
-        M[i] = new int[k]();
-    }
-    return M;
-}
-
-void deleteMatrix(int** M, size_t maxNodes) {
-    for (size_t i = 0; i < (maxNodes * 2); ++i) {
-        delete[] M[i];
-    }
-    delete[] M;
-}
+static const char TAXONOMY_MAGIC[8] = {'M', 'M', 'S', 'T', 'A', 'X', '0', '1'};
 
 NcbiTaxonomy::NcbiTaxonomy(const std::string &namesFile,  const std::string &nodesFile,
-                           const std::string &mergedFile, const std::string &delnodesFile) {
-    maxNodes = FileUtil::countLines(nodesFile.c_str());
-
+                           const std::string &mergedFile, const std::string &delnodesFile)
+        : mmapData(NULL), mmapSize(0) {
     InitLevels();
 
+    // offset 0 is the empty string
+    blockBuffer.push_back('\0');
+
     loadNodes(nodesFile);
     loadNames(namesFile);
+    loadMerged(mergedFile);
+    loadDelnodes(delnodesFile);
+    InitRangeMinimumQuery();
 
-    E.reserve(maxNodes * 2);
-    L.reserve(maxNodes * 2);
-    H = new int[maxNodes];
-    std::fill(H, H + (maxNodes), 0);
-    elh(1, 0);
-    E.resize(maxNodes * 2, 0);
-    L.resize(maxNodes * 2, 0);
+    taxonNodes = nodesBuffer.data();
+    maxNodes = nodesBuffer.size();
+    D = taxonToId.data();
+    maxTaxID = taxonToId.size() - 1;
+    E = tourBuffer.data();
+    L = levelBuffer.data();
+    H = firstBuffer.data();
+    tourSize = tourBuffer.size();
+    M = sparseTableBuffer.data();
+    block = &blockBuffer[0];
+    blockSize = blockBuffer.size();
+}
 
-    M = makeMatrix(maxNodes);
-    InitRangeMinimumQuery();
+template <typename T>
+static T* mapTable(char **data, size_t count) {
+    T *table = reinterpret_cast<T *>(*data);
+    // every table starts 8 byte aligned
+    *data += ((count * sizeof(T)) + 7) & ~static_cast<size_t>(7);
+    return table;
+}
 
-    loadMerged(mergedFile);
-    loadDelnodes(delnodesFile);
+NcbiTaxonomy::NcbiTaxonomy(char *data, size_t dataSize) : mmapData(data), mmapSize(dataSize) {
+    InitLevels();
+
+    char *p = data + sizeof(TAXONOMY_MAGIC);
+    size_t *header = reinterpret_cast<size_t *>(p);
+    maxNodes = header[0];
+    maxTaxID = header[1];
+    tourSize = header[2];
+    rmqLevels = header[3];
+    blockSize = header[4];
+    p += 5 * sizeof(size_t);
+
+    taxonNodes = mapTable<TaxonNode>(&p, maxNodes);
+    D = mapTable<int>(&p, maxTaxID + 1);
+    E = mapTable<int>(&p, tourSize);
+    L = mapTable<int>(&p, tourSize);
+    H = mapTable<int>(&p, maxNodes);
+    M = mapTable<int>(&p, rmqLevels * tourSize);
+    block = mapTable<char>(&p, blockSize);
+
+    if (static_cast<size_t>(p - data) > dataSize) {
+        Debug(Debug::ERROR) << "Taxonomy file is truncated!\n";
+        EXIT(EXIT_FAILURE);
+    }
 }
 
 NcbiTaxonomy::~NcbiTaxonomy() {
-    delete[] H;
-    deleteMatrix(M, maxNodes);
+    if (mmapData != NULL) {
+        munmap(mmapData, mmapSize);
+    }
+}
+
+NcbiTaxonomy* NcbiTaxonomy::openTaxonomy(const std::string &database) {
+    if (FileUtil::directoryExists(database.c_str()) == false && FileUtil::fileExists(database.c_str())) {
+        FILE *file = FileUtil::openFileOrDie(database.c_str(), "r", true);
+        size_t dataSize;
+        char *data = (char *) FileUtil::mmapFile(file, &dataSize);
+        fclose(file);
+        if (dataSize < sizeof(TAXONOMY_MAGIC) + 5 * sizeof(size_t)
+            || memcmp(data, TAXONOMY_MAGIC, sizeof(TAXONOMY_MAGIC)) != 0) {
+            Debug(Debug::ERROR) << database << " is not a taxonomy database created by createtaxdb!\n";
+            EXIT(EXIT_FAILURE);
+        }
+        return new NcbiTaxonomy(data, dataSize);
+    }
+
+    std::string nodesFile = database + "/nodes.dmp";
+    std::string namesFile = database + "/names.dmp";
+    std::string mergedFile = database + "/merged.dmp";
+    std::string delnodesFile = database + "/delnodes.dmp";
+    if (FileUtil::fileExists(nodesFile.c_str())
+        && FileUtil::fileExists(namesFile.c_str())
+           && FileUtil::fileExists(mergedFile.c_str())
+              && FileUtil::fileExists(delnodesFile.c_str())) {
+    } else if (FileUtil::fileExists("nodes.dmp")
+               && FileUtil::fileExists("names.dmp")
+                  && FileUtil::fileExists("merged.dmp")
+                     && FileUtil::fileExists("delnodes.dmp")) {
+        nodesFile = "nodes.dmp";
+        namesFile = "names.dmp";
+        mergedFile = "merged.dmp";
+        delnodesFile = "delnodes.dmp";
+    } else {
+        Debug(Debug::ERROR) << "names.dmp, nodes.dmp, merged.dmp or delnodes.dmp from NCBI taxdump could not be found!\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    return new NcbiTaxonomy(namesFile, nodesFile, mergedFile, delnodesFile);
+}
+
+template <typename T>
+static void writeTable(FILE *file, const T *table, size_t count) {
+    const size_t size = count * sizeof(T);
+    if (size > 0 && fwrite(table, 1, size, file) != size) {
+        Debug(Debug::ERROR) << "Could not write taxonomy table!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const char padding[8] = {0};
+    const size_t paddingSize = ((size + 7) & ~static_cast<size_t>(7)) - size;
+    if (paddingSize > 0 && fwrite(padding, 1, paddingSize, file) != paddingSize) {
+        Debug(Debug::ERROR) << "Could not write taxonomy table!\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+void NcbiTaxonomy::writeTaxonomy(const std::string &fileName) const {
+    FILE *file = FileUtil::openFileOrDie(fileName.c_str(), "wb", false);
+    writeTable(file, TAXONOMY_MAGIC, sizeof(TAXONOMY_MAGIC));
+    const size_t header[5] = {maxNodes, maxTaxID, tourSize, rmqLevels, blockSize};
+    writeTable(file, header, 5);
+    writeTable(file, taxonNodes, maxNodes);
+    writeTable(file, D, maxTaxID + 1);
+    writeTable(file, E, tourSize);
+    writeTable(file, L, tourSize);
+    writeTable(file, H, maxNodes);
+    writeTable(file, M, rmqLevels * tourSize);
+    writeTable(file, block, blockSize);
+    if (fclose(file) != 0) {
+        Debug(Debug::ERROR) << "Could not close " << fileName << "!\n";
+        EXIT(EXIT_FAILURE);
+    }
 }
 
 void NcbiTaxonomy::InitLevels() {
@@ -104,6 +200,13 @@ std::vector<std::string> splitByDelimiter(const std::string &s, const std::strin
     return result;
 }
 
+size_t NcbiTaxonomy::addString(const std::string &str) {
+    size_t idx = blockBuffer.size();
+    blockBuffer.append(str);
+    blockBuffer.push_back('\0');
+    return idx;
+}
+
 void NcbiTaxonomy::loadNodes(const std::string &nodesFile) {
     std::ifstream ss(nodesFile);
     if (ss.fail()) {
@@ -111,6 +214,11 @@ void NcbiTaxonomy::loadNodes(const std::string &nodesFile) {
         EXIT(EXIT_FAILURE);
     }
 
+    // nodes in file order, the dense ids are assigned in DFS preorder below
+    std::vector<int> taxa;
+    std::vector<int> parents;
+    std::vector<size_t> ranks;
+    size_t maxTaxon = 1;
     std::string line;
     while (std::getline(ss, line)) {
         std::vector<std::string> result = splitByDelimiter(line, "\t|\t", 3);
@@ -122,71 +230,84 @@ void NcbiTaxonomy::loadNodes(const std::string &nodesFile) {
             continue;
         }
 
-        std::map<int, TaxonNode>::iterator it = taxonTree.find(currentId);
-        if (it != taxonTree.end()) {
-            (*it).second.parentTaxon = parentId;
-            (*it).second.rank = result[2];
-        } else {
-            taxonTree.emplace(currentId, TaxonNode(currentId, parentId, result[2]));
+        std::map<std::string, size_t>::iterator it = internedRanks.find(result[2]);
+        if (it == internedRanks.end()) {
+            it = internedRanks.emplace(result[2], addString(result[2])).first;
         }
-
-        it = taxonTree.find(parentId);
-        if (it != taxonTree.end()) {
-            (*it).second.children.emplace_back(currentId);
-        } else {
-            TaxonNode node(parentId, 0, "");
-            node.children.emplace_back(currentId);
-            taxonTree.emplace(parentId, node);
+        taxa.emplace_back(currentId);
+        parents.emplace_back(parentId);
+        ranks.emplace_back(it->second);
+        maxTaxon = std::max(maxTaxon, (size_t) std::max(currentId, parentId));
+    }
+
+    // parents without an own entry (e.g. the root) have no rank
+    std::vector<int> entry(maxTaxon + 1, -1);
+    for (size_t i = 0; i < taxa.size(); ++i) {
+        entry[taxa[i]] = i;
+    }
+    for (size_t i = 0, size = taxa.size(); i < size; ++i) {
+        if (entry[parents[i]] == -1) {
+            entry[parents[i]] = taxa.size();
+            taxa.emplace_back(parents[i]);
+            parents.emplace_back(0);
+            ranks.emplace_back(0);
         }
     }
-
-//    for (std::map<int, TaxonNode>::iterator it = taxonTree.begin(); it != taxonTree.end(); ++it) {
-//        TaxonNode& node = (*it).second;
-//        assert(node.taxon > 0);
-//        assert(node.parentTaxon > 0 || node.taxon == 1);
-//    }
-
-    int index = 1;
-    updateIndices(1,  &index);
-    restoreRelations();
-}
-
-void NcbiTaxonomy::updateIndices(int node, int *index) {
-    std::map<int, TaxonNode>::iterator it = taxonTree.find(node);
-    if (it == taxonTree.end()) {
+    if (entry[1] == -1) {
         Debug(Debug::ERROR) << "Missing node!\n";
         EXIT(EXIT_FAILURE);
     }
 
-    int newIndex = (*index)++;
-    it->second.id = newIndex;
-
-    std::map<int, int>::iterator it2 = D.find(node);
-    if (it2 == D.end()) {
-        D.emplace(node, newIndex);
+    // children in file order as offsets into a flat array
+    std::vector<size_t> childOffset(taxa.size() + 1, 0);
+    for (size_t i = 0; i < taxa.size(); ++i) {
+        if (parents[i] != 0) {
+            childOffset[entry[parents[i]] + 1]++;
+        }
     }
-
-    for (std::vector<int>::iterator jt = it->second.children.begin();
-         jt != it->second.children.end(); ++jt) {
-        updateIndices(*jt, index);
+    for (size_t i = 0; i < taxa.size(); ++i) {
+        childOffset[i + 1] += childOffset[i];
     }
-}
-
-void NcbiTaxonomy::restoreRelations() {
-    std::map<int, TaxonNode> helperTree;
-
-    for (std::map<int, TaxonNode>::iterator it = taxonTree.begin(); it != taxonTree.end(); ++it) {
-        TaxonNode node = it->second;
-        node.parentTaxon = D[node.parentTaxon];
-        for (size_t i = 0; i < node.children.size(); ++i) {
-            node.children[i] = D[node.children[i]];
+    std::vector<int> children(childOffset[taxa.size()]);
+    std::vector<size_t> fill(childOffset.begin(), childOffset.end() - 1);
+    for (size_t i = 0; i < taxa.size(); ++i) {
+        if (parents[i] != 0) {
+            children[fill[entry[parents[i]]]++] = i;
         }
-
-        helperTree.emplace(node.id, node);
     }
 
-    taxonTree.clear();
-    taxonTree = helperTree;
+    // iterative DFS from the root assigns the dense ids and records the Euler tour
+    taxonToId.assign(maxTaxon + 1, 0);
+    nodesBuffer.reserve(taxa.size());
+    firstBuffer.reserve(taxa.size());
+    tourBuffer.reserve(taxa.size() * 2);
+    levelBuffer.reserve(taxa.size() * 2);
+    std::vector<std::pair<int, size_t> > stack;
+    stack.emplace_back(entry[1], childOffset[entry[1]]);
+    while (stack.empty() == false) {
+        const int node = stack.back().first;
+        size_t &nextChild = stack.back().second;
+        const int level = stack.size() - 1;
+        if (nextChild == childOffset[node]) {
+            TaxonNode taxonNode;
+            taxonNode.id = nodesBuffer.size() + 1;
+            taxonNode.taxon = taxa[node];
+            taxonNode.parentTaxon = (parents[node] == 0) ? 0 : taxonToId[parents[node]];
+            taxonNode.rankIdx = ranks[node];
+            taxonNode.nameIdx = 0;
+            nodesBuffer.emplace_back(taxonNode);
+            taxonToId[taxa[node]] = taxonNode.id;
+            firstBuffer.emplace_back(tourBuffer.size());
+        }
+        tourBuffer.emplace_back(taxonToId[taxa[node]]);
+        levelBuffer.emplace_back(level);
+        if (nextChild < childOffset[node + 1]) {
+            const int child = children[nextChild++];
+            stack.emplace_back(child, childOffset[child]);
+        } else {
+            stack.pop_back();
+        }
+    }
 }
 
 std::pair<int, std::string> parseName(const std::string &line) {
@@ -212,78 +333,53 @@ void NcbiTaxonomy::loadNames(const std::string &namesFile) {
         }
 
         std::pair<int, std::string> entry = parseName(line);
-
-        std::map<int, int>::iterator it1 = D.find(entry.first);
-        if (it1 == D.end()) {
-            Debug(Debug::ERROR) << "Invalid node!\n";
-            EXIT(EXIT_FAILURE);
-        }
-
-        std::map<int, TaxonNode>::iterator it2 = taxonTree.find(it1->second);
-        if (it2 == taxonTree.end()) {
+        if (entry.first < 0 || static_cast<size_t>(entry.first) >= taxonToId.size() || taxonToId[entry.first] <= 0) {
             Debug(Debug::ERROR) << "Invalid node!\n";
             EXIT(EXIT_FAILURE);
         }
 
-        assert(it1->first == entry.first);
-
-        it2->second.name = entry.second;
+        nodesBuffer[taxonToId[entry.first] - 1].nameIdx = addString(entry.second);
     }
 }
 
-void NcbiTaxonomy::elh(int node, int level) {
-    std::map<int, TaxonNode>::iterator it = taxonTree.find(node);
-    if (it == taxonTree.end()) {
-        Debug(Debug::ERROR) << "Invalid node!\n";
-        EXIT(EXIT_FAILURE);
-    }
-
-    int id = it->first;
-
-    assert (id > 0);
-    E.emplace_back(id);
-    L.emplace_back(level);
-
-    if (H[id - 1] == 0) {
-        H[id - 1] = E.size();
-    }
-    for (std::vector<int>::iterator jt = it->second.children.begin(); jt != it->second.children.end(); ++jt) {
-        elh((*jt), level + 1);
-    }
-    E.emplace_back(it->second.parentTaxon);
-    L.emplace_back(level - 1);
-}
-
 void NcbiTaxonomy::InitRangeMinimumQuery() {
-    for (unsigned int i = 0; i < (maxNodes * 2); ++i) {
-        M[i][0] = i;
-    }
-
-    for (unsigned int j = 1; (1ul << j) <= (maxNodes * 2); ++j) {
-        for (unsigned int i = 0; (i + (1ul << j) - 1) < (maxNodes * 2); ++i) {
-            int A = M[i][j - 1];
-            int B = M[i + (1ul << (j - 1))][j - 1];
-            if (L[A] < L[B]) {
-                M[i][j] = A;
+    const size_t size = tourBuffer.size();
+    rmqLevels = 1;
+    while ((1ul << rmqLevels) <= size) {
+        rmqLevels++;
+    }
+    sparseTableBuffer.assign(rmqLevels * size, 0);
+    for (unsigned int i = 0; i < size; ++i) {
+        sparseTableBuffer[i] = i;
+    }
+
+    for (unsigned int j = 1; (1ul << j) <= size; ++j) {
+        int *prev = &sparseTableBuffer[(j - 1) * size];
+        int *curr = &sparseTableBuffer[j * size];
+        for (unsigned int i = 0; (i + (1ul << j) - 1) < size; ++i) {
+            int A = prev[i];
+            int B = prev[i + (1ul << (j - 1))];
+            if (levelBuffer[A] < levelBuffer[B]) {
+                curr[i] = A;
             } else {
-                M[i][j] = B;
+                curr[i] = B;
             }
         }
     }
 }
 
-int NcbiTaxonomy::RangeMinimumQuery(int i, int j) {
+int NcbiTaxonomy::RangeMinimumQuery(int i, int j) const {
     assert(j >= i);
-    int k = (int)MathUtil::flog2(j - i + 1);
-    int A = M[i][k];
-    int B = M[j - MathUtil::ipow<int>(2, k) + 1][k];
+    int k = 31 - __builtin_clz(j - i + 1);
+    int A = M[k * tourSize + i];
+    int B = M[k * tourSize + j - (1 << k) + 1];
     if (L[A] <= L[B]) {
         return A;
     }
     return B;
 }
 
-int NcbiTaxonomy::lcaHelper(int i, int j) {
+int NcbiTaxonomy::lcaHelper(int i, int j) const {
     assert(i > 0);
     assert(j > 0);
     if (i == j) {
@@ -300,79 +396,113 @@ int NcbiTaxonomy::lcaHelper(int i, int j) {
     return E[rmq];
 }
 
-bool NcbiTaxonomy::IsAncestor(int ancestor, int child) {
-    std::map<int, int>::iterator jt = D.find(ancestor);
-    if (jt == D.end()) {
-        Debug(Debug::ERROR) << "Invalid taxon tree: Could not find node " << ancestor << "!\n";
+int NcbiTaxonomy::nodeId(int taxon) const {
+    if (taxon < 0 || static_cast<size_t>(taxon) > maxTaxID || D[taxon] == 0) {
+        Debug(Debug::ERROR) << "Invalid taxon tree: Could not find node " << taxon << "!\n";
         EXIT(EXIT_FAILURE);
-    } else {
-        int value = jt->second;
+    }
+    return D[taxon];
+}
+
+bool NcbiTaxonomy::IsAncestor(int ancestor, int child) const {
+    ancestor = nodeId(ancestor);
+    // -1 nodes was deleted (in delnodes)
+    if (ancestor == -1) {
+        return false;
+    }
+
+    child = nodeId(child);
+    if (child == -1) {
+        return false;
+    }
+
+    return lcaHelper(child, ancestor) == ancestor;
+}
+
+const TaxonNode* NcbiTaxonomy::LCA(const std::vector<int>& taxa) const {
+    return LCA(taxa.data(), taxa.size());
+}
+
+const TaxonNode* NcbiTaxonomy::LCA(const int *taxa, size_t n) const {
+    int red = -1;
+    for (size_t i = 0; i < n; ++i) {
+        int value = nodeId(taxa[i]);
         // -1 nodes was deleted (in delnodes)
         if (value == -1) {
-            return false;
+            continue;
         }
-        ancestor = value;
+        red = (red == -1) ? value : lcaHelper(red, value);
     }
 
-    jt = D.find(child);
-    if (jt == D.end()) {
-        Debug(Debug::ERROR) << "Invalid taxon tree: Could not find node " << ancestor << "!\n";
-        EXIT(EXIT_FAILURE);
-    } else {
-        int value = jt->second;
-        if (value == -1) {
-            return false;
-        }
-        child = value;
+    if (red == -1) {
+        return NULL;
     }
 
-    return lcaHelper(child, ancestor) == ancestor;
+    return &taxonNodes[red - 1];
 }
 
-TaxonNode* NcbiTaxonomy::LCA(const std::vector<int>& taxa) {
-    std::vector<int> indices;
-    for (std::vector<int>::const_iterator it = taxa.begin(); it != taxa.end(); ++it) {
-        std::map<int, int>::iterator jt = D.find(*it);
-        if (jt == D.end()) {
-            Debug(Debug::ERROR) << "Invalid taxon tree: Could not find node " << (*it) << "!\n";
-            EXIT(EXIT_FAILURE);
-        } else {
-            int value = jt->second;
-            // -1 nodes was deleted (in delnodes)
-            if (value == -1) {
-                continue;
-            }
-            indices.emplace_back(value);
-        }
+LcaCache::LcaCache(const NcbiTaxonomy &taxonomy) : hits(0), lookups(0), taxonomy(taxonomy) {
+    entries = new Entry[CACHE_SIZE];
+    for (size_t i = 0; i < CACHE_SIZE; ++i) {
+        entries[i].count = 0;
+    }
+}
+
+LcaCache::~LcaCache() {
+    delete[] entries;
+}
+
+const TaxonNode* LcaCache::LCA(const int *taxa, size_t n) {
+    if (n > MAX_SET_SIZE) {
+        return taxonomy.LCA(taxa, n);
     }
 
-    if (indices.empty()) {
+    // the LCA does not depend on order and multiplicity, so the key is the sorted set
+    int key[MAX_SET_SIZE];
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        size_t pos = count;
+        while (pos > 0 && key[pos - 1] > taxa[i]) {
+            pos--;
+        }
+        if (pos > 0 && key[pos - 1] == taxa[i]) {
+            continue;
+        }
+        for (size_t j = count; j > pos; --j) {
+            key[j] = key[j - 1];
+        }
+        key[pos] = taxa[i];
+        count++;
+    }
+    if (count == 0) {
         return NULL;
     }
 
-    std::vector<int>::iterator it = indices.begin();
-    int red = (*it);
-    std::advance(it, 1);
-    for (; it != indices.end(); ++it) {
-        red = lcaHelper(red, *it);
+    size_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < count; ++i) {
+        hash = (hash ^ static_cast<unsigned int>(key[i])) * 1099511628211ULL;
     }
+    Entry &entry = entries[(hash ^ (hash >> 32)) & (CACHE_SIZE - 1)];
 
-    std::map<int, TaxonNode>::iterator it2 = taxonTree.find(red);
-    if (it2 == taxonTree.end()) {
-        Debug(Debug::ERROR) << "Invalid taxon tree: Could not find mapping "  << red << "!\n";
-        EXIT(EXIT_FAILURE);
+    lookups++;
+    if (entry.count == count && memcmp(entry.taxa, key, count * sizeof(int)) == 0) {
+        hits++;
+        return entry.node;
     }
 
-    return &(it2->second);
+    entry.node = taxonomy.LCA(key, count);
+    entry.count = count;
+    memcpy(entry.taxa, key, count * sizeof(int));
+    return entry.node;
 }
 
-
 // AtRanks returns a slice of slices having the taxons at the specified taxonomic levels
-std::vector<std::string> NcbiTaxonomy::AtRanks(TaxonNode *node, const std::vector<std::string> &levels) {
+std::vector<std::string> NcbiTaxonomy::AtRanks(const TaxonNode *node, const std::vector<std::string> &levels) const {
     std::vector<std::string> result;
     std::map<std::string, std::string> allRanks = AllRanks(node);
-    int baseRankIndex = sortedLevels[node->rank];
-    std::string baseRank = "uc_" + node->name;
+    std::map<std::string, int>::const_iterator lt = sortedLevels.find(getString(node->rankIdx));
+    int baseRankIndex = (lt != sortedLevels.end()) ? lt->second : 0;
+    std::string baseRank = "uc_" + std::string(getString(node->nameIdx));
     for (std::vector<std::string>::const_iterator it = levels.begin(); it != levels.end(); ++it) {
         std::map<std::string, std::string>::iterator jt = allRanks.find(*it);
         if (jt != allRanks.end()) {
@@ -381,7 +511,8 @@ std::vector<std::string> NcbiTaxonomy::AtRanks(TaxonNode *node, const std::vecto
         }
 
         // If not ... 2 possible causes: i) too low level ("uc_")
-        if (sortedLevels[*it] < baseRankIndex) {
+        lt = sortedLevels.find(*it);
+        if (((lt != sortedLevels.end()) ? lt->second : 0) < baseRankIndex) {
             result.emplace_back(baseRank);
             continue;
         }
@@ -392,26 +523,63 @@ std::vector<std::string> NcbiTaxonomy::AtRanks(TaxonNode *node, const std::vecto
     return result;
 }
 
-TaxonNode* NcbiTaxonomy::Parent(int parentTaxon) {
-    std::map<int, TaxonNode>::iterator it = taxonTree.find(parentTaxon);
-    if (it == taxonTree.end()) {
+void NcbiTaxonomy::appendAtRanks(const TaxonNode *node, const std::vector<std::string> &levels, std::string &result) const {
+    std::map<std::string, int>::const_iterator lt = sortedLevels.find(getString(node->rankIdx));
+    const int baseRankIndex = (lt != sortedLevels.end()) ? lt->second : 0;
+    for (size_t i = 0; i < levels.size(); ++i) {
+        if (i > 0) {
+            result.push_back(':');
+        }
+
+        // lowest ancestor with this rank, same as the first entry of AllRanks
+        const char *name = NULL;
+        const TaxonNode *curr = node;
+        while (true) {
+            const char *rank = getString(curr->rankIdx);
+            if ((curr->taxon == 1 || strcmp(rank, "no_rank") != 0) && levels[i] == rank) {
+                name = getString(curr->nameIdx);
+                break;
+            }
+            if (curr->taxon == 1) {
+                break;
+            }
+            curr = Parent(curr->parentTaxon);
+        }
+        if (name != NULL) {
+            result.append(name);
+            continue;
+        }
+
+        lt = sortedLevels.find(levels[i]);
+        if (((lt != sortedLevels.end()) ? lt->second : 0) < baseRankIndex) {
+            result.append("uc_");
+            result.append(getString(node->nameIdx));
+            continue;
+        }
+
+        result.append("unknown");
+    }
+}
+
+const TaxonNode* NcbiTaxonomy::Parent(int parentTaxon) const {
+    if (parentTaxon <= 0 || static_cast<size_t>(parentTaxon) > maxNodes) {
         Debug(Debug::ERROR) << "Invalid Node!\n";
         EXIT(EXIT_FAILURE);
     }
 
-    return &(it->second);
+    return &taxonNodes[parentTaxon - 1];
 }
 
-std::map<std::string, std::string> NcbiTaxonomy::AllRanks(TaxonNode *node) {
+std::map<std::string, std::string> NcbiTaxonomy::AllRanks(const TaxonNode *node) const {
     std::map<std::string, std::string> result;
     while (true) {
         if (node->taxon == 1) {
-            result.emplace(node->rank, node->name);
+            result.emplace(getString(node->rankIdx), getString(node->nameIdx));
             return result;
         }
 
-        if (node->rank != "no_rank") {
-            result.emplace(node->rank, node->name);
+        if (strcmp(getString(node->rankIdx), "no_rank") != 0) {
+            result.emplace(getString(node->rankIdx), getString(node->nameIdx));
         }
 
         node = Parent(node->parentTaxon);
@@ -435,13 +603,17 @@ void NcbiTaxonomy::loadMerged(const std::string &mergedFile) {
 
         unsigned int oldId = (unsigned int)strtoul(result[0].c_str(), NULL, 10);
         unsigned int mergedId = (unsigned int)strtoul(result[1].c_str(), NULL, 10);
-        std::map<int, int>::iterator it = D.find(mergedId);
-        if (it == D.end()) {
+        if (mergedId >= taxonToId.size() || taxonToId[mergedId] == 0) {
             Debug(Debug::ERROR) << "Invalid taxon tree: Could not map node " << mergedId << "!\n";
             EXIT(EXIT_FAILURE);
         }
 
-        D.emplace(oldId, D[mergedId]);
+        if (oldId >= taxonToId.size()) {
+            taxonToId.resize(oldId + 1, 0);
+        }
+        if (taxonToId[oldId] == 0) {
+            taxonToId[oldId] = taxonToId[mergedId];
+        }
     }
 }
 
@@ -455,6 +627,11 @@ void NcbiTaxonomy::loadDelnodes(const std::string &delnodesFile) {
     std::string line;
     while (std::getline(ss, line)) {
         unsigned int oldId = (unsigned int)strtoul(line.c_str(), NULL, 10);
-        D.emplace(oldId, -1);
+        if (oldId >= taxonToId.size()) {
+            taxonToId.resize(oldId + 1, 0);
+        }
+        if (taxonToId[oldId] == 0) {
+            taxonToId[oldId] = -1;
+        }
     }
 }
@@ -8,54 +8,124 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <cstddef>
 
+// Flat node of the taxonomy tree, rank and name are offsets into the string block of NcbiTaxonomy
 struct TaxonNode {
+    // dense index of the node (1-based, DFS preorder)
     int id;
+    // NCBI taxon id
     int taxon;
+    // dense index of the parent node, 0 for the root
     int parentTaxon;
-    std::string rank;
-    std::string name;
-    std::vector<int> children;
-
-    TaxonNode(int taxon, int parentTaxon, const std::string& rank)
-            : id(taxon), taxon(taxon), parentTaxon(parentTaxon), rank(rank), name("") {};
+    size_t rankIdx;
+    size_t nameIdx;
 };
 
+// All tables are flat arrays so that the taxonomy can be written once with writeTaxonomy
+// and mapped with openTaxonomy instead of parsing the NCBI dump files in every run.
 class NcbiTaxonomy {
 public:
     NcbiTaxonomy(const std::string &namesFile,  const std::string &nodesFile,
                  const std::string &mergedFile, const std::string &delnodesFile);
     ~NcbiTaxonomy();
 
-    TaxonNode* LCA(const std::vector<int>& taxa);
-    std::vector<std::string> AtRanks(TaxonNode *node, const std::vector<std::string> &levels);
-    std::map<std::string, std::string> AllRanks(TaxonNode *node);
-    bool IsAncestor(int ancestor, int child);
+    // Opens a binary taxonomy written by createtaxdb or parses a NCBI taxdump directory
+    static NcbiTaxonomy* openTaxonomy(const std::string &database);
+    void writeTaxonomy(const std::string &fileName) const;
+
+    const TaxonNode* LCA(const std::vector<int>& taxa) const;
+    // LCA of n taxa without allocations, deleted taxa are skipped. Returns NULL if no taxon remains
+    const TaxonNode* LCA(const int *taxa, size_t n) const;
+    std::vector<std::string> AtRanks(const TaxonNode *node, const std::vector<std::string> &levels) const;
+    // Same as AtRanks but appends the ':' separated names to result without allocating
+    void appendAtRanks(const TaxonNode *node, const std::vector<std::string> &levels, std::string &result) const;
+    std::map<std::string, std::string> AllRanks(const TaxonNode *node) const;
+    bool IsAncestor(int ancestor, int child) const;
+
+    const char* getString(size_t blockIdx) const {
+        return block + blockIdx;
+    }
+
+    size_t nodeCount() const {
+        return maxNodes;
+    }
 
 private:
+    NcbiTaxonomy(char *data, size_t dataSize);
+
     void InitLevels();
     void loadNodes(const std::string &nodesFile);
-    void updateIndices(int node, int *index);
-    void restoreRelations();
     void loadNames(const std::string &namesFile);
-    void elh(int node, int level);
     void InitRangeMinimumQuery();
     void loadMerged(const std::string &mergedFile);
     void loadDelnodes(const std::string &delnodesFile);
 
-    int RangeMinimumQuery(int i, int j);
-    int lcaHelper(int i, int j);
-    TaxonNode* Parent(int parentTaxon);
+    size_t addString(const std::string &str);
+    int nodeId(int taxon) const;
+    int RangeMinimumQuery(int i, int j) const;
+    int lcaHelper(int i, int j) const;
+    const TaxonNode* Parent(int parentTaxon) const;
 
-    std::map<int, TaxonNode> taxonTree;
-    std::map<int, int> D;
-    std::vector<int> E;
-    std::vector<int> L;
-    int* H;
-    int **M;
+    // nodes indexed by id - 1
+    TaxonNode *taxonNodes;
     size_t maxNodes;
+    // taxon id -> node id, 0 if unknown, -1 if deleted (in delnodes)
+    int *D;
+    size_t maxTaxID;
+    // Euler tour of the tree, level of each tour entry and first occurrence of each node
+    int *E;
+    int *L;
+    int *H;
+    size_t tourSize;
+    // sparse table over L, level j of the table starts at M + j * tourSize
+    int *M;
+    size_t rmqLevels;
+    // zero terminated names and interned ranks
+    char *block;
+    size_t blockSize;
+
+    // set if the tables point into a mapped taxonomy file
+    char *mmapData;
+    size_t mmapSize;
+
+    // temporary storage while building from the dump files
+    std::vector<TaxonNode> nodesBuffer;
+    std::vector<int> taxonToId;
+    std::vector<int> tourBuffer;
+    std::vector<int> levelBuffer;
+    std::vector<int> firstBuffer;
+    std::vector<int> sparseTableBuffer;
+    std::string blockBuffer;
+    std::map<std::string, size_t> internedRanks;
 
     std::map<std::string, int> sortedLevels;
 };
 
+// Direct mapped cache of LCA results for small taxon sets, every thread should own one.
+// Most reads of a metagenomic sample hit the same few taxon combinations.
+class LcaCache {
+public:
+    LcaCache(const NcbiTaxonomy &taxonomy);
+    ~LcaCache();
+
+    const TaxonNode* LCA(const int *taxa, size_t n);
+
+    size_t hits;
+    size_t lookups;
+
+private:
+    static const size_t CACHE_SIZE = 4096;
+    static const size_t MAX_SET_SIZE = 8;
+
+    struct Entry {
+        unsigned int count;
+        int taxa[MAX_SET_SIZE];
+        const TaxonNode *node;
+    };
+
+    const NcbiTaxonomy &taxonomy;
+    Entry *entries;
+};
+
 #endif
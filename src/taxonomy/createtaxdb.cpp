@@ -0,0 +1,18 @@
+#include "NcbiTaxonomy.h"
+#include "Parameters.h"
+#include "Debug.h"
+#include "Util.h"
+
+int createtaxdb(int argc, const char **argv, const Command& command) {
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, 2);
+
+    Debug(Debug::INFO) << "Loading NCBI taxonomy...\n";
+    NcbiTaxonomy* t = NcbiTaxonomy::openTaxonomy(par.db1);
+
+    Debug(Debug::INFO) << "Writing " << t->nodeCount() << " taxa to " << par.db2 << "\n";
+    t->writeTaxonomy(par.db2);
+    delete t;
+
+    return EXIT_SUCCESS;
+}
@@ -4,6 +4,7 @@
 #include "FileUtil.h"
 #include "Debug.h"
 #include "Util.h"
+#include "itoa.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -20,26 +21,6 @@ int lca(int argc, const char **argv, const Command& command) {
     DBReader<unsigned int> reader(par.db1.c_str(), par.db1Index.c_str());
     reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
 
-    std::string nodesFile = par.db2 + "/nodes.dmp";
-    std::string namesFile = par.db2 + "/names.dmp";
-    std::string mergedFile = par.db2 + "/merged.dmp";
-    std::string delnodesFile = par.db2 + "/delnodes.dmp";
-    if (FileUtil::fileExists(nodesFile.c_str())
-        && FileUtil::fileExists(namesFile.c_str())
-           && FileUtil::fileExists(mergedFile.c_str())
-              && FileUtil::fileExists(delnodesFile.c_str())) {
-    } else if (FileUtil::fileExists("nodes.dmp")
-               && FileUtil::fileExists("names.dmp")
-		  && FileUtil::fileExists("merged.dmp")
-                     && FileUtil::fileExists("delnodes.dmp")) {
-        nodesFile = "nodes.dmp";
-        namesFile = "names.dmp";
-        mergedFile = "merged.dmp";
-        delnodesFile = "delnodes.dmp";
-    } else {
-        Debug(Debug::ERROR) << "names.dmp, nodes.dmp, merged.dmp or delnodes.dmp from NCBI taxdump could not be found!\n";
-    }
-
     DBWriter writer(par.db3.c_str(), par.db3Index.c_str(), par.threads);
     writer.open();
 
@@ -51,23 +32,31 @@ int lca(int argc, const char **argv, const Command& command) {
     const size_t taxaBlacklistSize = blacklist.size();
     int* taxaBlacklist = new int[taxaBlacklistSize];
     for (size_t i = 0; i < taxaBlacklistSize; ++i) {
-        taxaBlacklist[i] = (int)strtol(blacklist[i].c_str(), NULL, 100);
+        taxaBlacklist[i] = (int)strtol(blacklist[i].c_str(), NULL, 10);
     }
 
     Debug(Debug::INFO) << "Loading NCBI taxonomy...\n";
-    NcbiTaxonomy t(namesFile, nodesFile, mergedFile, delnodesFile);
+    NcbiTaxonomy* t = NcbiTaxonomy::openTaxonomy(par.db2);
 
     Debug(Debug::INFO) << "Computing LCA...\n";
     size_t entries = reader.getSize();
-    #pragma omp parallel
+    size_t cacheHits = 0;
+    size_t cacheLookups = 0;
+    #pragma omp parallel reduction(+:cacheHits, cacheLookups)
     {
         char *entry[255];
-        char buffer[1024];
+        char buffer[32];
         unsigned int thread_idx = 0;
 #ifdef OPENMP
         thread_idx = (unsigned int) omp_get_thread_num();
 #endif
 
+        // per thread buffers are reused, so the loop does not allocate once they have grown
+        LcaCache cache(*t);
+        std::vector<int> taxa;
+        std::string result;
+        result.reserve(1024);
+
         #pragma omp for schedule(dynamic, 10)
         for (size_t i = 0; i < entries; ++i) {
             Debug::printProgress(i);
@@ -80,7 +69,7 @@ int lca(int argc, const char **argv, const Command& command) {
                 continue;
             }
 
-            std::vector<int> taxa;
+            taxa.clear();
             while (*data != '\0') {
                 int taxon;
                 const size_t columns = Util::getWordsOfLine(data, entry, 255);
@@ -93,7 +82,7 @@ int lca(int argc, const char **argv, const Command& command) {
 
                 // remove blacklisted taxa
                 for (size_t j = 0; j < taxaBlacklistSize; ++j) {
-                    if (t.IsAncestor(taxaBlacklist[j], taxon)) {
+                    if (t->IsAncestor(taxaBlacklist[j], taxon)) {
                         goto next;
                     }
                 }
@@ -104,30 +93,40 @@ int lca(int argc, const char **argv, const Command& command) {
                 data = Util::skipLine(data);
             }
 
-            TaxonNode* node = t.LCA(taxa);
+            const TaxonNode* node = cache.LCA(taxa.data(), taxa.size());
             if (node == NULL) {
                 continue;
             }
 
+            result.clear();
+            char *end = Itoa::i32toa_sse2(node->taxon, buffer);
+            result.append(buffer, end - buffer - 1);
+            result.push_back('\t');
+            result.append(t->getString(node->rankIdx));
+            result.push_back('\t');
+            result.append(t->getString(node->nameIdx));
             if (ranks.empty() == false) {
-                std::string lcaRanks = Util::implode(t.AtRanks(node, ranks), ':');
-                snprintf(buffer, 1024, "%d\t%s\t%s\t%s\n",
-                         node->taxon, node->rank.c_str(), node->name.c_str(), lcaRanks.c_str());
-                writer.writeData(buffer, strlen(buffer), key, thread_idx);
-            } else {
-                snprintf(buffer, 1024, "%d\t%s\t%s\n",
-                         node->taxon, node->rank.c_str(), node->name.c_str());
-                writer.writeData(buffer, strlen(buffer), key, thread_idx);
+                result.push_back('\t');
+                t->appendAtRanks(node, ranks, result);
             }
+            result.push_back('\n');
+            writer.writeData(result.c_str(), result.length(), key, thread_idx);
         }
+
+        cacheHits += cache.hits;
+        cacheLookups += cache.lookups;
     };
 
     Debug(Debug::INFO) << "\n";
+    if (cacheLookups > 0) {
+        Debug(Debug::INFO) << "LCA cache hit rate: " << static_cast<double>(cacheHits) / cacheLookups << "\n";
+    }
 
     writer.close();
     reader.close();
 
     delete[] taxaBlacklist;
+    delete t;
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,97 @@
+// Compares in-order k-mer lookups against the prefetched lookup window of QueryMatcher::match
+// on a random index table that is much larger than the caches.
+// The offset and list stages are timed separately to show where the memory stalls go.
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cstring>
+
+#include "IndexTable.h"
+#include "Timer.h"
+
+const char* binary_name = "test_indextablelookup";
+
+// sum of the list sizes, only touches the offsets
+static size_t lookupOffsets(IndexTable &table, const std::vector<unsigned int> &kmers, bool prefetch) {
+    size_t total = 0;
+    for (size_t i = 0; i < kmers.size(); i++) {
+        if (prefetch && i + IndexTable::PREFETCH_OFFSET_DISTANCE < kmers.size()) {
+            table.prefetchOffset(kmers[i + IndexTable::PREFETCH_OFFSET_DISTANCE]);
+        }
+        size_t listSize;
+        table.getDBSeqList(kmers[i], &listSize);
+        total += listSize;
+    }
+    return total;
+}
+
+// copies the lists as the matcher does
+static size_t lookupLists(IndexTable &table, const std::vector<unsigned int> &kmers, bool prefetch, IndexEntryLocal *hits) {
+    size_t total = 0;
+    for (size_t i = 0; i < kmers.size(); i++) {
+        if (prefetch && i + IndexTable::PREFETCH_OFFSET_DISTANCE < kmers.size()) {
+            table.prefetchOffset(kmers[i + IndexTable::PREFETCH_OFFSET_DISTANCE]);
+        }
+        if (prefetch && i + IndexTable::PREFETCH_LIST_DISTANCE < kmers.size()) {
+            table.prefetchDBSeqList(kmers[i + IndexTable::PREFETCH_LIST_DISTANCE]);
+        }
+        size_t listSize;
+        const IndexEntryLocal *entries = table.getDBSeqList(kmers[i], &listSize);
+        memcpy(hits, entries, sizeof(IndexEntryLocal) * listSize);
+        total += listSize;
+    }
+    return total;
+}
+
+int main (int, const char**) {
+    const int alphabetSize = 21;
+    const int kmerSize = 6;
+    const size_t tableEntries = 20000000;
+    const size_t lookups = 20000000;
+
+    IndexTable table(alphabetSize, kmerSize, false);
+    const size_t tableSize = table.getTableSize();
+    size_t *offsets = table.getOffsets();
+
+    std::mt19937 rnd(42);
+    std::uniform_int_distribution<unsigned int> kmer(0, tableSize - 1);
+    for (size_t i = 0; i < tableEntries; i++) {
+        offsets[kmer(rnd)]++;
+    }
+    table.initMemory(1);
+    table.init();
+    memset(table.getEntries(), 0, sizeof(IndexEntryLocal) * tableEntries);
+
+    std::vector<unsigned int> kmers(lookups);
+    size_t maxListSize = 0;
+    for (size_t i = 0; i < lookups; i++) {
+        kmers[i] = kmer(rnd);
+        maxListSize = std::max(maxListSize, offsets[kmers[i] + 1] - offsets[kmers[i]]);
+    }
+    std::vector<IndexEntryLocal> hits(maxListSize + 1);
+
+    std::cout << "Index table with " << tableSize << " k-mers and " << tableEntries << " entries, "
+              << lookups << " lookups\n";
+
+    size_t errors = 0;
+    const char *stages[2] = { "offsets", "lists  " };
+    for (size_t stage = 0; stage < 2; stage++) {
+        double times[2];
+        size_t totals[2];
+        for (size_t prefetch = 0; prefetch < 2; prefetch++) {
+            Timer timer;
+            if (stage == 0) {
+                totals[prefetch] = lookupOffsets(table, kmers, prefetch == 1);
+            } else {
+                totals[prefetch] = lookupLists(table, kmers, prefetch == 1, hits.data());
+            }
+            times[prefetch] = timer.elapsed();
+        }
+        errors += (totals[0] != totals[1]);
+        std::cout << stages[stage] << "\tin order " << times[0] * 1e9 / lookups << " ns/lookup"
+                  << "\tprefetched " << times[1] * 1e9 / lookups << " ns/lookup\n";
+    }
+
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,112 @@
+// Compares the linclust k-mer selection modes (lowest hash vs. windowed minimizers)
+// on pairs of random reduced alphabet sequences and their mutated copies.
+// Sensitivity is the fraction of pairs that share at least one selected k-mer.
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "Indexer.h"
+#include "Parameters.h"
+#include "Timer.h"
+#include "kmermatcher.h"
+
+const char* binary_name = "test_kmerselection";
+
+static size_t collectKmers(const std::vector<int> &seq, size_t kmerSize, size_t alphabetSize, int hashShift,
+                           SequencePosition *kmers) {
+    Indexer idxer(alphabetSize, kmerSize);
+    size_t kmerCount = 0;
+    for (size_t pos = 0; pos + kmerSize <= seq.size(); pos++) {
+        const int *kmer = &seq[pos];
+        kmers[kmerCount].score = circ_hash(kmer, kmerSize, hashShift);
+        kmers[kmerCount].kmer = idxer.int2index(kmer, 0, kmerSize);
+        kmers[kmerCount].pos = pos;
+        kmerCount++;
+    }
+    return kmerCount;
+}
+
+static size_t selectKmers(int mode, SequencePosition *kmers, size_t kmerCount, size_t windowSize, size_t chooseTopKmer,
+                          unsigned int *window) {
+    if (mode == Parameters::KMER_SELECT_MINIMIZER) {
+        return selectMinimizerKmers(kmers, kmerCount, windowSize, chooseTopKmer, window);
+    }
+    return selectTopHashKmers(kmers, kmerCount, chooseTopKmer);
+}
+
+int main (int, const char**) {
+    const size_t alphabetSize = 13;
+    const size_t kmerSize = 10;
+    const size_t seqLen = 300;
+    const size_t pairs = 20000;
+    const size_t chooseTopKmer = 20;
+    const int hashShift = 5;
+    const double mutationRates[] = {0.05, 0.10, 0.20};
+
+    std::mt19937 rnd(42);
+    std::uniform_int_distribution<int> residue(0, alphabetSize - 1);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+    SequencePosition *kmersA = new SequencePosition[seqLen + 1];
+    SequencePosition *kmersB = new SequencePosition[seqLen + 1];
+    unsigned int *window = new unsigned int[seqLen + 1];
+    const size_t windowSize = computeMinimizerWindowSize(seqLen - kmerSize + 1, chooseTopKmer);
+    std::cout << "Minimizer window size: " << windowSize << "\n";
+
+    for (size_t rate = 0; rate < sizeof(mutationRates) / sizeof(mutationRates[0]); rate++) {
+        std::vector<std::vector<int> > seqs;
+        for (size_t i = 0; i < pairs; i++) {
+            std::vector<int> seq(seqLen);
+            for (size_t pos = 0; pos < seqLen; pos++) {
+                seq[pos] = residue(rnd);
+            }
+            std::vector<int> mutated(seq);
+            for (size_t pos = 0; pos < seqLen; pos++) {
+                if (coin(rnd) < mutationRates[rate]) {
+                    mutated[pos] = residue(rnd);
+                }
+            }
+            seqs.push_back(seq);
+            seqs.push_back(mutated);
+        }
+
+        const int modes[] = {Parameters::KMER_SELECT_TOP_HASH, Parameters::KMER_SELECT_MINIMIZER};
+        for (size_t m = 0; m < 2; m++) {
+            const int mode = modes[m];
+            size_t found = 0;
+            size_t selectedTotal = 0;
+            Timer timer;
+            for (size_t i = 0; i < pairs; i++) {
+                size_t countA = collectKmers(seqs[2 * i], kmerSize, alphabetSize, hashShift, kmersA);
+                countA = selectKmers(mode, kmersA, countA, windowSize, chooseTopKmer, window);
+                size_t countB = collectKmers(seqs[2 * i + 1], kmerSize, alphabetSize, hashShift, kmersB);
+                countB = selectKmers(mode, kmersB, countB, windowSize, chooseTopKmer, window);
+                selectedTotal += countA + countB;
+                bool shared = false;
+                for (size_t a = 0; a < countA && shared == false; a++) {
+                    for (size_t b = 0; b < countB; b++) {
+                        if (kmersA[a].kmer == kmersB[b].kmer) {
+                            shared = true;
+                            break;
+                        }
+                    }
+                }
+                found += shared;
+            }
+            std::cout << "Mutation rate " << mutationRates[rate]
+                      << "\t" << (mode == Parameters::KMER_SELECT_MINIMIZER ? "minimizer" : "top hash ")
+                      << "\tsensitivity " << static_cast<double>(found) / pairs
+                      << "\tk-mers/seq " << static_cast<double>(selectedTotal) / (2 * pairs)
+                      << "\ttime " << timer.lap() << "\n";
+        }
+    }
+
+    delete[] window;
+    delete[] kmersB;
+    delete[] kmersA;
+    return 0;
+}
@@ -13,6 +13,7 @@
 #include "Sequence.h"
 #include "SubstitutionMatrix.h"
 #include "MultipleAlignment.h"
+#include "Timer.h"
 
 const char* binary_name = "test_pssm";
 
@@ -1610,6 +1611,20 @@ int main (int argc, const char * argv[])
     pssm.computePSSMFromMSA(filterSetSize, res.centerLength, (const char**) res.msaSequence, false);
     //pssm.printProfile(res.centerLength);
     pssm.printPSSM(res.centerLength);
+
+    // profile computation throughput with context specific and global sequence weights
+    const size_t repeats = 5000;
+    for (int wg = 0; wg < 2; wg++) {
+        Timer timer;
+        for (size_t i = 0; i < repeats; i++) {
+            pssm.computePSSMFromMSA(filterSetSize, res.centerLength, (const char**) res.msaSequence, wg == 1);
+        }
+        const double seconds = timer.elapsed();
+        std::cout << (wg == 1 ? "Global weights" : "Context specific weights")
+                  << "\tcolumns/second " << (repeats * res.centerLength) / seconds
+                  << "\ttime " << timer.lap() << "\n";
+    }
+
     for (int k = 0; k < counter; ++k) {
         free(seqsCpy[k]);
     }
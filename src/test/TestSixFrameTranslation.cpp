@@ -0,0 +1,128 @@
+// Checks the SIMD six-frame translation against the codon-by-codon state machine
+// and compares the throughput of both on random sequences with a few ambiguous bases.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+
+#include "TranslateNucl.h"
+#include "Timer.h"
+
+const char* binary_name = "test_sixframetranslation";
+
+// translation of one frame as done before the SIMD kernel
+static void translateFrameScalar(TranslateNucl &translateNucl, const char *nucl, size_t L, char *aa) {
+    int state = 0;
+    for (size_t i = 0; i + 2 < L; i += 3) {
+        for (size_t k = 0; k < 3; ++k) {
+            state = translateNucl.getCodonState(state, nucl[i + k]);
+        }
+        aa[i / 3] = translateNucl.getCodonResidue(state);
+    }
+}
+
+int main (int, const char**) {
+    const size_t sequences = 2000;
+    const size_t maxLength = 20000;
+    const char bases[] = "ACGTacgtNRY";
+
+    std::mt19937 rnd(42);
+    std::uniform_int_distribution<size_t> length(1, maxLength);
+    std::uniform_int_distribution<int> base(0, 7);
+    std::uniform_int_distribution<int> ambiguous(8, 10);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+    std::vector<std::string> seqs;
+    size_t totalLength = 0;
+    for (size_t i = 0; i < sequences; i++) {
+        std::string seq(length(rnd), 'A');
+        for (size_t pos = 0; pos < seq.size(); pos++) {
+            seq[pos] = bases[(coin(rnd) < 0.001) ? ambiguous(rnd) : base(rnd)];
+        }
+        totalLength += seq.size();
+        seqs.push_back(seq);
+    }
+
+    TranslateNucl translateNucl(TranslateNucl::CANONICAL);
+    std::string reverse;
+    std::vector<char> expected(maxLength / 3 + 1);
+    std::vector<char> buffer[6];
+    char *frames[6];
+    for (size_t f = 0; f < 6; f++) {
+        buffer[f].resize(maxLength / 3 + 1);
+        frames[f] = buffer[f].data();
+    }
+    size_t lengths[6];
+
+    // compare every frame against the scalar translation of the sequence and its reverse complement
+    size_t errors = 0;
+    for (size_t i = 0; i < seqs.size(); i++) {
+        const std::string &seq = seqs[i];
+        reverse.assign(seq.rbegin(), seq.rend());
+        for (size_t pos = 0; pos < reverse.size(); pos++) {
+            switch (reverse[pos]) {
+                case 'A': reverse[pos] = 'T'; break;
+                case 'C': reverse[pos] = 'G'; break;
+                case 'G': reverse[pos] = 'C'; break;
+                case 'T': reverse[pos] = 'A'; break;
+                case 'a': reverse[pos] = 't'; break;
+                case 'c': reverse[pos] = 'g'; break;
+                case 'g': reverse[pos] = 'c'; break;
+                case 't': reverse[pos] = 'a'; break;
+                case 'R': reverse[pos] = 'Y'; break;
+                case 'Y': reverse[pos] = 'R'; break;
+                default: break;
+            }
+        }
+        translateNucl.translateSixFrames(seq.c_str(), seq.size(), frames, lengths);
+        for (size_t f = 0; f < 6; f++) {
+            const std::string &strand = (f < 3) ? seq : reverse;
+            const size_t offset = f % 3;
+            const size_t frameLength = (strand.size() >= offset + 3) ? (strand.size() - offset) / 3 : 0;
+            if (frameLength > 0) {
+                translateFrameScalar(translateNucl, strand.c_str() + offset, strand.size() - offset, expected.data());
+            }
+            if (lengths[f] != frameLength || std::string(frames[f], lengths[f]) != std::string(expected.data(), frameLength)) {
+                errors++;
+            }
+        }
+
+        // single frame translation also uses the kernel
+        size_t frameLength = seq.size() / 3;
+        translateNucl.translate(frames[0], seq.c_str(), frameLength * 3);
+        translateFrameScalar(translateNucl, seq.c_str(), seq.size(), expected.data());
+        if (std::string(frames[0], frameLength) != std::string(expected.data(), frameLength)) {
+            errors++;
+        }
+    }
+    std::cout << "Mismatching frames: " << errors << "\n";
+
+    Timer timer;
+    for (size_t i = 0; i < seqs.size(); i++) {
+        const std::string &seq = seqs[i];
+        for (size_t f = 0; f < 3; f++) {
+            if (seq.size() >= f + 3) {
+                translateFrameScalar(translateNucl, seq.c_str() + f, seq.size() - f, frames[f]);
+            }
+        }
+        // the reverse complement frames are translated through the reverse complement state table
+        for (size_t pos = 0; pos + 2 < seq.size(); pos++) {
+            size_t k = seq.size() - 3 - pos;
+            frames[3 + k % 3][k / 3] = translateNucl.translateReverseCodon(seq.c_str() + pos);
+        }
+    }
+    double scalarTime = timer.elapsed();
+
+    timer.reset();
+    for (size_t i = 0; i < seqs.size(); i++) {
+        translateNucl.translateSixFrames(seqs[i].c_str(), seqs[i].size(), frames, lengths);
+    }
+    double simdTime = timer.elapsed();
+
+    std::cout << "Translated " << totalLength << " nucleotides in six frames\n";
+    std::cout << "scalar\t" << totalLength / scalarTime / 1e6 << " Mbp/s\n";
+    std::cout << "simd  \t" << totalLength / simdTime / 1e6 << " Mbp/s\n";
+
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
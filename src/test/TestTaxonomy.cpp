@@ -11,6 +11,6 @@ int main (int argc, const char **argv) {
     std::vector<int> taxa;
     taxa.push_back(9);
     taxa.push_back(7);
-    TaxonNode* node = t.LCA(taxa);
-    Debug(Debug::INFO) << node->name << "\n";
+    const TaxonNode* node = t.LCA(taxa);
+    Debug(Debug::INFO) << t.getString(node->nameIdx) << "\n";
 }
@@ -6,6 +6,11 @@
 #include "DBWriter.h"
 #include "PrefilteringIndexReader.h"
 #include "FileUtil.h"
+#include "itoa.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
 
 #ifdef OPENMP
 #include <omp.h>
@@ -57,6 +62,22 @@ public:
         return Util::parseFastaHeader(data);
     }
 
+    // identifier of the header at position id, points into the header database
+    const char *getIdByPosition(size_t id, size_t &length) {
+        const char *data = reader->getData(id);
+        std::pair<ssize_t, ssize_t> pos = Util::getFastaHeaderPosition(data, strlen(data));
+        if (pos.first == -1 && pos.second == -1) {
+            length = 0;
+            return data;
+        }
+        length = pos.second - pos.first;
+        return data + pos.first;
+    }
+
+    DBReader<unsigned int> *getReader() {
+        return reader;
+    }
+
     ~HeaderIdReader() {
         reader->close();
         delete reader;
@@ -72,6 +93,194 @@ private:
     DBReader<unsigned int> *index;
 };
 
+// Alignment result that points into the alignment database instead of copying the backtrace
+struct AlignmentHit {
+    unsigned int dbKey;
+    int score;
+    float seqId;
+    double eval;
+    unsigned int alnLength;
+    int qStartPos;
+    int qEndPos;
+    unsigned int qLen;
+    int dbStartPos;
+    int dbEndPos;
+    unsigned int dbLen;
+    const char *backtrace;
+    size_t backtraceLength;
+    const char *targetId;
+    size_t targetIdLength;
+    const char *targetData;
+};
+
+// Same fields as Matcher::parseAlignmentRecord, the backtrace stays compressed
+static void readAlignmentHits(std::vector<AlignmentHit> &hits, char *data) {
+    if (data == NULL) {
+        return;
+    }
+    char *entry[255];
+    while (*data != '\0') {
+        size_t columns = Util::getWordsOfLine(data, entry, 255);
+        if (columns < Matcher::ALN_RES_WITH_OUT_BT_COL_CNT) {
+            Debug(Debug::ERROR) << "Invalid alignment result record.\n";
+            EXIT(EXIT_FAILURE);
+        }
+        AlignmentHit hit;
+        hit.dbKey = Util::fast_atoi<unsigned int>(data);
+        hit.score = Util::fast_atoi<int>(entry[1]);
+        hit.seqId = strtod(entry[2], NULL);
+        hit.eval = strtod(entry[3], NULL);
+        hit.qStartPos = Util::fast_atoi<int>(entry[4]);
+        hit.qEndPos = Util::fast_atoi<int>(entry[5]);
+        hit.qLen = Util::fast_atoi<int>(entry[6]);
+        hit.dbStartPos = Util::fast_atoi<int>(entry[7]);
+        hit.dbEndPos = Util::fast_atoi<int>(entry[8]);
+        hit.dbLen = Util::fast_atoi<int>(entry[9]);
+        int adjustQstart = (hit.qStartPos == -1) ? 0 : hit.qStartPos;
+        int adjustDBstart = (hit.dbStartPos == -1) ? 0 : hit.dbStartPos;
+        hit.alnLength = Matcher::computeAlnLength(adjustQstart, hit.qEndPos, adjustDBstart, hit.dbEndPos);
+        if (columns < Matcher::ALN_RES_WITH_BT_COL_CNT) {
+            hit.backtrace = NULL;
+            hit.backtraceLength = 0;
+        } else {
+            hit.backtrace = entry[10];
+            hit.backtraceLength = entry[11] - entry[10];
+        }
+        hit.targetId = NULL;
+        hit.targetIdLength = 0;
+        hit.targetData = NULL;
+        hits.push_back(hit);
+        data = Util::skipLine(data);
+    }
+}
+
+// Position of key in a reader opened with NOSORT or UINT_MAX if it is missing.
+// Keys have to be requested in increasing order, the search gallops forward from the previous position
+// so that consecutive lookups read the index sequentially instead of doing a full binary search.
+static size_t findKeyFrom(DBReader<unsigned int> *reader, unsigned int key, size_t from) {
+    const size_t size = reader->getSize();
+    size_t lo = from;
+    size_t hi = from;
+    size_t step = 1;
+    while (hi < size && reader->getDbKey(hi) < key) {
+        lo = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+    hi = std::min(hi, size);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (reader->getDbKey(mid) < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo < size && reader->getDbKey(lo) == key) ? lo : UINT_MAX;
+}
+
+static void uncompressBacktrace(const char *cbt, size_t length, std::string &bt) {
+    bt.clear();
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (isdigit(cbt[i])) {
+            count = 0;
+            while (i < length && isdigit(cbt[i])) {
+                count = count * 10 + (cbt[i] - '0');
+                i++;
+            }
+            if (i == length) {
+                break;
+            }
+        }
+        bt.append(count, cbt[i]);
+    }
+}
+
+static inline char *writeInt(char *out, int value) {
+    return Itoa::i32toa_sse2(value, out) - 1;
+}
+
+// printf("%1.3f") for the sequence identity without going through printf
+static inline char *writeSeqId(char *out, float seqId) {
+    double value = seqId;
+    if (!(std::fabs(value) < 1000000.0)) {
+        return out + sprintf(out, "%1.3f", value);
+    }
+    if (std::signbit(value)) {
+        *out++ = '-';
+        value = -value;
+    }
+    // exact since a float has less than 53 - 10 significant bits, ties are rounded to even as printf does
+    double scaled = value * 1000.0;
+    double integral = std::floor(scaled);
+    double fraction = scaled - integral;
+    int rounded = static_cast<int>(integral);
+    if (fraction > 0.5 || (fraction == 0.5 && (rounded & 1))) {
+        rounded++;
+    }
+    out = writeInt(out, rounded / 1000);
+    *out++ = '.';
+    int decimals = rounded % 1000;
+    *out++ = '0' + decimals / 100;
+    *out++ = '0' + (decimals / 10) % 10;
+    *out++ = '0' + decimals % 10;
+    return out;
+}
+
+// Appends the tab separated line of one hit, the evalue is the only column still formatted by printf
+static void appendHitLine(std::string &result, const char *queryId, size_t queryIdLength, const AlignmentHit &hit,
+                          unsigned int alnLen, unsigned int missMatchCount, unsigned int gapOpenCount,
+                          bool withLengths, bool pairwise) {
+    const size_t start = result.size();
+    result.resize(start + queryIdLength + hit.targetIdLength + 256);
+    char *out = &result[start];
+    if (pairwise) {
+        *out++ = '>';
+    }
+    memcpy(out, queryId, queryIdLength);
+    out += queryIdLength;
+    *out++ = '\t';
+    memcpy(out, hit.targetId, hit.targetIdLength);
+    out += hit.targetIdLength;
+    *out++ = '\t';
+    out = writeSeqId(out, hit.seqId);
+    *out++ = '\t';
+    out = writeInt(out, alnLen);
+    *out++ = '\t';
+    out = writeInt(out, missMatchCount);
+    *out++ = '\t';
+    out = writeInt(out, gapOpenCount);
+    *out++ = '\t';
+    out = writeInt(out, hit.qStartPos + 1);
+    *out++ = '\t';
+    out = writeInt(out, hit.qEndPos + 1);
+    *out++ = '\t';
+    out = writeInt(out, hit.dbStartPos + 1);
+    *out++ = '\t';
+    out = writeInt(out, hit.dbEndPos + 1);
+    *out++ = '\t';
+    out += sprintf(out, "%.2E", hit.eval);
+    *out++ = '\t';
+    out = writeInt(out, hit.score);
+    if (withLengths) {
+        *out++ = '\t';
+        out = writeInt(out, hit.qLen);
+        *out++ = '\t';
+        out = writeInt(out, hit.dbLen);
+    }
+    *out++ = '\n';
+    result.resize(out - result.data());
+}
+
+struct CompareHitsByTarget {
+    const std::vector<AlignmentHit> &hits;
+    CompareHitsByTarget(const std::vector<AlignmentHit> &hits) : hits(hits) {}
+    bool operator()(unsigned int a, unsigned int b) const {
+        return hits[a].dbKey < hits[b].dbKey;
+    }
+};
+
 void printSeqBasedOnAln(std::string &out, const Sequence *seq, unsigned int offset, const std::string &bt, bool reverse) {
     unsigned int seqPos = 0;
     for (uint32_t i = 0; i < bt.size(); ++i) {
@@ -172,9 +381,12 @@ int convertalignments(int argc, const char **argv, const Command &command) {
         std::string result;
         result.reserve(1024*1024);
 
-        char buffer[1024];
-        std::vector<Matcher::result_t> results;
-        results.reserve(300);
+        // reused for every query, a hit only points into the alignment and header databases
+        std::vector<AlignmentHit> hits;
+        hits.reserve(300);
+        std::vector<unsigned int> order;
+        order.reserve(300);
+        std::string backtrace;
 
 #pragma omp  for schedule(dynamic, 10)
         for (size_t i = 0; i < alnDbr.getSize(); i++) {
@@ -187,21 +399,44 @@ int convertalignments(int argc, const char **argv, const Command &command) {
                 querySeq->mapSequence(i, queryKey, queryReader->getDataByDBKey(queryKey));
             }
 
-            std::string queryId = qHeaderDbr.getId(queryKey);
-            Matcher::readAlignmentResults(results, data, true);
-            unsigned int missMatchCount;
-            for (size_t j = 0; j < results.size(); j++) {
-                const Matcher::result_t &res = results[j];
-                std::string targetId = tHeaderDbr->getId(res.dbKey);
+            size_t queryIdLength;
+            const char *queryId = qHeaderDbr.getIdByPosition(qHeaderDbr.getReader()->getId(queryKey), queryIdLength);
+            readAlignmentHits(hits, data);
+
+            // resolve headers and target sequences in the order of the target keys
+            order.resize(hits.size());
+            for (size_t j = 0; j < hits.size(); j++) {
+                order[j] = j;
+            }
+            std::sort(order.begin(), order.end(), CompareHitsByTarget(hits));
+            size_t headerCursor = 0;
+            size_t targetCursor = 0;
+            for (size_t j = 0; j < order.size(); j++) {
+                AlignmentHit &hit = hits[order[j]];
+                size_t headerId = findKeyFrom(tHeaderDbr->getReader(), hit.dbKey, headerCursor);
+                hit.targetId = tHeaderDbr->getIdByPosition(headerId, hit.targetIdLength);
+                headerCursor = headerId;
+                if (format == Parameters::FORMAT_ALIGNMENT_PAIRWISE) {
+                    size_t targetId = findKeyFrom(targetReader, hit.dbKey, targetCursor);
+                    if (targetId != UINT_MAX) {
+                        hit.targetData = targetReader->getData(targetId);
+                        targetCursor = targetId;
+                    }
+                }
+            }
+
+            for (size_t j = 0; j < hits.size(); j++) {
+                const AlignmentHit &res = hits[j];
                 unsigned int gapOpenCount = 0;
                 unsigned int alnLen = res.alnLength;
-                if (res.backtrace.size() > 0) {
+                unsigned int missMatchCount;
+                if (res.backtraceLength > 0) {
                     size_t matchCount = 0;
                     alnLen = 0;
-                    for (size_t pos = 0; pos < res.backtrace.size(); pos++) {
+                    for (size_t pos = 0; pos < res.backtraceLength; pos++) {
                         int cnt = 0;
                         if (isdigit(res.backtrace[pos])) {
-                            cnt += Util::fast_atoi<int>(res.backtrace.c_str() + pos);
+                            cnt += Util::fast_atoi<int>(res.backtrace + pos);
                             while (isdigit(res.backtrace[pos])) {
                                 pos++;
                             }
@@ -229,63 +464,21 @@ int convertalignments(int argc, const char **argv, const Command &command) {
                     missMatchCount = static_cast<unsigned int>( bestMatchEstimate * (1.0f - res.seqId) + 0.5 );
                 }
 
-
                 switch (format) {
-                    case Parameters::FORMAT_ALIGNMENT_BLAST_TAB: {
-                        int count = snprintf(buffer, sizeof(buffer),
-                                             "%s\t%s\t%1.3f\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%.2E\t%d\n",
-                                             queryId.c_str(), targetId.c_str(), res.seqId, alnLen,
-                                             missMatchCount, gapOpenCount,
-                                             res.qStartPos + 1, res.qEndPos + 1,
-                                             res.dbStartPos + 1, res.dbEndPos + 1,
-                                             res.eval, res.score);
-
-                        if (count < 0 || static_cast<size_t>(count) >= sizeof(buffer)) {
-                            Debug(Debug::WARNING) << "Truncated line in entry" << j << "!\n";
-                            continue;
-                        }
-
-                        result.append(buffer, count);
+                    case Parameters::FORMAT_ALIGNMENT_BLAST_TAB:
+                        appendHitLine(result, queryId, queryIdLength, res, alnLen, missMatchCount, gapOpenCount, false, false);
                         break;
-                    }
-                    case Parameters::FORMAT_ALIGNMENT_BLAST_WITH_LEN: {
-                        int count = snprintf(buffer, sizeof(buffer),
-                                             "%s\t%s\t%1.3f\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%.2E\t%d\t%d\t%d\n",
-                                             queryId.c_str(), targetId.c_str(), res.seqId, alnLen,
-                                             missMatchCount, gapOpenCount,
-                                             res.qStartPos + 1, res.qEndPos + 1,
-                                             res.dbStartPos + 1, res.dbEndPos + 1,
-                                             res.eval, res.score,
-                                             res.qLen, res.dbLen);
-
-                        if (count < 0 || static_cast<size_t>(count) >= sizeof(buffer)) {
-                            Debug(Debug::WARNING) << "Truncated line in entry" << j << "!\n";
-                            continue;
-                        }
-
-                        result.append(buffer, count);
+                    case Parameters::FORMAT_ALIGNMENT_BLAST_WITH_LEN:
+                        appendHitLine(result, queryId, queryIdLength, res, alnLen, missMatchCount, gapOpenCount, true, false);
                         break;
-                    }
                     case Parameters::FORMAT_ALIGNMENT_PAIRWISE: {
-                        int count = snprintf(buffer, sizeof(buffer),
-                                             ">%s\t%s\t%1.3f\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%.2E\t%d\n",
-                                             queryId.c_str(), targetId.c_str(), res.seqId, alnLen, missMatchCount,
-                                             gapOpenCount,
-                                             res.qStartPos + 1, res.qEndPos + 1, res.dbStartPos + 1, res.dbEndPos + 1,
-                                             res.eval, res.score);
-
-                        if (count < 0 || static_cast<size_t>(count) >= sizeof(buffer)) {
-                            Debug(Debug::WARNING) << "Truncated line in entry" << j << "!\n";
-                            continue;
-                        }
-
-                        result.append(buffer, count);
+                        appendHitLine(result, queryId, queryIdLength, res, alnLen, missMatchCount, gapOpenCount, false, true);
 
-                        const std::string &backtrace = Matcher::uncompressAlignment(res.backtrace);
+                        uncompressBacktrace(res.backtrace, res.backtraceLength, backtrace);
                         printSeqBasedOnAln(result, querySeq, res.qStartPos, backtrace, false);
                         result.append(1, '\n');
 
-                        targetSeq->mapSequence(i, res.dbKey, targetReader->getDataByDBKey(res.dbKey));
+                        targetSeq->mapSequence(i, res.dbKey, res.targetData);
 
                         printSeqBasedOnAln(result, targetSeq, res.dbStartPos, backtrace, true);
                         result.append(1, '\n');
@@ -299,7 +492,7 @@ int convertalignments(int argc, const char **argv, const Command &command) {
             }
 
             resultWriter.writeData(result.c_str(), result.size(), queryKey, thread_idx, isDb);
-            results.clear();
+            hits.clear();
             result.clear();
         }
         if (needSequenceDB) {
@@ -21,12 +21,25 @@ int createsubdb(int argc, const char **argv, const Command& command) {
     DBReader<unsigned int> reader(par.db2.c_str(), par.db2Index.c_str());
     reader.open(DBReader<unsigned int>::NOSORT);
 
-    DBWriter writer(par.db3.c_str(), par.db3Index.c_str());
-    writer.open();
+    const bool isSoft = par.subDbMode == Parameters::SUBDB_MODE_SOFT;
+    // soft mode only writes a key-subset index into the unchanged data file of the input
+    FILE *indexFile = NULL;
+    DBWriter *writer = NULL;
+    if (isSoft) {
+        indexFile = fopen(par.db3Index.c_str(), "w");
+        if (indexFile == NULL) {
+            Debug(Debug::ERROR) << "Could not open " << par.db3Index << " for writing\n";
+            EXIT(EXIT_FAILURE);
+        }
+    } else {
+        writer = new DBWriter(par.db3.c_str(), par.db3Index.c_str());
+        writer->open();
+    }
 
     Debug(Debug::INFO) << "Start writing to file " << par.db3 << "\n";
     char * line = new char[65536];
     char dbKey[255 + 1];
+    char indexBuffer[1024];
     size_t len = 0;
     while (getline(&line, &len, orderFile) != -1) {
         Util::parseKey(line, dbKey);
@@ -37,16 +50,31 @@ int createsubdb(int argc, const char **argv, const Command& command) {
             continue;
         }
 
+        if (isSoft) {
+            size_t indexLength = DBWriter::indexToBuffer(indexBuffer, key, reader.getIndex()[id].offset, reader.getSeqLens(id));
+            if (fwrite(indexBuffer, sizeof(char), indexLength, indexFile) != indexLength) {
+                Debug(Debug::ERROR) << "Could not write to index file " << par.db3Index << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            continue;
+        }
+
         const char* data = reader.getData(id);
         // discard null byte
         size_t length = reader.getSeqLens(id) - 1;
-        writer.writeData(data, length, key);
+        writer->writeData(data, length, key);
     }
 
     if(FileUtil::fileExists((par.db2 + ".dbtype").c_str())){
         FileUtil::copyFile((par.db2 + ".dbtype").c_str(), (par.db3 + ".dbtype").c_str());
     }
-    writer.close();
+    if (isSoft) {
+        fclose(indexFile);
+        FileUtil::symlinkAbs(par.db2, par.db3);
+    } else {
+        writer->close();
+        delete writer;
+    }
 
     delete[] line;
     reader.close();
@@ -5,11 +5,13 @@
 #include "Matcher.h"
 #include "Util.h"
 #include "itoa.h"
+#include "TranslateNucl.h"
 
 #include "Orf.h"
 
 #include <unistd.h>
 #include <climits>
+#include <cstdlib>
 #include <algorithm>
 
 #ifdef OPENMP
@@ -38,6 +40,24 @@ unsigned int getFrames(std::string frames) {
     return result;
 }
 
+// Parses the [Orf: ...] tag written at the end of an ORF header by extractorfs.
+// Faster than Orf::parseOrfHeader, which has to split the whole header into words.
+static Orf::SequenceLocation parseOrfTag(const char *header, size_t length) {
+    const char *tag = header + length;
+    while (tag > header && *tag != '[') {
+        tag--;
+    }
+    char *end;
+    Orf::SequenceLocation loc;
+    loc.id = strtoul(tag + 6, &end, 10);
+    loc.from = strtoull(end + 1, &end, 10);
+    loc.to = strtoull(end + 1, &end, 10);
+    loc.strand = static_cast<Orf::Strand>(strtol(end + 1, &end, 10));
+    loc.hasIncompleteStart = strtol(end + 1, &end, 10) != 0;
+    loc.hasIncompleteEnd = strtol(end + 1, &end, 10) != 0;
+    return loc;
+}
+
 int extractorfs(int argc, const char **argv, const Command& command) {
     Parameters& par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, 2);
@@ -62,9 +82,16 @@ int extractorfs(int argc, const char **argv, const Command& command) {
     unsigned int forwardFrames = getFrames(par.forwardFrames);
     unsigned int reverseFrames = getFrames(par.reverseFrames);
 
+    // with --translate the ORFs are translated in memory and no nucleotide ORF database is written
+    TranslateNucl translateNucl(static_cast<TranslateNucl::GenCode>(par.translationTable));
+
 #pragma omp parallel
     {
         Orf orf(par.translationTable, par.useAllTableStarts);
+        char *aa = NULL;
+        if (par.translate) {
+            aa = new char[par.maxSeqLen + 3 + 1];
+        }
         int thread_idx = 0;
 #ifdef OPENMP
         thread_idx = omp_get_thread_num();
@@ -105,22 +132,52 @@ int extractorfs(int argc, const char **argv, const Command& command) {
                     continue;
                 }
 
+                std::pair<const char*, size_t> sequence = orf.getSequence(loc);
+                size_t aaLength = 0;
+                if (par.translate) {
+                    // same as translatenucs: only full codons, at most maxSeqLen residues
+                    size_t length = sequence.second - (sequence.second % 3);
+                    if (length < 3) {
+                        continue;
+                    }
+                    if (length > (3 * par.maxSeqLen)) {
+                        length = (3 * par.maxSeqLen);
+                    }
+                    const bool addStopAtStart = par.addOrfStop && !(loc.hasIncompleteStart);
+                    if (addStopAtStart) {
+                        aa[0] = '*';
+                    }
+                    char *writeAA = aa + addStopAtStart;
+                    translateNucl.translate(writeAA, sequence.first, length);
+                    aaLength = addStopAtStart + (length / 3);
+                    if (par.addOrfStop && !(loc.hasIncompleteEnd) && writeAA[(length / 3) - 1] != '*') {
+                        aa[aaLength++] = '*';
+                    }
+                    aa[aaLength++] = '\n';
+                }
+
                 char buffer[LINE_MAX];
                 snprintf(buffer, LINE_MAX, "%.*s [Orf: %d, %zu, %zu, %d, %d, %d]\n", (unsigned int)(headerLength - 2), header, key, loc.from, loc.to, loc.strand, loc.hasIncompleteStart, loc.hasIncompleteEnd);
 
                 headerWriter.writeData(buffer, strlen(buffer), key, thread_idx);
 
-                sequenceWriter.writeStart(thread_idx);
-                std::pair<const char*, size_t> sequence = orf.getSequence(loc);
-                sequenceWriter.writeAdd(sequence.first, sequence.second, thread_idx);
-                sequenceWriter.writeAdd(&newline, 1, thread_idx);
-                sequenceWriter.writeEnd(key, thread_idx);
+                if (par.translate) {
+                    sequenceWriter.writeData(aa, aaLength, key, thread_idx);
+                } else {
+                    sequenceWriter.writeStart(thread_idx);
+                    sequenceWriter.writeAdd(sequence.first, sequence.second, thread_idx);
+                    sequenceWriter.writeAdd(&newline, 1, thread_idx);
+                    sequenceWriter.writeEnd(key, thread_idx);
+                }
             }
             res.clear();
         }
+        if (aa != NULL) {
+            delete[] aa;
+        }
     }
     headerWriter.close();
-    sequenceWriter.close(Sequence::NUCLEOTIDES);
+    sequenceWriter.close(par.translate ? Sequence::AMINO_ACIDS : Sequence::NUCLEOTIDES);
     headerReader.close();
     reader.close();
 
@@ -132,13 +189,20 @@ int extractorfs(int argc, const char **argv, const Command& command) {
 #pragma omp task
             {
                 DBReader<unsigned int> orfHeaderReader(par.hdr2.c_str(), par.hdr2Index.c_str(),
-                                                       DBReader<unsigned int>::USE_INDEX);
+                                                       DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
                 orfHeaderReader.open(DBReader<unsigned int>::SORT_BY_ID_OFFSET);
                 FILE *hIndex = fopen((par.hdr2Index + "_tmp").c_str(), "w");
                 if (hIndex == NULL) {
                     Debug(Debug::ERROR) << "Could not open " << par.hdr2Index << "_tmp for writing!\n";
                     EXIT(EXIT_FAILURE);
                 }
+                // binary ORF locations in key order, see Orf::PackedLocation
+                std::string locationFile = par.db2 + ".orf";
+                FILE *lIndex = fopen(locationFile.c_str(), "wb");
+                if (lIndex == NULL) {
+                    Debug(Debug::ERROR) << "Could not open " << locationFile << " for writing!\n";
+                    EXIT(EXIT_FAILURE);
+                }
                 for (size_t i = 0; i < orfHeaderReader.getSize(); i++) {
                     DBReader<unsigned int>::Index *idx = orfHeaderReader.getIndex(i);
                     char buffer[1024];
@@ -148,7 +212,14 @@ int extractorfs(int argc, const char **argv, const Command& command) {
                         Debug(Debug::ERROR) << "Could not write to data file " << par.hdr2Index << "_tmp\n";
                         EXIT(EXIT_FAILURE);
                     }
+
+                    Orf::PackedLocation location(parseOrfTag(orfHeaderReader.getData(i), orfHeaderReader.getSeqLens(i) - 1));
+                    if (fwrite(&location, sizeof(Orf::PackedLocation), 1, lIndex) != 1) {
+                        Debug(Debug::ERROR) << "Could not write to data file " << locationFile << "\n";
+                        EXIT(EXIT_FAILURE);
+                    }
                 }
+                fclose(lIndex);
                 fclose(hIndex);
                 orfHeaderReader.close();
                 std::rename((par.hdr2Index + "_tmp").c_str(), par.hdr2Index.c_str());
@@ -15,8 +15,11 @@
 #include "FileUtil.h"
 #include "Timer.h"
 #include "tantan.h"
+#include "kmermatcher.h"
 
 #include <limits>
+#include <climits>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <iomanip>
@@ -30,62 +33,9 @@
 #ifndef SIZE_T_MAX
 #define SIZE_T_MAX ((size_t) -1)
 #endif
-struct KmerPosition {
-    size_t kmer;
-    unsigned int id;
-    unsigned short seqLen;
-    short pos;
-    KmerPosition(){}
-    KmerPosition(size_t kmer, unsigned int id, unsigned short seqLen, short pos):
-            kmer(kmer), id(id), seqLen(seqLen), pos(pos) {}
-    static bool compareRepSequenceAndIdAndPos(const KmerPosition &first, const KmerPosition &second){
-        if(first.kmer < second.kmer )
-            return true;
-        if(second.kmer < first.kmer )
-            return false;
-        if(first.seqLen > second.seqLen )
-            return true;
-        if(second.seqLen > first.seqLen )
-            return false;
-        if(first.id < second.id )
-            return true;
-        if(second.id < first.id )
-            return false;
-        if(first.pos < second.pos )
-            return true;
-        if(second.pos < first.pos )
-            return false;
-        return false;
-    }
-
-    static bool compareRepSequenceAndIdAndDiag(const KmerPosition &first, const KmerPosition &second){
-        if(first.kmer < second.kmer)
-            return true;
-        if(second.kmer < first.kmer)
-            return false;
-        if(first.id < second.id)
-            return true;
-        if(second.id < first.id)
-            return false;
-
-        //        const short firstDiag  = (first.pos < 0)  ? -first.pos : first.pos;
-        //        const short secondDiag = (second.pos  < 0) ? -second.pos : second.pos;
-        if(first.pos < second.pos)
-            return true;
-        if(second.pos < first.pos)
-            return false;
-        return false;
-    }
-};
-
-struct __attribute__((__packed__)) KmerEntry {
-    unsigned int seqId;
-    short diagonal;
-};
-
 void mergeKmerFilesAndOutput(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
                              std::vector<std::string> tmpFiles, std::vector<char> &repSequence,
-                             int covMode, float covThr) ;
+                             int covMode, float covThr, int threads) ;
 
 void setKmerLengthAndAlphabet(Parameters &parameters, size_t aaDbSize, int seqType);
 
@@ -120,10 +70,66 @@ unsigned circ_hash_next(const int * x, unsigned length, int x_first, short unsig
 #undef RoL
 
 
+size_t selectTopHashKmers(SequencePosition *kmers, size_t kmerCount, size_t maxKmers) {
+    if (kmerCount > 1) {
+        std::stable_sort(kmers, kmers + kmerCount, SequencePosition::compareByScore);
+    }
+    return std::min(maxKmers, kmerCount);
+}
+
+size_t selectMinimizerKmers(SequencePosition *kmers, size_t kmerCount, size_t windowSize, size_t maxKmers,
+                            unsigned int *window) {
+    if (kmerCount == 0 || maxKmers == 0) {
+        return 0;
+    }
+    windowSize = std::max(std::min(windowSize, kmerCount), static_cast<size_t>(1));
+    // window is a ring buffer of k-mer positions with increasing hash from front to back,
+    // the front is always the minimizer of the current window
+    size_t front = 0;
+    size_t back = 0;
+    size_t selected = 0;
+    size_t lastMinimizer = SIZE_T_MAX;
+    for (size_t i = 0; i < kmerCount; i++) {
+        if (back > front && window[front % windowSize] + windowSize <= i) {
+            front++;
+        }
+        while (back > front && SequencePosition::compareByScore(kmers[i], kmers[window[(back - 1) % windowSize]])) {
+            back--;
+        }
+        window[back % windowSize] = static_cast<unsigned int>(i);
+        back++;
+        if (i + 1 >= windowSize) {
+            const unsigned int minimizer = window[front % windowSize];
+            // minimizer positions only increase, so compacting to the front never overwrites
+            // a k-mer that is still in the window
+            if (minimizer != lastMinimizer) {
+                kmers[selected] = kmers[minimizer];
+                selected++;
+                lastMinimizer = minimizer;
+            }
+        }
+    }
+    if (selected > maxKmers) {
+        std::nth_element(kmers, kmers + maxKmers, kmers + selected, SequencePosition::compareByScore);
+        selected = maxKmers;
+    }
+    std::sort(kmers, kmers + selected, SequencePosition::compareByScore);
+    return selected;
+}
+
+size_t computeMinimizerWindowSize(double avgKmerCount, size_t chooseTopKmer) {
+    if (chooseTopKmer == 0) {
+        return 1;
+    }
+    const double windowSize = (2.0 * avgKmerCount) / static_cast<double>(chooseTopKmer) - 1.0;
+    return std::max(static_cast<size_t>(windowSize), static_cast<size_t>(1));
+}
+
 size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int> &seqDbr,
                              Parameters & par, BaseMatrix * subMat,
                              size_t KMER_SIZE, size_t chooseTopKmer,
-                             size_t splits, size_t split){
+                             size_t splits, size_t split, size_t splitRange,
+                             size_t fromId, size_t toId){
     size_t offset = 0;
     int querySeqType  =  seqDbr.getDbtype();
     ProbabilityMatrix *probMatrix = NULL;
@@ -131,23 +137,14 @@ size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int>
         probMatrix = new ProbabilityMatrix(*subMat);
     }
 
-    struct SequencePosition{
-        short score;
-        size_t kmer;
-        unsigned int pos;
-        static bool compareByScore(const SequencePosition &first, const SequencePosition &second){
-            if(first.score < second.score)
-                return true;
-            if(second.score < first.score)
-                return false;
-            if(first.kmer < second.kmer)
-                return true;
-            if(second.kmer < first.kmer)
-                return false;
-
-            return false;
-        }
-    };
+    size_t windowSize = 0;
+    if (par.kmerSelectMode == Parameters::KMER_SELECT_MINIMIZER) {
+        // one window size for all sequences keeps the minimizers of similar sequences consistent
+        const double avgKmerCount = std::max(0.0, static_cast<double>(seqDbr.getAminoAcidDBSize()) / std::max(seqDbr.getSize(), static_cast<size_t>(1))
+                                                  - 2.0 - static_cast<double>(KMER_SIZE) + 1.0);
+        windowSize = computeMinimizerWindowSize(avgKmerCount, chooseTopKmer - 1);
+        Debug(Debug::INFO) << "Minimizer window size " << windowSize << "\n";
+    }
 #pragma omp parallel
     {
         Sequence seq(par.maxSeqLen, querySeqType, subMat, KMER_SIZE, false, false);
@@ -157,16 +154,20 @@ size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int>
         size_t bufferPos = 0;
         KmerPosition * threadKmerBuffer = new KmerPosition[BUFFER_SIZE];
         SequencePosition * kmers = new SequencePosition[par.maxSeqLen+1];
+        unsigned int * minimizerWindow = NULL;
+        if (windowSize > 0) {
+            minimizerWindow = new unsigned int[windowSize];
+        }
         int highestSeq[32];
         for(size_t i = 0; i<KMER_SIZE;i++){
             highestSeq[i]=subMat->alphabetSize-1;
         }
         size_t highestPossibleIndex = idxer.int2index(highestSeq);
         const size_t flushSize = 100000000;
-        size_t iterations = static_cast<size_t>(ceil(static_cast<double>(seqDbr.getSize()) / static_cast<double>(flushSize)));
+        size_t iterations = static_cast<size_t>(ceil(static_cast<double>(toId - fromId) / static_cast<double>(flushSize)));
         for (size_t i = 0; i < iterations; i++) {
-            size_t start = (i * flushSize);
-            size_t bucketSize = std::min(seqDbr.getSize() - (i * flushSize), flushSize);
+            size_t start = fromId + (i * flushSize);
+            size_t bucketSize = std::min(toId - start, flushSize);
 
 #pragma omp for schedule(dynamic, 100)
             for (size_t id = start; id < (start + bucketSize); id++) {
@@ -220,10 +221,14 @@ size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int>
                     (kmers + seqKmerCount)->pos = seq.getCurrentPosition();
                     seqKmerCount++;
                 }
-                if (seqKmerCount > 1) {
-                    std::stable_sort(kmers, kmers + seqKmerCount, SequencePosition::compareByScore);
+                size_t kmerConsidered;
+                if (par.kmerSelectMode == Parameters::KMER_SELECT_MINIMIZER) {
+                    kmerConsidered = selectMinimizerKmers(kmers, seqKmerCount, windowSize, chooseTopKmer - 1, minimizerWindow);
+                    // only the selected minimizers are checked for repeats
+                    seqKmerCount = static_cast<int>(kmerConsidered);
+                } else {
+                    kmerConsidered = selectTopHashKmers(kmers, seqKmerCount, chooseTopKmer - 1);
                 }
-                size_t kmerConsidered = std::min(static_cast<int>(chooseTopKmer - 1), seqKmerCount);
                 if(par.skipNRepeatKmer > 0 ){
                     size_t prevKmer = SIZE_T_MAX;
                     kmers[seqKmerCount].kmer=SIZE_T_MAX;
@@ -240,7 +245,8 @@ size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int>
                 }
 
                 // add k-mer to represent the identity
-                if (seqHash%splits == split) {
+                // keep only k-mers of splits [split, split + splitRange)
+                if (seqHash%splits - split < splitRange) {
                     threadKmerBuffer[bufferPos].kmer = seqHash;
                     threadKmerBuffer[bufferPos].id = seqId;
                     threadKmerBuffer[bufferPos].pos = 0;
@@ -254,7 +260,7 @@ size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int>
                 }
                 for (size_t topKmer = 0; topKmer < kmerConsidered; topKmer++) {
                     size_t splitIdx = (kmers + topKmer)->kmer % splits;
-                    if (splitIdx != split) {
+                    if (splitIdx - split >= splitRange) {
                         continue;
                     }
 
@@ -286,6 +292,9 @@ size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int>
             memcpy(hashSeqPair+writeOffset, threadKmerBuffer, sizeof(KmerPosition) * bufferPos);
         }
         delete [] kmers;
+        if (minimizerWindow != NULL) {
+            delete [] minimizerWindow;
+        }
         delete [] charSequence;
         delete [] threadKmerBuffer;
     }
@@ -296,30 +305,12 @@ size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int>
     return offset;
 }
 
-KmerPosition * doComputation(size_t totalKmers, size_t split, size_t splits, std::string splitFile,
-                             DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat,
-                             size_t KMER_SIZE, size_t chooseTopKmer) {
-
-    Debug(Debug::INFO) << "Generate k-mers list " << split <<"\n";
-
-    size_t splitKmerCount = (splits > 1) ? static_cast<size_t >(static_cast<double>(totalKmers/splits) * 1.2) : totalKmers;
-
-    KmerPosition * hashSeqPair = new(std::nothrow) KmerPosition[splitKmerCount + 1];
-    Util::checkAllocation(hashSeqPair, "Could not allocate memory");
-#pragma omp parallel for
-    for (size_t i = 0; i < splitKmerCount + 1; i++) {
-        hashSeqPair[i].kmer = SIZE_T_MAX;
-    }
-
+// Groups the k-mers by sequence and assigns every member of a k-mer group to the longest sequence of the group.
+// hashSeqPair needs at least one SIZE_T_MAX entry after elementsToSort.
+// Returns the number of (rep. sequence, member) entries sorted to the front of hashSeqPair.
+size_t assignRepSequences(KmerPosition *hashSeqPair, size_t elementsToSort, Parameters &par) {
     Timer timer;
-    size_t elementsToSort = fillKmerPositionArray(hashSeqPair, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer, splits, split);
-    Debug(Debug::INFO) << "\nTime for fill: " << timer.lap() << "\n";
-    if(splits == 1){
-        seqDbr.unmapData();
-    }
-    Debug(Debug::INFO) << "Done." << "\n";
     Debug(Debug::INFO) << "Sort kmer ... ";
-    timer.reset();
     omptl::sort(hashSeqPair, hashSeqPair + elementsToSort, KmerPosition::compareRepSequenceAndIdAndPos);
     //kx::radix_sort(hashSeqPair, hashSeqPair + elementsToSort, KmerComparision());
     Debug(Debug::INFO) << "Done." << "\n";
@@ -334,7 +325,7 @@ KmerPosition * doComputation(size_t totalKmers, size_t split, size_t splits, std
         size_t prevSetSize = 0;
         size_t queryLen;
         unsigned int repSeq_i_pos = hashSeqPair[0].pos;
-        for (size_t elementIdx = 0; elementIdx < splitKmerCount+1; elementIdx++) {
+        for (size_t elementIdx = 0; elementIdx < elementsToSort + 1; elementIdx++) {
             if (prevHash != hashSeqPair[elementIdx].kmer) {
                 for (size_t i = prevHashStart; i < elementIdx; i++) {
                     size_t rId =  (hashSeqPair[i].kmer != SIZE_T_MAX) ? ((prevSetSize == 1) ? SIZE_T_MAX
@@ -375,6 +366,34 @@ KmerPosition * doComputation(size_t totalKmers, size_t split, size_t splits, std
     Debug(Debug::INFO) << "Done\n";
     Debug(Debug::INFO) << "Time for sort: " << timer.lap() << "\n";
 
+    return writePos;
+}
+
+KmerPosition * doComputation(size_t totalKmers, size_t split, size_t splits, std::string splitFile,
+                             DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat,
+                             size_t KMER_SIZE, size_t chooseTopKmer) {
+
+    Debug(Debug::INFO) << "Generate k-mers list " << split <<"\n";
+
+    size_t splitKmerCount = (splits > 1) ? static_cast<size_t >(static_cast<double>(totalKmers/splits) * 1.2) : totalKmers;
+
+    KmerPosition * hashSeqPair = new(std::nothrow) KmerPosition[splitKmerCount + 1];
+    Util::checkAllocation(hashSeqPair, "Could not allocate memory");
+#pragma omp parallel for
+    for (size_t i = 0; i < splitKmerCount + 1; i++) {
+        hashSeqPair[i].kmer = SIZE_T_MAX;
+    }
+
+    Timer timer;
+    size_t elementsToSort = fillKmerPositionArray(hashSeqPair, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer,
+                                                  splits, split, 1, 0, seqDbr.getSize());
+    Debug(Debug::INFO) << "\nTime for fill: " << timer.lap() << "\n";
+    if(splits == 1){
+        seqDbr.unmapData();
+    }
+    Debug(Debug::INFO) << "Done." << "\n";
+    size_t writePos = assignRepSequences(hashSeqPair, elementsToSort, par);
+
     if(splits > 1){
         writeKmersToDisk(splitFile, hashSeqPair, writePos + 1);
         delete [] hashSeqPair;
@@ -383,6 +402,103 @@ KmerPosition * doComputation(size_t totalKmers, size_t split, size_t splits, std
     return hashSeqPair;
 }
 
+#ifdef HAVE_MPI
+// Each rank generates the k-mers of its share of the sequences and sends every k-mer to the rank
+// that owns its split (kmer % splits). The k-mers of a split are then grouped locally on their owner,
+// which writes one split file per round. splits has to be a multiple of the number of ranks.
+void doComputationMpi(size_t splits, DBReader<unsigned int> &seqDbr, Parameters &par, BaseMatrix *subMat,
+                      size_t KMER_SIZE, size_t chooseTopKmer) {
+    const size_t numProc = static_cast<size_t>(MMseqsMPI::numProc);
+    const size_t rank = static_cast<size_t>(MMseqsMPI::rank);
+    const size_t rounds = splits / numProc;
+
+    size_t dbFrom = 0;
+    size_t dbSize = 0;
+    Util::decomposeDomainByAminoAcid(seqDbr.getAminoAcidDBSize(), seqDbr.getSeqLens(), seqDbr.getSize(),
+                                     rank, numProc, &dbFrom, &dbSize);
+    size_t localKmers = 0;
+    for (size_t id = dbFrom; id < dbFrom + dbSize; id++) {
+        int kmerAdjustedSeqLen = std::max(0, static_cast<int>(seqDbr.getSeqLens(id) - 2) - static_cast<int>(KMER_SIZE) + 1);
+        localKmers += std::min(kmerAdjustedSeqLen, static_cast<int>(chooseTopKmer));
+    }
+
+    MPI_Datatype mpiKmerPosition;
+    MPI_Type_contiguous(sizeof(KmerPosition), MPI_BYTE, &mpiKmerPosition);
+    MPI_Type_commit(&mpiKmerPosition);
+
+    int *sendCounts = new int[numProc];
+    int *sendDispls = new int[numProc];
+    int *recvCounts = new int[numProc];
+    int *recvDispls = new int[numProc];
+    for (size_t round = 0; round < rounds; round++) {
+        const size_t splitBase = round * numProc;
+        Debug(Debug::INFO) << "Generate k-mers list for splits " << splitBase << " to " << (splitBase + numProc - 1) << "\n";
+
+        size_t roundKmerCount = (rounds > 1) ? static_cast<size_t>(static_cast<double>(localKmers / rounds) * 1.2) : localKmers;
+        KmerPosition *hashSeqPair = new(std::nothrow) KmerPosition[roundKmerCount + 1];
+        Util::checkAllocation(hashSeqPair, "Could not allocate memory");
+        Timer timer;
+        size_t elementCount = fillKmerPositionArray(hashSeqPair, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer,
+                                                    splits, splitBase, numProc, dbFrom, dbFrom + dbSize);
+        Debug(Debug::INFO) << "\nTime for fill: " << timer.lap() << "\n";
+
+        // bucket the k-mers by owning rank
+        size_t *bucketOffsets = new size_t[numProc + 1];
+        memset(bucketOffsets, 0, sizeof(size_t) * (numProc + 1));
+        for (size_t i = 0; i < elementCount; i++) {
+            bucketOffsets[(hashSeqPair[i].kmer % splits) - splitBase + 1]++;
+        }
+        for (size_t proc = 0; proc < numProc; proc++) {
+            // counts and displacements of MPI_Alltoallv are int
+            if (bucketOffsets[proc + 1] > INT_MAX || bucketOffsets[proc] > INT_MAX) {
+                Debug(Debug::ERROR) << "Too many k-mers for a single exchange. Please decrease --split-memory-limit.\n";
+                EXIT(EXIT_FAILURE);
+            }
+            sendCounts[proc] = static_cast<int>(bucketOffsets[proc + 1]);
+            bucketOffsets[proc + 1] += bucketOffsets[proc];
+            sendDispls[proc] = static_cast<int>(bucketOffsets[proc]);
+        }
+        KmerPosition *sendBuffer = new(std::nothrow) KmerPosition[elementCount + 1];
+        Util::checkAllocation(sendBuffer, "Could not allocate memory");
+        for (size_t i = 0; i < elementCount; i++) {
+            size_t owner = (hashSeqPair[i].kmer % splits) - splitBase;
+            sendBuffer[bucketOffsets[owner]++] = hashSeqPair[i];
+        }
+        delete[] bucketOffsets;
+        delete[] hashSeqPair;
+
+        MPI_Alltoall(sendCounts, 1, MPI_INT, recvCounts, 1, MPI_INT, MPI_COMM_WORLD);
+        size_t recvTotal = 0;
+        for (size_t proc = 0; proc < numProc; proc++) {
+            if (recvTotal > INT_MAX) {
+                Debug(Debug::ERROR) << "Too many k-mers for a single exchange. Please decrease --split-memory-limit.\n";
+                EXIT(EXIT_FAILURE);
+            }
+            recvDispls[proc] = static_cast<int>(recvTotal);
+            recvTotal += recvCounts[proc];
+        }
+        KmerPosition *recvBuffer = new(std::nothrow) KmerPosition[recvTotal + 1];
+        Util::checkAllocation(recvBuffer, "Could not allocate memory");
+        timer.reset();
+        MPI_Alltoallv(sendBuffer, sendCounts, sendDispls, mpiKmerPosition,
+                      recvBuffer, recvCounts, recvDispls, mpiKmerPosition, MPI_COMM_WORLD);
+        Debug(Debug::INFO) << "Time for k-mer exchange: " << timer.lap() << "\n";
+        delete[] sendBuffer;
+        recvBuffer[recvTotal].kmer = SIZE_T_MAX;
+
+        size_t writePos = assignRepSequences(recvBuffer, recvTotal, par);
+        std::string splitFileName = par.db2 + "_split_" + SSTR(splitBase + rank);
+        writeKmersToDisk(splitFileName, recvBuffer, writePos + 1);
+        delete[] recvBuffer;
+    }
+    delete[] recvDispls;
+    delete[] recvCounts;
+    delete[] sendDispls;
+    delete[] sendCounts;
+    MPI_Type_free(&mpiKmerPosition);
+}
+#endif
+
 void setLinearFilterDefault(Parameters *p) {
     p->spacedKmer = false;
     p->covThr = 0.8;
@@ -461,28 +577,14 @@ int kmermatcher(int argc, const char **argv, const Command &command) {
     KmerPosition *hashSeqPair = NULL;
 
     size_t mpiRank = 0;
+    bool mergeSplitFiles = splits > 1;
 #ifdef HAVE_MPI
-    splits = std::max(static_cast<size_t>(MMseqsMPI::numProc), splits);
-    size_t fromSplit = 0;
-    size_t splitCount = 1;
+    // every rank owns the same number of splits per round
+    const size_t numProc = static_cast<size_t>(MMseqsMPI::numProc);
+    splits = ((std::max(numProc, splits) + numProc - 1) / numProc) * numProc;
+    mergeSplitFiles = true;
     mpiRank = MMseqsMPI::rank;
-    // if split size is great than nodes than we have to
-    // distribute all splits equally over all nodes
-    unsigned int * splitCntPerProc = new unsigned int[MMseqsMPI::numProc];
-    memset(splitCntPerProc, 0, sizeof(unsigned int) * MMseqsMPI::numProc);
-    for(size_t i = 0; i < splits; i++){
-        splitCntPerProc[i % MMseqsMPI::numProc] += 1;
-    }
-    for(int i = 0; i < MMseqsMPI::rank; i++){
-        fromSplit += splitCntPerProc[i];
-    }
-    splitCount = splitCntPerProc[MMseqsMPI::rank];
-    delete[] splitCntPerProc;
-
-    for(size_t split = fromSplit; split < fromSplit+splitCount; split++) {
-        std::string splitFileName = par.db2 + "_split_" +SSTR(split);
-        hashSeqPair = doComputation(totalKmers, split, splits, splitFileName, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer);
-    }
+    doComputationMpi(splits, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer);
     MPI_Barrier(MPI_COMM_WORLD);
     if(mpiRank == 0){
         for(size_t split = 0; split < splits; split++) {
@@ -505,10 +607,10 @@ int kmermatcher(int argc, const char **argv, const Command &command) {
         dbw.open();
 
         Timer timer;
-        if(splits > 1) {
+        if(mergeSplitFiles) {
             std::cout << "How many splits: " << splits<<std::endl;
             seqDbr.unmapData();
-            mergeKmerFilesAndOutput(seqDbr, dbw, splitFiles, repSequence, par.covMode, par.cov);
+            mergeKmerFilesAndOutput(seqDbr, dbw, splitFiles, repSequence, par.covMode, par.cov, par.threads);
         } else {
             writeKmerMatcherResult(seqDbr, dbw, hashSeqPair, totalKmers, repSequence, par.covMode, par.cov, par.threads);
         }
@@ -677,32 +779,45 @@ size_t queueNextEntry(KmerPositionQueue &queue, int file, size_t offsetPos, Kmer
     return offsetPos+pos;
 }
 
-void mergeKmerFilesAndOutput(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
-                             std::vector<std::string> tmpFiles, std::vector<char> &repSequence,
-                             int covMode, float covThr) {
-    Debug(Debug::INFO) << "Merge splits ... ";
+// first entry at or after pos that starts a representative block
+size_t nextBlockStart(const KmerEntry *entries, size_t entrySize, size_t pos) {
+    if(pos == 0){
+        return 0;
+    }
+    while(pos < entrySize && entries[pos - 1].seqId != UINT_MAX){
+        pos++;
+    }
+    return pos;
+}
 
-    const int fileCnt = tmpFiles.size();
-    FILE ** files       = new FILE*[fileCnt];
-    KmerEntry **entries = new KmerEntry*[fileCnt];
-    size_t * entrySizes = new size_t[fileCnt];
-    size_t * offsetPos  = new size_t[fileCnt];
-    size_t * dataSizes  = new size_t[fileCnt];
-    // init structures
-    for(size_t file = 0; file < tmpFiles.size(); file++){
-        files[file] = FileUtil::openFileOrDie(tmpFiles[file].c_str(),"r",true);
-        size_t dataSize;
-        entries[file]    = (KmerEntry*)FileUtil::mmapFile(files[file], &dataSize);
-        dataSizes[file]  = dataSize;
-        entrySizes[file] = dataSize/sizeof(KmerEntry);
+// first block in entries with a representative >= repSeqId, blocks are sorted by representative
+size_t findBlockStart(const KmerEntry *entries, size_t entrySize, unsigned int repSeqId) {
+    size_t lo = 0;
+    size_t hi = entrySize;
+    while(lo < hi){
+        size_t mid = lo + (hi - lo) / 2;
+        size_t blockStart = nextBlockStart(entries, entrySize, mid);
+        if(blockStart < entrySize && entries[blockStart].seqId < repSeqId){
+            lo = blockStart + 1;
+        }else{
+            hi = mid;
+        }
     }
+    return nextBlockStart(entries, entrySize, lo);
+}
+
+// merges the blocks [rangeStart[file], rangeEnd[file]) of all files
+void mergeKmerRange(DBReader<unsigned int> & seqDbr, DBWriter & dbw, int fileCnt, KmerEntry **entries,
+                    size_t *rangeStart, size_t *rangeEnd, std::vector<char> &repSequence,
+                    int covMode, float covThr, int thread_idx) {
+    size_t * offsetPos  = new size_t[fileCnt];
     KmerPositionQueue queue;
     // read one entry for each file
     for(int file = 0; file < fileCnt; file++ ){
-        offsetPos[file]=queueNextEntry(queue, file, 0, entries[file], entrySizes[file]);
+        offsetPos[file]=queueNextEntry(queue, file, rangeStart[file], entries[file], rangeEnd[file]);
     }
     std::string prefResultsOutString;
-    prefResultsOutString.reserve(100000000);
+    prefResultsOutString.reserve(1024 * 1024);
     char buffer[100];
     FileKmerPosition filePrevsKmerPos;
     filePrevsKmerPos.id = UINT_MAX;
@@ -723,8 +838,8 @@ void mergeKmerFilesAndOutput(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
         queue.pop();
         if(res.id==UINT_MAX){
             offsetPos[res.file] = queueNextEntry(queue, res.file, offsetPos[res.file],
-                                                 entries[res.file], entrySizes[res.file]);
-            dbw.writeData(prefResultsOutString.c_str(), prefResultsOutString.length(), seqDbr.getDbKey(res.repSeq), 0);
+                                                 entries[res.file], rangeEnd[res.file]);
+            dbw.writeData(prefResultsOutString.c_str(), prefResultsOutString.length(), seqDbr.getDbKey(res.repSeq), thread_idx);
             repSequence[res.repSeq]=true;
             prefResultsOutString.clear();
             // skipe UINT MAX entries
@@ -732,7 +847,7 @@ void mergeKmerFilesAndOutput(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
                 res = queue.top();
                 queue.pop();
                 offsetPos[res.file] = queueNextEntry(queue, res.file, offsetPos[res.file],
-                                                     entries[res.file], entrySizes[res.file]);
+                                                     entries[res.file], rangeEnd[res.file]);
             }
             if(queue.empty() == false){
                 res = queue.top();
@@ -761,6 +876,59 @@ void mergeKmerFilesAndOutput(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
         }
         filePrevsKmerPos = res;
     }
+    delete [] offsetPos;
+}
+
+void mergeKmerFilesAndOutput(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
+                             std::vector<std::string> tmpFiles, std::vector<char> &repSequence,
+                             int covMode, float covThr, int threads) {
+    Debug(Debug::INFO) << "Merge splits ... ";
+
+    const int fileCnt = tmpFiles.size();
+    FILE ** files       = new FILE*[fileCnt];
+    KmerEntry **entries = new KmerEntry*[fileCnt];
+    size_t * entrySizes = new size_t[fileCnt];
+    size_t * dataSizes  = new size_t[fileCnt];
+    // init structures
+    for(size_t file = 0; file < tmpFiles.size(); file++){
+        files[file] = FileUtil::openFileOrDie(tmpFiles[file].c_str(),"r",true);
+        size_t dataSize;
+        entries[file]    = (KmerEntry*)FileUtil::mmapFile(files[file], &dataSize);
+        dataSizes[file]  = dataSize;
+        entrySizes[file] = dataSize/sizeof(KmerEntry);
+    }
+
+    // every split file is sorted by representative, partition the representatives into
+    // disjoint ranges and locate the blocks of each range in every file
+    const size_t dbSize = seqDbr.getSize();
+    const size_t rangeCnt = std::max(static_cast<size_t>(1), std::min(dbSize, static_cast<size_t>(threads) * 16));
+    size_t * rangeOffsets = new size_t[fileCnt * (rangeCnt + 1)];
+#pragma omp parallel for schedule(dynamic, 1) collapse(2)
+    for(int file = 0; file < fileCnt; file++){
+        for(size_t range = 0; range < rangeCnt + 1; range++){
+            size_t offset;
+            if(range == rangeCnt){
+                offset = entrySizes[file];
+            }else{
+                unsigned int repSeqId = static_cast<unsigned int>((dbSize * range) / rangeCnt);
+                offset = findBlockStart(entries[file], entrySizes[file], repSeqId);
+            }
+            rangeOffsets[range * fileCnt + file] = offset;
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for(size_t range = 0; range < rangeCnt; range++){
+        int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = omp_get_thread_num();
+#endif
+        mergeKmerRange(seqDbr, dbw, fileCnt, entries,
+                       rangeOffsets + range * fileCnt, rangeOffsets + (range + 1) * fileCnt,
+                       repSequence, covMode, covThr, thread_idx);
+    }
+    delete [] rangeOffsets;
+
     for(size_t file = 0; file < tmpFiles.size(); file++) {
         fclose(files[file]);
         if(munmap((void*)entries[file], dataSizes[file]) < 0){
@@ -771,7 +939,6 @@ void mergeKmerFilesAndOutput(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
     Debug(Debug::INFO) << "Done\n";
 
     delete [] dataSizes;
-    delete [] offsetPos;
     delete [] entries;
     delete [] entrySizes;
     delete [] files;
@@ -828,8 +995,10 @@ void writeKmersToDisk(std::string tmpFile, KmerPosition *hashSeqPair, size_t tot
         lastTargetId = targetId;
         writeSets++;
     }
-    if (writeSets > 0 && elemenetCnt > 0 && bufferPos > 0) {
-        fwrite(writeBuffer, sizeof(KmerEntry), bufferPos, filePtr);
+    if (writeSets > 0 && elemenetCnt > 0) {
+        if(bufferPos > 0){
+            fwrite(writeBuffer, sizeof(KmerEntry), bufferPos, filePtr);
+        }
         fwrite(&nullEntry,  sizeof(KmerEntry), 1, filePtr);
     }
     fclose(filePtr);
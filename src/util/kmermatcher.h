@@ -0,0 +1,98 @@
+#ifndef MMSEQS_KMERMATCHER_H
+#define MMSEQS_KMERMATCHER_H
+
+#include <cstddef>
+
+struct KmerPosition {
+    size_t kmer;
+    unsigned int id;
+    unsigned short seqLen;
+    short pos;
+    KmerPosition(){}
+    KmerPosition(size_t kmer, unsigned int id, unsigned short seqLen, short pos):
+            kmer(kmer), id(id), seqLen(seqLen), pos(pos) {}
+    static bool compareRepSequenceAndIdAndPos(const KmerPosition &first, const KmerPosition &second){
+        if(first.kmer < second.kmer )
+            return true;
+        if(second.kmer < first.kmer )
+            return false;
+        if(first.seqLen > second.seqLen )
+            return true;
+        if(second.seqLen > first.seqLen )
+            return false;
+        if(first.id < second.id )
+            return true;
+        if(second.id < first.id )
+            return false;
+        if(first.pos < second.pos )
+            return true;
+        if(second.pos < first.pos )
+            return false;
+        return false;
+    }
+
+    static bool compareRepSequenceAndIdAndDiag(const KmerPosition &first, const KmerPosition &second){
+        if(first.kmer < second.kmer)
+            return true;
+        if(second.kmer < first.kmer)
+            return false;
+        if(first.id < second.id)
+            return true;
+        if(second.id < first.id)
+            return false;
+
+        //        const short firstDiag  = (first.pos < 0)  ? -first.pos : first.pos;
+        //        const short secondDiag = (second.pos  < 0) ? -second.pos : second.pos;
+        if(first.pos < second.pos)
+            return true;
+        if(second.pos < first.pos)
+            return false;
+        return false;
+    }
+};
+
+struct __attribute__((__packed__)) KmerEntry {
+    unsigned int seqId;
+    short diagonal;
+};
+
+// hashed k-mer of a single sequence, candidate for the k-mer selection
+struct SequencePosition{
+    short score;
+    size_t kmer;
+    unsigned int pos;
+    static bool compareByScore(const SequencePosition &first, const SequencePosition &second){
+        if(first.score < second.score)
+            return true;
+        if(second.score < first.score)
+            return false;
+        if(first.kmer < second.kmer)
+            return true;
+        if(second.kmer < first.kmer)
+            return false;
+
+        return false;
+    }
+};
+
+unsigned circ_hash(const int * x, unsigned length, const unsigned rol);
+
+unsigned circ_hash_next(const int * x, unsigned length, int x_first, short unsigned h, const unsigned rol);
+
+// Sorts all k-mers of a sequence by hash, the first min(maxKmers, kmerCount) entries are selected.
+// Returns the number of selected k-mers.
+size_t selectTopHashKmers(SequencePosition *kmers, size_t kmerCount, size_t maxKmers);
+
+// Selects the (w,k)-minimizers of a sequence with a monotone deque scan in O(kmerCount).
+// The selected k-mers are compacted to the front of kmers and sorted by hash, if more than
+// maxKmers minimizers are found only the maxKmers with lowest hash are kept.
+// window needs space for windowSize entries.
+// Returns the number of selected k-mers.
+size_t selectMinimizerKmers(SequencePosition *kmers, size_t kmerCount, size_t windowSize, size_t maxKmers,
+                            unsigned int *window);
+
+// Minimizer window size that selects about chooseTopKmer k-mers from a sequence with avgKmerCount k-mers.
+// Random minimizers have an expected density of 2/(w+1).
+size_t computeMinimizerWindowSize(double avgKmerCount, size_t chooseTopKmer);
+
+#endif
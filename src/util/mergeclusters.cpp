@@ -6,6 +6,8 @@
 #include "itoa.h"
 
 #include <list>
+#include <climits>
+#include <cstring>
 
 #ifdef OPENMP
 #include <omp.h>
@@ -15,79 +17,90 @@ void mergeClusteringResults(std::string seqDB, std::string outDB, std::list<std:
     // open the sequence database
     // it will serve as the reference for sequence indexes
     std::string seqDBIndex = seqDB + ".index";
-    DBReader<unsigned int> dbr(seqDB.c_str(), seqDBIndex.c_str());
+    DBReader<unsigned int> dbr(seqDB.c_str(), seqDBIndex.c_str(), DBReader<unsigned int>::USE_INDEX);
     dbr.open(DBReader<unsigned int>::NOSORT);
-
-    // init the structure for cluster merging
-    // it has the size of all possible cluster (sequence amount)
-    std::list<unsigned int>** mergedClustering = new std::list<unsigned int>*[dbr.getSize()];
-    Debug(Debug::INFO) << "List amount "<< dbr.getSize() << "\n";
+    const size_t dbSize = dbr.getSize();
+
+    // union structure over all sequences: every sequence points to the representative
+    // that absorbed it, representatives of the final step point to themselves.
+    // A sequence is a member of exactly one cluster per step, so each step can
+    // update the parent array in parallel without conflicts
+    unsigned int *parent = new unsigned int[dbSize];
+    Debug(Debug::INFO) << "List amount "<< dbSize << "\n";
 #pragma omp parallel for
-    for (size_t i = 0; i < dbr.getSize(); i++){
-        mergedClustering[i] = new std::list<unsigned int>();
-    }
-
-    // read the clustering from the first clustering step
-    std::string firstCluStep = cluSteps.front();
-    cluSteps.pop_front();
-    std::string firstCluStepIndex = firstCluStep + ".index";
-    DBReader<unsigned int>* cluStepDbr = new DBReader<unsigned int>(firstCluStep.c_str(), firstCluStepIndex.c_str());
-    cluStepDbr->open(DBReader<unsigned int>::NOSORT);
-#pragma omp parallel for
-    for (size_t i = 0; i < cluStepDbr->getSize(); i++){
-        unsigned int clusterId = cluStepDbr->getDbKey(i);
-        size_t cluId = dbr.getId(clusterId);
-        char * data = cluStepDbr->getData(i);
-        // go through the sequences in the cluster and add them to the initial clustering
-        char keyBuffer[255];
-        while (*data != '\0'){
-            Util::parseKey(data, keyBuffer);
-            unsigned int key = Util::fast_atoi<unsigned int>(keyBuffer);
-            size_t seqId = dbr.getId(key);
-            mergedClustering[cluId]->push_back(seqId);
-            data = Util::skipLine(data);
-        }
+    for (size_t i = 0; i < dbSize; i++){
+        parent[i] = i;
     }
-    cluStepDbr->close();
-    delete cluStepDbr;
-    Debug(Debug::INFO) << "Clustering step 1...\n";
 
-    // merge later clustering steps into the initial clustering step
-    int cnt = 2;
+    int cnt = 1;
     while(!cluSteps.empty()){
         // open the next clustering database
         std::string cluStep = cluSteps.front();
         std::string cluStepIndex = cluStep + ".index";
         cluSteps.pop_front();
 
-        cluStepDbr = new DBReader<unsigned int>(cluStep.c_str(), cluStepIndex.c_str());
-        cluStepDbr->open(DBReader<unsigned int>::NOSORT);
+        DBReader<unsigned int> cluStepDbr(cluStep.c_str(), cluStepIndex.c_str());
+        cluStepDbr.open(DBReader<unsigned int>::NOSORT);
 
-        // go through the clusters and merge them into the clusters from the previous clustering step
-#pragma omp parallel for
-        for (size_t i = 0; i < cluStepDbr->getSize(); i++){
-            size_t cluId = dbr.getId(cluStepDbr->getDbKey(i));
-            char* cluData = cluStepDbr->getData(i);
-            // go through the sequences in the cluster and add them and their clusters to the cluster of cluId
-            // afterwards, delete the added cluster from the clustering
-            char * data = cluData;
+        // attach every member to the representative of its cluster in this step
+#pragma omp parallel for schedule(dynamic, 100)
+        for (size_t i = 0; i < cluStepDbr.getSize(); i++){
+            const unsigned int cluId = dbr.getId(cluStepDbr.getDbKey(i));
+            char *data = cluStepDbr.getData(i);
             char keyBuffer[255];
             while (*data != '\0') {
                 Util::parseKey(data, keyBuffer);
-                unsigned int key = Util::fast_atoi<unsigned int>(keyBuffer);
-                size_t seqId = dbr.getId(key);
-                if(seqId != cluId) { // to avoid copies of the same cluster list
-                    mergedClustering[cluId]->splice(mergedClustering[cluId]->end(), *mergedClustering[seqId]);
+                const unsigned int key = Util::fast_atoi<unsigned int>(keyBuffer);
+                const unsigned int seqId = dbr.getId(key);
+                if (seqId != UINT_MAX) {
+                    parent[seqId] = cluId;
                 }
                 data = Util::skipLine(data);
             }
         }
-        cluStepDbr->close();
-        delete cluStepDbr;
+        cluStepDbr.close();
         Debug(Debug::INFO) << "Clustering step " << cnt << "...\n";
         cnt++;
     }
 
+    // resolve the final representative of each sequence
+    // chains are at most as long as the number of clustering steps
+    unsigned int *root = new unsigned int[dbSize];
+#pragma omp parallel for
+    for (size_t i = 0; i < dbSize; i++){
+        unsigned int curr = i;
+        while (parent[curr] != curr) {
+            curr = parent[curr];
+        }
+        root[i] = curr;
+    }
+    delete[] parent;
+
+    // group members by representative into a flat array
+    size_t *clusterOffsets = new size_t[dbSize + 1];
+    memset(clusterOffsets, 0, sizeof(size_t) * (dbSize + 1));
+    for (size_t i = 0; i < dbSize; i++){
+        clusterOffsets[root[i] + 1]++;
+    }
+    for (size_t i = 0; i < dbSize; i++){
+        clusterOffsets[i + 1] += clusterOffsets[i];
+    }
+    unsigned int *members = new unsigned int[dbSize];
+    size_t *fill = new size_t[dbSize];
+    for (size_t i = 0; i < dbSize; i++){
+        // the representative always comes first in its cluster
+        fill[i] = clusterOffsets[i] + 1;
+    }
+    for (size_t i = 0; i < dbSize; i++){
+        if (root[i] == i) {
+            members[clusterOffsets[i]] = i;
+        } else {
+            members[fill[root[i]]++] = i;
+        }
+    }
+    delete[] fill;
+    delete[] root;
+
     Debug(Debug::INFO) << "Writing the results...\n";
 
     std::string outDBIndex = outDB + ".index";
@@ -106,17 +119,16 @@ void mergeClusteringResults(std::string seqDB, std::string outDB, std::list<std:
 
         // go through all sequences in the database
 #pragma omp for schedule(dynamic, 100)
-        for (size_t i = 0; i < dbr.getSize(); i++){
+        for (size_t i = 0; i < dbSize; i++){
             // no cluster for this representative
-            if (mergedClustering[i]->size() == 0)
+            if (clusterOffsets[i + 1] == clusterOffsets[i])
                 continue;
 
             // representative
             unsigned int dbKey = dbr.getDbKey(i);
             char buffer[32];
-            for(std::list<unsigned int>::iterator it = mergedClustering[i]->begin();
-                it != mergedClustering[i]->end(); ++it){
-                char * tmpBuff = Itoa::u32toa_sse2(dbr.getDbKey(*it), buffer);
+            for(size_t j = clusterOffsets[i]; j < clusterOffsets[i + 1]; j++){
+                char * tmpBuff = Itoa::u32toa_sse2(dbr.getDbKey(members[j]), buffer);
                 size_t length = tmpBuff - buffer - 1;
                 res.append(buffer, length);
                 res.push_back('\n');
@@ -129,11 +141,9 @@ void mergeClusteringResults(std::string seqDB, std::string outDB, std::list<std:
     dbw->close();
     delete dbw;
 
-    // delete the clustering data structure
-    for (unsigned int i = 0; i < dbr.getSize(); i++){
-        delete mergedClustering[i];
-    }
-    delete[] mergedClustering;
+    delete[] members;
+    delete[] clusterOffsets;
+    dbr.close();
 }
 
 int mergeclusters(int argc, const char **argv, const Command& command) {
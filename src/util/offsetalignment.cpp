@@ -7,22 +7,57 @@
 #include "Orf.h"
 #include "AlignmentSymmetry.h"
 #include "Timer.h"
+#include "FileUtil.h"
+
+#include <sys/mman.h>
 
 #ifdef OPENMP
 #include <omp.h>
 #endif
 
-void updateOffset(char* data, std::vector<Matcher::result_t> &results,
-                  const Orf::SequenceLocation *qloc, DBReader<unsigned int>& tHeaderDbr) {
+// Maps the binary ORF location index written by extractorfs, returns NULL if the database has none
+// returns NULL if there is no location index, the headers are parsed instead
+static Orf::PackedLocation* openLocationIndex(const std::string &db, size_t *mappedSize, size_t *locationCount) {
+    std::string locationFile = db + ".orf";
+    *locationCount = 0;
+    if (FileUtil::fileExists(locationFile.c_str()) == false || FileUtil::getFileSize(locationFile) == 0) {
+        return NULL;
+    }
+    FILE *file = FileUtil::openFileOrDie(locationFile.c_str(), "r", true);
+    Orf::PackedLocation *locations = (Orf::PackedLocation *) FileUtil::mmapFile(file, mappedSize);
+    fclose(file);
+    // without the index an amino acid ORF database would not be mapped back to its contigs, so a broken one is an error
+    if (*mappedSize % sizeof(Orf::PackedLocation) != 0) {
+        Debug(Debug::ERROR) << "Location index " << locationFile << " is truncated, please delete it and run extractorfs again.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    *locationCount = *mappedSize / sizeof(Orf::PackedLocation);
+    return locations;
+}
+
+static Orf::SequenceLocation getOrfLocation(unsigned int key, const Orf::PackedLocation *locations, size_t locationCount,
+                                            DBReader<unsigned int> *headerDbr) {
+    if (locations != NULL) {
+        if (key >= locationCount) {
+            Debug(Debug::ERROR) << "Key " << key << " is not in the location index (" << locationCount << " entries). "
+                                << "The .orf file belongs to another database, please delete it and run extractorfs again.\n";
+            EXIT(EXIT_FAILURE);
+        }
+        return locations[key].unpack();
+    }
+    char *header = headerDbr->getData(headerDbr->getId(key));
+    return Orf::parseOrfHeader(header);
+}
+
+void updateOffset(char* data, std::vector<Matcher::result_t> &results, const Orf::SequenceLocation *qloc,
+                  const Orf::PackedLocation *tLocations, size_t tLocationCount, DBReader<unsigned int> *tHeaderDbr) {
     size_t startPos = results.size();
     Matcher::readAlignmentResults(results, data, true);
     size_t endPos = results.size();
     for (size_t i = startPos; i < endPos; i++) {
         Matcher::result_t &res = results[i];
         if (qloc == NULL) {
-            size_t targetId = tHeaderDbr.getId(res.dbKey);
-            char *header = tHeaderDbr.getData(targetId);
-            Orf::SequenceLocation tloc = Orf::parseOrfHeader(header);
+            Orf::SequenceLocation tloc = getOrfLocation(res.dbKey, tLocations, tLocationCount, tHeaderDbr);
             res.dbKey = tloc.id;
             res.dbStartPos = tloc.from + res.dbStartPos * 3;
             res.dbEndPos = tloc.from + res.dbEndPos * 3;
@@ -59,13 +94,29 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
         return EXIT_FAILURE;
     }
 
-    Debug(Debug::INFO) << "Query database: " << par.hdr1 << "\n";
-    DBReader<unsigned int> qHeaderDbr(par.hdr1.c_str(), par.hdr1Index.c_str());
-    qHeaderDbr.open(DBReader<unsigned int>::NOSORT);
+    // ORF locations come from the binary index of extractorfs if available, otherwise from the headers
+    size_t qLocationSize = 0;
+    size_t qLocationCount = 0;
+    Orf::PackedLocation *qLocations = openLocationIndex(par.db1, &qLocationSize, &qLocationCount);
+    DBReader<unsigned int> *qHeaderDbr = NULL;
+    if (qLocations == NULL) {
+        Debug(Debug::INFO) << "Query database: " << par.hdr1 << "\n";
+        qHeaderDbr = new DBReader<unsigned int>(par.hdr1.c_str(), par.hdr1Index.c_str());
+        qHeaderDbr->open(DBReader<unsigned int>::NOSORT);
+    }
 
-    Debug(Debug::INFO) << "Target database: " << par.hdr2 << "\n";
-    DBReader<unsigned int> tHeaderDbr(par.hdr2.c_str(), par.hdr2Index.c_str());
-    tHeaderDbr.open(DBReader<unsigned int>::NOSORT);
+    size_t tLocationSize = 0;
+    size_t tLocationCount = 0;
+    Orf::PackedLocation *tLocations = openLocationIndex(par.db2, &tLocationSize, &tLocationCount);
+    DBReader<unsigned int> *tHeaderDbr = NULL;
+    if (tLocations == NULL) {
+        Debug(Debug::INFO) << "Target database: " << par.hdr2 << "\n";
+        tHeaderDbr = new DBReader<unsigned int>(par.hdr2.c_str(), par.hdr2Index.c_str());
+        tHeaderDbr->open(DBReader<unsigned int>::NOSORT);
+    }
+
+    // translated ORF databases are amino acid databases, the location index marks them as ORFs
+    const bool queryIsOrf = (queryDbType == Sequence::NUCLEOTIDES) || (qLocations != NULL);
 
     Debug(Debug::INFO) << "Result database: " << par.db3 << "\n";
     DBReader<unsigned int> alnDbr(par.db3.c_str(), par.db3Index.c_str());
@@ -87,16 +138,14 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
     unsigned int *contigOffsets = NULL;
     char *contigExists = NULL;
     unsigned int maxContigKey = 0;
-    if (queryDbType == Sequence::NUCLEOTIDES) {
+    if (queryIsOrf) {
         Timer timer;
         Debug(Debug::INFO) << "Computing ORF lookup...\n";
         unsigned int maxOrfKey = alnDbr.getLastKey();
         unsigned int *orfLookup = new unsigned int[maxOrfKey + 2]();
 #pragma omp parallel for schedule(dynamic, 10) num_threads(localThreads) reduction(max:maxContigKey)
         for (size_t i = 0; i <= maxOrfKey; ++i) {
-            size_t queryId = qHeaderDbr.getId(i);
-            char *header = qHeaderDbr.getData(queryId);
-            Orf::SequenceLocation qloc = Orf::parseOrfHeader(header);
+            Orf::SequenceLocation qloc = getOrfLocation(i, qLocations, qLocationCount, qHeaderDbr);
             orfLookup[i] = qloc.id;
             maxContigKey = std::max(maxContigKey, qloc.id);
         }
@@ -147,7 +196,7 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
         results.reserve(300);
 
         size_t entryCount = alnDbr.getSize();
-        if (queryDbType == Sequence::NUCLEOTIDES) {
+        if (queryIsOrf) {
             entryCount = maxContigKey + 1;
         }
 
@@ -156,7 +205,7 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
             Debug::printProgress(i);
 
             unsigned int queryKey;
-            if (queryDbType == Sequence::NUCLEOTIDES) {
+            if (queryIsOrf) {
                 queryKey = i;
                 if (contigExists[i] == 0) {
                     continue;
@@ -168,15 +217,13 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
                     size_t orfId = alnDbr.getId(orfKey);
                     char *data = alnDbr.getData(orfId);
 
-                    size_t queryId = qHeaderDbr.getId(orfKey);
-                    char *header = qHeaderDbr.getData(queryId);
-                    Orf::SequenceLocation qloc = Orf::parseOrfHeader(header);
-                    updateOffset(data, results, &qloc, tHeaderDbr);
+                    Orf::SequenceLocation qloc = getOrfLocation(orfKey, qLocations, qLocationCount, qHeaderDbr);
+                    updateOffset(data, results, &qloc, tLocations, tLocationCount, tHeaderDbr);
                 }
             } else {
                 queryKey = alnDbr.getDbKey(i);
                 char *data = alnDbr.getData(i);
-                updateOffset(data, results, NULL, tHeaderDbr);
+                updateOffset(data, results, NULL, tLocations, tLocationCount, tHeaderDbr);
             }
             std::stable_sort(results.begin(), results.end(), Matcher::compareHits);
             for(size_t i = 0; i < results.size(); i++){
@@ -205,8 +252,18 @@ int offsetalignment(int argc, const char **argv, const Command &command) {
         delete[] contigExists;
     }
 
-    qHeaderDbr.close();
-    tHeaderDbr.close();
+    if (qLocations != NULL) {
+        munmap(qLocations, qLocationSize);
+    } else {
+        qHeaderDbr->close();
+        delete qHeaderDbr;
+    }
+    if (tLocations != NULL) {
+        munmap(tLocations, tLocationSize);
+    } else {
+        tHeaderDbr->close();
+        delete tHeaderDbr;
+    }
     alnDbr.close();
 
     return EXIT_SUCCESS;
@@ -0,0 +1,132 @@
+#include "Parameters.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Util.h"
+#include "FileUtil.h"
+#include "Debug.h"
+#include "Sequence.h"
+#include "SubstitutionMatrix.h"
+
+#include <climits>
+#include <cstring>
+#include <algorithm>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// Writes the profile in the quantised layout described at Sequence::PROFILE_QUANT8_MARKER
+static void quantiseProfile(const Sequence &seq, const char *data, bool fourBit, std::string &result) {
+    const size_t L = seq.L;
+    int8_t *scores = seq.profile_for_alignment;
+
+    int minScore = INT_MAX;
+    int maxScore = INT_MIN;
+    for (size_t i = 0; i < L * Sequence::PROFILE_AA_SIZE; i++) {
+        minScore = std::min(minScore, static_cast<int>(scores[i]));
+        maxScore = std::max(maxScore, static_cast<int>(scores[i]));
+    }
+
+    result.push_back(static_cast<char>(fourBit ? Sequence::PROFILE_QUANT4_MARKER : Sequence::PROFILE_QUANT8_MARKER));
+    uint32_t length = static_cast<uint32_t>(L);
+    result.append(reinterpret_cast<const char *>(&length), sizeof(uint32_t));
+
+    if (fourBit) {
+        minScore = (L == 0) ? 0 : minScore;
+        // 16 uniform levels starting at the lowest score of the profile
+        const int range = (L == 0) ? 0 : maxScore - minScore;
+        const int step = std::max(1, (range + 14) / 15);
+        // rounding up must not overflow int8 when decoding
+        const int maxLevel = std::min(15, (SCHAR_MAX - minScore) / step);
+        result.push_back(static_cast<char>(minScore));
+        result.push_back(static_cast<char>(step));
+        for (size_t aa = 0; aa < Sequence::PROFILE_AA_SIZE; aa++) {
+            const int8_t *row = scores + aa * L;
+            for (size_t i = 0; i < L; i += 2) {
+                unsigned char packed = 0;
+                for (size_t j = 0; j < 2 && i + j < L; j++) {
+                    const int level = std::min(maxLevel, (row[i + j] - minScore + step / 2) / step);
+                    packed |= static_cast<unsigned char>(level << (j * 4));
+                }
+                result.push_back(static_cast<char>(packed));
+            }
+        }
+    } else {
+        result.append(reinterpret_cast<const char *>(scores), L * Sequence::PROFILE_AA_SIZE);
+    }
+
+    // query, consensus and Neff bytes are copied from the column-wise entry
+    for (size_t field = Sequence::PROFILE_AA_SIZE; field < Sequence::PROFILE_READIN_SIZE; field++) {
+        for (size_t i = 0; i < L; i++) {
+            result.push_back(data[i * Sequence::PROFILE_READIN_SIZE + field]);
+        }
+    }
+}
+
+int quantizeprofiledb(int argc, const char **argv, const Command &command) {
+    Parameters &par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, 2, true, 0, MMseqsParameter::COMMAND_PROFILE);
+
+#ifdef OPENMP
+    omp_set_num_threads(par.threads);
+#endif
+
+    DBReader<unsigned int> profileReader(par.db1.c_str(), par.db1Index.c_str());
+    profileReader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+
+    if (profileReader.getDbtype() != Sequence::HMM_PROFILE) {
+        Debug(Debug::ERROR) << "Input database must be a profile database!\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    DBWriter writer(par.db2.c_str(), par.db2Index.c_str(), par.threads);
+    writer.open();
+
+    const bool fourBit = (par.quantBits == Parameters::PROFILE_QUANT_BITS_4);
+    const size_t entries = profileReader.getSize();
+
+    SubstitutionMatrix subMat(par.scoringMatrixFile.c_str(), 2.0f, 0.0);
+    Debug(Debug::INFO) << "Start quantising profiles to " << par.quantBits << " bits.\n";
+#pragma omp parallel
+    {
+        // scores are stored without bias correction, it is applied when the profile is mapped
+        Sequence seq(par.maxSeqLen, Sequence::HMM_PROFILE, &subMat, 0, false, false);
+
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+
+        std::string result;
+        result.reserve(par.maxSeqLen * Sequence::PROFILE_READIN_SIZE * sizeof(char));
+
+#pragma omp for schedule(dynamic, 100)
+        for (size_t i = 0; i < entries; ++i) {
+            Debug::printProgress(i);
+            result.clear();
+
+            unsigned int key = profileReader.getDbKey(i);
+            const char *data = profileReader.getData(i);
+            const unsigned char marker = static_cast<unsigned char>(data[0]);
+            if (marker == Sequence::PROFILE_QUANT8_MARKER || marker == Sequence::PROFILE_QUANT4_MARKER) {
+                Debug(Debug::ERROR) << "Profile " << key << " is already quantised!\n";
+                EXIT(EXIT_FAILURE);
+            }
+
+            seq.mapSequence(i, key, data);
+            quantiseProfile(seq, data, fourBit, result);
+            writer.writeData(result.c_str(), result.length(), key, thread_idx);
+        }
+    }
+    writer.close(Sequence::HMM_PROFILE);
+    profileReader.close();
+
+    if (FileUtil::fileExists(par.hdr1.c_str())) {
+        FileUtil::symlinkAbs(par.hdr1, par.hdr2);
+        FileUtil::symlinkAbs(par.hdr1Index, par.hdr2Index);
+    }
+
+    Debug(Debug::INFO) << "\nDone.\n";
+
+    return EXIT_SUCCESS;
+}
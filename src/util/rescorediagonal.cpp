@@ -40,6 +40,27 @@ float parsePrecisionLib(const std::string &scoreFile, double targetSeqid, double
     return 0;
 }
 
+// Largest Hamming distance along a diagonal that can still fulfill --min-seq-id.
+// One identity of slack is kept so the exact check below is the only one deciding.
+unsigned int computeHammingBudget(const Parameters &par, int queryLen, int dbLen, unsigned int diagonalLen) {
+    int seqIdDenominator;
+    switch (par.seqIdMode) {
+        case Parameters::SEQ_ID_SHORT:
+            seqIdDenominator = std::min(queryLen, dbLen);
+            break;
+        case Parameters::SEQ_ID_LONG:
+            seqIdDenominator = std::max(queryLen, dbLen);
+            break;
+        default:
+            seqIdDenominator = diagonalLen;
+            break;
+    }
+    float minSeqId = par.seqIdThr - std::numeric_limits<float>::epsilon();
+    int minIdCnt = static_cast<int>(minSeqId * static_cast<float>(seqIdDenominator)) - 1;
+    minIdCnt = std::min(std::max(minIdCnt, 0), static_cast<int>(diagonalLen));
+    return diagonalLen - static_cast<unsigned int>(minIdCnt);
+}
+
 int doRescorediagonal(Parameters &par,
                       DBWriter &resultWriter,
                       DBReader<unsigned int> &resultReader,
@@ -161,8 +182,14 @@ int doRescorediagonal(Parameters &par,
                     if (diagonal >= 0 && distanceToDiagonal < queryLen) {
                         diagonalLen = std::min(dbLen, queryLen - distanceToDiagonal);
                         if (par.rescoreMode == Parameters::RESCORE_MODE_HAMMING) {
-                            distance = DistanceCalculator::computeHammingDistance(
-                                    querySeq + distanceToDiagonal, targetSeq, diagonalLen);
+                            unsigned int maxDistance = isIdentity ? diagonalLen
+                                                                  : computeHammingBudget(par, queryLen, dbLen, diagonalLen);
+                            distance = DistanceCalculator::computeHammingDistanceBounded(
+                                    querySeq + distanceToDiagonal, targetSeq, diagonalLen, maxDistance);
+                            if (distance > maxDistance) {
+                                // can not fulfill --min-seq-id anymore
+                                continue;
+                            }
                         } else if (par.rescoreMode == Parameters::RESCORE_MODE_SUBSTITUTION) {
                             distance = DistanceCalculator::computeSubstitutionDistance(
                                     querySeq + distanceToDiagonal, targetSeq, diagonalLen, fastMatrix.matrix, par.globalAlignment);
@@ -174,8 +201,14 @@ int doRescorediagonal(Parameters &par,
                     } else if (diagonal < 0 && distanceToDiagonal < dbLen) {
                         diagonalLen = std::min(dbLen - distanceToDiagonal, queryLen);
                         if (par.rescoreMode == Parameters::RESCORE_MODE_HAMMING) {
-                            distance = DistanceCalculator::computeHammingDistance(
-                                    querySeq, targetSeq + distanceToDiagonal, diagonalLen);
+                            unsigned int maxDistance = isIdentity ? diagonalLen
+                                                                  : computeHammingBudget(par, queryLen, dbLen, diagonalLen);
+                            distance = DistanceCalculator::computeHammingDistanceBounded(
+                                    querySeq, targetSeq + distanceToDiagonal, diagonalLen, maxDistance);
+                            if (distance > maxDistance) {
+                                // can not fulfill --min-seq-id anymore
+                                continue;
+                            }
                         } else if (par.rescoreMode == Parameters::RESCORE_MODE_SUBSTITUTION) {
                             distance = DistanceCalculator::computeSubstitutionDistance(
                                     querySeq, targetSeq + distanceToDiagonal, diagonalLen, fastMatrix.matrix, par.globalAlignment);
@@ -141,6 +141,8 @@ int result2profile(DBReader<unsigned int> &resultReader, Parameters &par, const
     Debug(Debug::INFO) << "Target database type: " << DBReader<unsigned int>::getDbTypeName(targetSeqType) << "\n";
 
     const bool isFiltering = par.filterMsa != 0;
+    // the filter and the context specific weights need pairwise access to the MSA columns
+    const bool streamProfile = (isFiltering == false && par.wg == true);
     int xAmioAcid = subMat.aa2int[(int)'X'];
 
 #pragma omp parallel
@@ -230,35 +232,41 @@ int result2profile(DBReader<unsigned int> &resultReader, Parameters &par, const
             }
 
             // Recompute if not all the backtraces are present
-            MultipleAlignment::MSAResult res = (alnResults.size() == seqSet.size())
-                                               ? aligner.computeMSA(&centerSequence, seqSet, alnResults, true)
-                                               : aligner.computeMSA(&centerSequence, seqSet, true);
-
-
-//            MultipleAlignment::print(res, &subMat);
-
-            size_t filteredSetSize = res.setSize;
-            if (isFiltering) {
-                filter.filter(res.setSize, res.centerLength, static_cast<int>(par.cov * 100),
-                              static_cast<int>(par.qid * 100), par.qsc,
-                              static_cast<int>(par.filterMaxSeqId * 100), par.Ndiff,
-                              (const char **) res.msaSequence, &filteredSetSize);
-                filter.shuffleSequences((const char **) res.msaSequence, res.setSize);
+            if (alnResults.size() != seqSet.size()) {
+                alnResults = aligner.computeBacktrace(&centerSequence, seqSet);
             }
 
-//                        MultipleAlignment::print(res, &subMat);
+            // Without filtering and with global weights the profile is accumulated
+            // straight from the backtraces, otherwise we need the full MSA
+            MultipleAlignment::MSAResult res(centerSequence.L, centerSequence.L, seqSet.size() + 1, NULL);
+            PSSMCalculator::Profile pssmRes(NULL, NULL, NULL, "");
+            if (streamProfile) {
+                pssmRes = calculator.computePSSMFromAlignments(&centerSequence, seqSet, alnResults);
+            } else {
+                res = aligner.computeMSA(&centerSequence, seqSet, alnResults, true);
+//                MultipleAlignment::print(res, &subMat);
+
+                size_t filteredSetSize = res.setSize;
+                if (isFiltering) {
+                    filter.filter(res.setSize, res.centerLength, static_cast<int>(par.cov * 100),
+                                  static_cast<int>(par.qid * 100), par.qsc,
+                                  static_cast<int>(par.filterMaxSeqId * 100), par.Ndiff,
+                                  (const char **) res.msaSequence, &filteredSetSize);
+                    filter.shuffleSequences((const char **) res.msaSequence, res.setSize);
+                }
 
+//                MultipleAlignment::print(res, &subMat);
 
-            for (size_t pos = 0; pos < res.centerLength; pos++) {
-                if (res.msaSequence[0][pos] == MultipleAlignment::GAP) {
-                    Debug(Debug::ERROR) <<  "Error in computePSSMFromMSA. First sequence of MSA is not allowed to contain gaps.\n";
-                    EXIT(EXIT_FAILURE);
+                for (size_t pos = 0; pos < res.centerLength; pos++) {
+                    if (res.msaSequence[0][pos] == MultipleAlignment::GAP) {
+                        Debug(Debug::ERROR) <<  "Error in computePSSMFromMSA. First sequence of MSA is not allowed to contain gaps.\n";
+                        EXIT(EXIT_FAILURE);
+                    }
                 }
-            }
 
-            PSSMCalculator::Profile pssmRes = calculator.computePSSMFromMSA(filteredSetSize, res.centerLength,
-                                                                                         (const char **) res.msaSequence,
-                                                                                          par.wg);
+                pssmRes = calculator.computePSSMFromMSA(filteredSetSize, res.centerLength,
+                                                        (const char **) res.msaSequence, par.wg);
+            }
 
             if(par.maskProfile == true){
                 for (int i = 0; i < centerSequence.L; ++i) {
@@ -306,7 +314,9 @@ int result2profile(DBReader<unsigned int> &resultReader, Parameters &par, const
                 consensusStr.push_back('\n');
                 consensusWriter->writeData(consensusStr.c_str(), consensusStr.length(), queryKey, thread_idx);
             }
-            MultipleAlignment::deleteMSA(&res);
+            if (res.msaSequence != NULL) {
+                MultipleAlignment::deleteMSA(&res);
+            }
             for (std::vector<Sequence *>::iterator it = seqSet.begin(); it != seqSet.end(); ++it) {
                 Sequence *seq = *it;
                 delete seq;
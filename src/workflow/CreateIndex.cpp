@@ -64,8 +64,8 @@ int createindex(int argc, const char **argv, const Command& command) {
     CommandCaller cmd;
     cmd.addVariable("NUCL", dbType == Sequence::NUCLEOTIDES ? "TRUE" : NULL);
     cmd.addVariable("REMOVE_TMP", par.removeTmpFiles ? "TRUE" : NULL);
+    par.translate = true;
     cmd.addVariable("ORF_PAR", par.createParameterString(par.extractorfs).c_str());
-    cmd.addVariable("TRANSLATE_PAR", par.createParameterString(par.translatenucs).c_str());
     cmd.addVariable("INDEX_PAR", par.createParameterString(par.indexdb).c_str());
 
     FileUtil::writeFile(par.db2 + "/createindex.sh", createindex_sh, createindex_sh_len);